@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_BENCH_UTIL_H
+#define __MDCS_BENCH_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Prints one entry of the "results" array of a push benchmark.
+ * first is set to 0 after the first entry so that the following
+ * ones are preceded by a comma.
+ */
+static inline void bench_print_result(int* first, const char* type,
+		const char* mode, size_t buffer, size_t num_items, double seconds)
+{
+	printf("%s    { \"type\": \"%s\", \"mode\": \"%s\", \"buffer\": %zu, "
+		"\"ns_per_push\": %.3f, \"items_per_sec\": %.1f }",
+		*first ? "" : ",\n", type, mode, buffer,
+		seconds*1e9/num_items, num_items/seconds);
+	*first = 0;
+}
+
+static inline int bench_compare_doubles(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Sorts an array of num samples in place.
+ */
+static inline void bench_sort(double* samples, size_t num)
+{
+	qsort(samples, num, sizeof(double), bench_compare_doubles);
+}
+
+/**
+ * Returns the p-th percentile (0 < p < 100) of a sorted
+ * array of num samples, using the nearest-rank method.
+ */
+static inline double bench_percentile(const double* sorted, size_t num, double p)
+{
+	double r = p/100.0*num;
+	size_t rank = (size_t)r;
+	if(rank < r) rank += 1;
+	if(rank == 0) rank = 1;
+	if(rank > num) rank = num;
+	return sorted[rank-1];
+}
+
+#endif
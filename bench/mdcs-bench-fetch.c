@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <margo.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-timer.h>
+#include "bench-util.h"
+
+/*
+ * Measures the latency and throughput of the fetch RPC, and prints
+ * the results as JSON on stdout.
+ *
+ * usage: mdcs-bench-fetch <protocol> [num_fetches]
+ *            runs the server and the clients in the same process
+ *        mdcs-bench-fetch -s <protocol>
+ *            runs a server, prints its address, and waits until killed
+ *        mdcs-bench-fetch -c <server address> [num_fetches]
+ *            runs the clients against a server started with -s
+ *
+ * e.g. "mdcs-bench-fetch na+sm" or "mdcs-bench-fetch ofi+tcp".
+ *
+ * Single fetches read a scalar counter, batched fetches read all the
+ * slots of a vector counter in one RPC. Each case is run with 1, 4,
+ * and 16 client ULTs, each issuing num_fetches fetches back to back.
+ */
+
+#define DEFAULT_NUM_FETCHES 10000
+
+typedef struct {
+	const char* mode;      // "single" or "batched"
+	const char* name;      // name of the counter
+	size_t      num_slots; // 0 for the scalar counter
+} fetch_case_t;
+
+static const fetch_case_t fetch_cases[] = {
+	{ "single",  "bench:fetch:scalar", 0 },
+	{ "batched", "bench:fetch:16",     16 },
+	{ "batched", "bench:fetch:256",    256 },
+	{ "batched", "bench:fetch:4096",   4096 }
+};
+
+static const size_t concurrencies[] = { 1, 4, 16 };
+
+#define NUM_CASES         (sizeof(fetch_cases)/sizeof(fetch_cases[0]))
+#define NUM_CONCURRENCIES (sizeof(concurrencies)/sizeof(concurrencies[0]))
+
+typedef struct {
+	hg_addr_t         addr;        // address of the server
+	mdcs_counter_id_t id;          // counter to fetch
+	size_t            num_slots;   // number of slots to fetch, 0 for a scalar
+	size_t            value_size;  // size of the fetched value
+	size_t            num_fetches; // number of fetches to issue
+	double*           latencies;   // latency of each fetch, in seconds
+	int               ret;         // MDCS_ERROR if any fetch failed
+} fetch_ult_arg_t;
+
+static void fetch_ult(void* arg)
+{
+	fetch_ult_arg_t* a = (fetch_ult_arg_t*)arg;
+	size_t i;
+	int ret;
+
+	void* value = malloc(a->value_size);
+	assert(value != NULL);
+
+	for(i=0; i < a->num_fetches; i++) {
+		mdcs_timer_t timer = mdcs_timer_start();
+		if(a->num_slots == 0)
+			ret = mdcs_remote_counter_fetch(a->addr, a->id, value, a->value_size);
+		else
+			ret = mdcs_remote_counter_fetch_slots(a->addr, a->id,
+					0, a->num_slots, value, a->value_size);
+		a->latencies[i] = mdcs_timer_elapsed(timer);
+		if(ret != MDCS_SUCCESS) a->ret = MDCS_ERROR;
+	}
+
+	free(value);
+}
+
+/**
+ * Registers the counters fetched by the clients and pushes some values in them.
+ */
+static void register_counters()
+{
+	size_t i, j;
+	int ret;
+
+	for(i=0; i < NUM_CASES; i++) {
+		const fetch_case_t* fc = &fetch_cases[i];
+		mdcs_counter_t counter = MDCS_COUNTER_NULL;
+		double d;
+
+		if(fc->num_slots == 0) {
+			ret = mdcs_counter_register(fc->name, MDCS_COUNTER_STAT_DOUBLE, 0, &counter);
+			assert(ret == MDCS_SUCCESS);
+			for(j=0; j < 100; j++) {
+				d = (double)rand()/RAND_MAX;
+				mdcs_counter_push(counter, &d);
+			}
+		} else {
+			ret = mdcs_counter_vector_register(fc->name, MDCS_COUNTER_STAT_DOUBLE,
+					fc->num_slots, &counter);
+			assert(ret == MDCS_SUCCESS);
+			for(j=0; j < fc->num_slots; j++) {
+				d = (double)rand()/RAND_MAX;
+				mdcs_counter_vector_push(counter, j, &d);
+			}
+		}
+	}
+}
+
+/**
+ * Runs one case with the given number of client ULTs
+ * and prints its entry of the results.
+ */
+static void run_case(ABT_pool pool, hg_addr_t addr, const fetch_case_t* fc,
+		size_t concurrency, size_t num_fetches, int* first)
+{
+	size_t i;
+	int ret;
+	size_t slots = fc->num_slots == 0 ? 1 : fc->num_slots;
+	size_t total = concurrency * num_fetches;
+
+	fetch_ult_arg_t* args = (fetch_ult_arg_t*)calloc(concurrency, sizeof(*args));
+	ABT_thread* threads = (ABT_thread*)calloc(concurrency, sizeof(*threads));
+	double* latencies = (double*)malloc(total*sizeof(double));
+	assert(args != NULL && threads != NULL && latencies != NULL);
+
+	for(i=0; i < concurrency; i++) {
+		args[i].addr = addr;
+		mdcs_remote_counter_get_id(fc->name, &args[i].id);
+		args[i].num_slots = fc->num_slots;
+		args[i].value_size = slots * sizeof(mdcs_counter_stat_double_value_t);
+		args[i].num_fetches = num_fetches;
+		args[i].latencies = latencies + i*num_fetches;
+		args[i].ret = MDCS_SUCCESS;
+	}
+
+	// warm-up fetch, not accounted for
+	args[0].num_fetches = 1;
+	fetch_ult(&args[0]);
+	args[0].num_fetches = num_fetches;
+
+	mdcs_timer_t timer = mdcs_timer_start();
+	for(i=0; i < concurrency; i++) {
+		ret = ABT_thread_create(pool, fetch_ult, &args[i],
+				ABT_THREAD_ATTR_NULL, &threads[i]);
+		assert(ret == ABT_SUCCESS);
+	}
+	for(i=0; i < concurrency; i++) {
+		ABT_thread_join(threads[i]);
+		ABT_thread_free(&threads[i]);
+	}
+	double elapsed = mdcs_timer_elapsed(timer);
+
+	for(i=0; i < concurrency; i++) {
+		if(args[i].ret != MDCS_SUCCESS)
+			fprintf(stderr, "Some fetches of %s failed\n", fc->name);
+	}
+
+	bench_sort(latencies, total);
+
+	printf("%s    { \"mode\": \"%s\", \"slots\": %zu, \"value_size\": %zu, "
+		"\"concurrency\": %zu, \"p50_us\": %.3f, \"p99_us\": %.3f, "
+		"\"fetches_per_sec\": %.1f }",
+		*first ? "" : ",\n", fc->mode, slots, args[0].value_size, concurrency,
+		bench_percentile(latencies, total, 50.0)*1e6,
+		bench_percentile(latencies, total, 99.0)*1e6,
+		total/elapsed);
+	*first = 0;
+
+	free(latencies);
+	free(threads);
+	free(args);
+}
+
+/**
+ * Runs all the cases against the server at addr.
+ */
+static void run_clients(hg_addr_t addr, size_t num_fetches)
+{
+	size_t i, j;
+	int first = 1;
+	ABT_xstream xstream;
+	ABT_pool pool;
+
+	// client ULTs run in the pool of the calling ULT
+	ABT_xstream_self(&xstream);
+	ABT_xstream_get_main_pools(xstream, 1, &pool);
+
+	printf("{\n");
+	printf("  \"benchmark\": \"fetch\",\n");
+	printf("  \"num_fetches\": %zu,\n", num_fetches);
+	printf("  \"results\": [\n");
+
+	for(i=0; i < NUM_CASES; i++) {
+		for(j=0; j < NUM_CONCURRENCIES; j++) {
+			run_case(pool, addr, &fetch_cases[i], concurrencies[j], num_fetches, &first);
+		}
+	}
+
+	printf("\n  ]\n}\n");
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "usage: %s <protocol> [num_fetches]\n", prog);
+	fprintf(stderr, "       %s -s <protocol>\n", prog);
+	fprintf(stderr, "       %s -c <server address> [num_fetches]\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+	margo_instance_id mid = MARGO_INSTANCE_NULL;
+	hg_addr_t addr = HG_ADDR_NULL;
+	size_t num_fetches = DEFAULT_NUM_FETCHES;
+	int ret;
+
+	if(argc < 2 || (argv[1][0] == '-' && argc < 3)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	srand(42);
+
+	if(strcmp(argv[1], "-s") == 0) {
+
+		mid = margo_init(argv[2], MARGO_SERVER_MODE, 0, -1);
+		assert(mid);
+
+		ret = mdcs_init(mid, MDCS_TRUE, ABT_POOL_NULL);
+		assert(ret == MDCS_SUCCESS);
+
+		register_counters();
+
+		char addr_str[256];
+		hg_size_t addr_str_size = sizeof(addr_str);
+		margo_addr_self(mid, &addr);
+		margo_addr_to_string(mid, addr_str, &addr_str_size, addr);
+		margo_addr_free(mid, addr);
+		printf("%s\n", addr_str);
+		fflush(stdout);
+
+		margo_wait_for_finalize(mid);
+
+	} else if(strcmp(argv[1], "-c") == 0) {
+
+		if(argc > 3) num_fetches = strtoul(argv[3], NULL, 10);
+		if(num_fetches == 0) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		// the protocol is the part of the address before "://"
+		char protocol[64];
+		const char* sep = strstr(argv[2], "://");
+		size_t len = sep ? (size_t)(sep - argv[2]) : strlen(argv[2]);
+		if(len >= sizeof(protocol)) len = sizeof(protocol) - 1;
+		memcpy(protocol, argv[2], len);
+		protocol[len] = '\0';
+
+		mid = margo_init(protocol, MARGO_CLIENT_MODE, 0, 0);
+		assert(mid);
+
+		ret = mdcs_init(mid, MDCS_FALSE, ABT_POOL_NULL);
+		assert(ret == MDCS_SUCCESS);
+
+		ret = margo_addr_lookup(mid, argv[2], &addr);
+		assert(ret == HG_SUCCESS);
+
+		run_clients(addr, num_fetches);
+
+		margo_addr_free(mid, addr);
+		mdcs_finalize();
+		margo_finalize(mid);
+
+	} else {
+
+		if(argc > 2) num_fetches = strtoul(argv[2], NULL, 10);
+		if(num_fetches == 0) {
+			usage(argv[0]);
+			return 1;
+		}
+
+		// a progress thread and handler xstreams keep the
+		// server side off the xstream running the clients
+		mid = margo_init(argv[1], MARGO_SERVER_MODE, 1, 4);
+		assert(mid);
+
+		ret = mdcs_init(mid, MDCS_TRUE, ABT_POOL_NULL);
+		assert(ret == MDCS_SUCCESS);
+
+		register_counters();
+
+		margo_addr_self(mid, &addr);
+
+		run_clients(addr, num_fetches);
+
+		margo_addr_free(mid, addr);
+		mdcs_finalize();
+		margo_finalize(mid);
+	}
+
+	return 0;
+}
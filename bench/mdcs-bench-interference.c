@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <margo.h>
+#include <mercury_macros.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-margo.h>
+#include <mdcs/mdcs-timer.h>
+#include "bench-util.h"
+
+/*
+ * Measures how much MDCS slows down a service, and prints the
+ * results as JSON on stdout.
+ *
+ * usage: mdcs-bench-interference <protocol> [rate] [duration] [num_scrapers]
+ *
+ * Client ULTs send "sum" RPCs to a server in the same process at a
+ * fixed total rate (requests per second, 2000 by default) for a given
+ * duration (in seconds, 5 by default). The latency of a request is
+ * measured from the time it was scheduled to be sent, so that a slow
+ * server does not lower the load it sees. The service runs in three
+ * configurations, each in its own process:
+ *  - "none": without MDCS;
+ *  - "instrumented": the RPC is registered with MDCS_REGISTER and its
+ *    handler pushes into a counter;
+ *  - "scraped": as "instrumented", while num_scrapers ULTs (4 by default)
+ *    of another execution stream list and fetch all the counters
+ *    in a loop, without pausing.
+ * The p50 and p99 latencies of each configuration are reported,
+ * along with the difference of its p99 with that of "none".
+ */
+
+#define DEFAULT_RATE         2000.0
+#define DEFAULT_DURATION     5.0
+#define DEFAULT_NUM_SCRAPERS 4
+#define NUM_CLIENTS          4
+
+MERCURY_GEN_PROC(sum_in_t,
+	((int32_t)(x))\
+	((int32_t)(y)))
+
+MERCURY_GEN_PROC(sum_out_t, ((int32_t)(ret)))
+
+typedef enum {
+	CONFIG_NONE,
+	CONFIG_INSTRUMENTED,
+	CONFIG_SCRAPED,
+	NUM_CONFIGS
+} interference_config_t;
+
+static const char* config_names[NUM_CONFIGS] = {
+	"none",
+	"instrumented",
+	"scraped"
+};
+
+typedef struct {
+	double p50;      // median latency, in seconds
+	double p99;      // 99th percentile latency, in seconds
+	size_t requests; // number of requests completed
+	size_t errors;   // number of requests that failed
+} interference_result_t;
+
+static mdcs_counter_t sum_values = MDCS_COUNTER_NULL;
+
+static hg_return_t sum(hg_handle_t h)
+{
+	sum_in_t in;
+	sum_out_t out;
+
+	hg_return_t ret = margo_get_input(h, &in);
+	if(ret == HG_SUCCESS) {
+		out.ret = in.x + in.y;
+		if(sum_values != MDCS_COUNTER_NULL) {
+			int64_t v = out.ret;
+			mdcs_counter_push(sum_values, &v);
+		}
+		margo_respond(h, &out);
+		margo_free_input(h, &in);
+	}
+	margo_destroy(h);
+	return ret;
+}
+DECLARE_MARGO_RPC_HANDLER(sum)
+DEFINE_MARGO_RPC_HANDLER(sum)
+
+typedef struct {
+	margo_instance_id mid;          // Margo instance
+	hg_addr_t         addr;         // address of the server
+	hg_id_t           rpc_id;       // id of the "sum" RPC
+	double            interval;     // time between two requests of the client
+	size_t            num_requests; // number of requests to send
+	double*           latencies;    // latency of each request, in seconds
+	size_t            errors;       // number of requests that failed
+} client_ult_arg_t;
+
+static void client_ult(void* arg)
+{
+	client_ult_arg_t* a = (client_ult_arg_t*)arg;
+	mdcs_timer_t start = mdcs_timer_start();
+	size_t i;
+
+	for(i=0; i < a->num_requests; i++) {
+		double scheduled = i * a->interval;
+		double now = mdcs_timer_elapsed(start);
+		if(now < scheduled)
+			margo_thread_sleep(a->mid, (scheduled - now)*1000.0);
+
+		hg_handle_t h = HG_HANDLE_NULL;
+		sum_in_t in = { .x = (int32_t)i, .y = 1 };
+		sum_out_t out;
+		hg_return_t ret = margo_create(a->mid, a->addr, a->rpc_id, &h);
+		if(ret == HG_SUCCESS) ret = margo_forward(h, &in);
+		if(ret == HG_SUCCESS) ret = margo_get_output(h, &out);
+		if(ret == HG_SUCCESS) margo_free_output(h, &out);
+		else a->errors += 1;
+		if(h != HG_HANDLE_NULL) margo_destroy(h);
+
+		a->latencies[i] = mdcs_timer_elapsed(start) - scheduled;
+	}
+}
+
+typedef struct {
+	hg_addr_t    addr; // address of the server
+	volatile int stop; // set to 1 to stop the scraper
+} scraper_ult_arg_t;
+
+static void scraper_ult(void* arg)
+{
+	scraper_ult_arg_t* a = (scraper_ult_arg_t*)arg;
+	char* value = NULL;
+	size_t value_capacity = 0;
+	size_t i;
+
+	while(!__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+		mdcs_counter_info_t* infos = NULL;
+		size_t num_infos = 0;
+		int more = 0;
+
+		if(mdcs_remote_counter_list(a->addr, "", NULL, 0,
+				&infos, &num_infos, &more) != MDCS_SUCCESS)
+			continue;
+
+		for(i=0; i < num_infos; i++) {
+			size_t slots = infos[i].num_slots == 0 ? 1 : infos[i].num_slots;
+			size_t size = slots * infos[i].value_size;
+			if(size > value_capacity) {
+				free(value);
+				value = (char*)malloc(size);
+				value_capacity = value ? size : 0;
+				if(value == NULL) continue;
+			}
+			if(infos[i].num_slots == 0)
+				mdcs_remote_counter_fetch(a->addr, infos[i].id, value, size);
+			else
+				mdcs_remote_counter_fetch_slots(a->addr, infos[i].id,
+						0, slots, value, size);
+		}
+
+		free(infos);
+	}
+
+	free(value);
+}
+
+/**
+ * Runs the service in the given configuration.
+ */
+static int run_config(interference_config_t config, const char* protocol,
+		double rate, double duration, size_t num_scrapers,
+		interference_result_t* result)
+{
+	size_t i;
+	int ret;
+	hg_addr_t addr = HG_ADDR_NULL;
+	hg_id_t rpc_id;
+	ABT_xstream xstream, scraper_xstream = ABT_XSTREAM_NULL;
+	ABT_pool pool, scraper_pool = ABT_POOL_NULL;
+
+	// a progress thread and handler xstreams keep the
+	// server side off the xstream running the clients
+	margo_instance_id mid = margo_init(protocol, MARGO_SERVER_MODE, 1, 2);
+	if(mid == MARGO_INSTANCE_NULL) return -1;
+
+	if(config == CONFIG_NONE) {
+		rpc_id = MARGO_REGISTER(mid, "sum", sum_in_t, sum_out_t, sum);
+	} else {
+		ret = mdcs_init(mid, MDCS_TRUE, ABT_POOL_NULL);
+		assert(ret == MDCS_SUCCESS);
+		ret = mdcs_counter_register("bench:sum:values", MDCS_COUNTER_STAT_INT64, 0, &sum_values);
+		assert(ret == MDCS_SUCCESS);
+		rpc_id = MDCS_REGISTER(mid, "sum", sum_in_t, sum_out_t, sum);
+	}
+
+	margo_addr_self(mid, &addr);
+
+	size_t per_client = (size_t)(rate * duration / NUM_CLIENTS);
+	if(per_client == 0) per_client = 1;
+	size_t total = per_client * NUM_CLIENTS;
+
+	client_ult_arg_t* clients = (client_ult_arg_t*)calloc(NUM_CLIENTS, sizeof(*clients));
+	ABT_thread* client_threads = (ABT_thread*)calloc(NUM_CLIENTS, sizeof(ABT_thread));
+	double* latencies = (double*)malloc(total*sizeof(double));
+	scraper_ult_arg_t scraper_arg = { addr, 0 };
+	ABT_thread* scraper_threads = (ABT_thread*)calloc(num_scrapers + 1, sizeof(ABT_thread));
+	assert(clients && client_threads && latencies && scraper_threads);
+
+	if(config == CONFIG_SCRAPED) {
+		ret = ABT_xstream_create(ABT_SCHED_NULL, &scraper_xstream);
+		assert(ret == ABT_SUCCESS);
+		ABT_xstream_get_main_pools(scraper_xstream, 1, &scraper_pool);
+		for(i=0; i < num_scrapers; i++) {
+			ret = ABT_thread_create(scraper_pool, scraper_ult, &scraper_arg,
+					ABT_THREAD_ATTR_NULL, &scraper_threads[i]);
+			assert(ret == ABT_SUCCESS);
+		}
+	}
+
+	ABT_xstream_self(&xstream);
+	ABT_xstream_get_main_pools(xstream, 1, &pool);
+
+	for(i=0; i < NUM_CLIENTS; i++) {
+		clients[i].mid = mid;
+		clients[i].addr = addr;
+		clients[i].rpc_id = rpc_id;
+		clients[i].interval = NUM_CLIENTS / rate;
+		clients[i].num_requests = per_client;
+		clients[i].latencies = latencies + i*per_client;
+		ret = ABT_thread_create(pool, client_ult, &clients[i],
+				ABT_THREAD_ATTR_NULL, &client_threads[i]);
+		assert(ret == ABT_SUCCESS);
+	}
+
+	result->errors = 0;
+	for(i=0; i < NUM_CLIENTS; i++) {
+		ABT_thread_join(client_threads[i]);
+		ABT_thread_free(&client_threads[i]);
+		result->errors += clients[i].errors;
+	}
+
+	if(config == CONFIG_SCRAPED) {
+		__atomic_store_n(&scraper_arg.stop, 1, __ATOMIC_RELEASE);
+		for(i=0; i < num_scrapers; i++) {
+			ABT_thread_join(scraper_threads[i]);
+			ABT_thread_free(&scraper_threads[i]);
+		}
+		ABT_xstream_join(scraper_xstream);
+		ABT_xstream_free(&scraper_xstream);
+	}
+
+	bench_sort(latencies, total);
+	result->p50 = bench_percentile(latencies, total, 50.0);
+	result->p99 = bench_percentile(latencies, total, 99.0);
+	result->requests = total;
+
+	free(scraper_threads);
+	free(latencies);
+	free(client_threads);
+	free(clients);
+
+	margo_addr_free(mid, addr);
+	if(config != CONFIG_NONE) mdcs_finalize();
+	margo_finalize(mid);
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	double rate = DEFAULT_RATE;
+	double duration = DEFAULT_DURATION;
+	size_t num_scrapers = DEFAULT_NUM_SCRAPERS;
+	interference_result_t results[NUM_CONFIGS];
+	size_t i;
+
+	if(argc > 2) rate = atof(argv[2]);
+	if(argc > 3) duration = atof(argv[3]);
+	if(argc > 4) num_scrapers = strtoul(argv[4], NULL, 10);
+	if(argc < 2 || rate <= 0.0 || duration <= 0.0) {
+		fprintf(stderr, "usage: %s <protocol> [rate] [duration] [num_scrapers]\n", argv[0]);
+		return 1;
+	}
+
+	// each configuration runs in its own process, so that
+	// Margo and MDCS start from a clean state every time
+	for(i=0; i < NUM_CONFIGS; i++) {
+		int fds[2];
+		int status;
+		if(pipe(fds) != 0) {
+			perror("pipe");
+			return 1;
+		}
+		pid_t pid = fork();
+		if(pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if(pid == 0) {
+			close(fds[0]);
+			interference_result_t r;
+			int ret = run_config((interference_config_t)i, argv[1],
+					rate, duration, num_scrapers, &r);
+			if(ret == 0 && write(fds[1], &r, sizeof(r)) != sizeof(r)) ret = -1;
+			close(fds[1]);
+			_exit(ret == 0 ? 0 : 1);
+		}
+		close(fds[1]);
+		ssize_t n = read(fds[0], &results[i], sizeof(results[i]));
+		close(fds[0]);
+		waitpid(pid, &status, 0);
+		if(n != sizeof(results[i]) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "Configuration \"%s\" failed\n", config_names[i]);
+			return 1;
+		}
+	}
+
+	printf("{\n");
+	printf("  \"benchmark\": \"interference\",\n");
+	printf("  \"rate\": %.1f,\n", rate);
+	printf("  \"duration\": %.1f,\n", duration);
+	printf("  \"num_scrapers\": %zu,\n", num_scrapers);
+	printf("  \"results\": [\n");
+	for(i=0; i < NUM_CONFIGS; i++) {
+		double delta = results[i].p99 - results[CONFIG_NONE].p99;
+		printf("    { \"config\": \"%s\", \"requests\": %zu, \"errors\": %zu, "
+			"\"p50_us\": %.3f, \"p99_us\": %.3f, "
+			"\"p99_delta_us\": %.3f, \"p99_delta_pct\": %.2f }%s\n",
+			config_names[i], results[i].requests, results[i].errors,
+			results[i].p50*1e6, results[i].p99*1e6,
+			delta*1e6, delta/results[CONFIG_NONE].p99*100.0,
+			i+1 < NUM_CONFIGS ? "," : "");
+	}
+	printf("  ]\n}\n");
+
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <abt.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-timer.h>
+#include "bench-util.h"
+
+/*
+ * Measures the cost of pushing into every built-in counter type,
+ * without any network, and prints the results as JSON on stdout.
+ *
+ * usage: mdcs-bench-push [num_items]
+ *
+ * Each type is measured with buffers of 0, 16, 1k, and 64k items,
+ * pushing one item at a time (mode "push", which goes through
+ * push_one_f when unbuffered and through the digest when buffered),
+ * and pushing batches of as many items as the buffer would hold
+ * (mode "push_multi", which goes through push_multi_f). Lock-free
+ * types cannot have a buffer, so only their batches are measured
+ * for non-zero sizes.
+ */
+
+#define DEFAULT_NUM_ITEMS (1 << 20)
+
+typedef void (*fill_f)(void* items, size_t num);
+
+typedef struct {
+	const char*          name;      // name of the type in the results
+	mdcs_counter_type_t* type;      // built-in type
+	size_t               item_size; // size of an item
+	fill_f               fill;      // generates items of the type
+	int                  lock_free; // type cannot have a buffer
+} bench_type_t;
+
+static void fill_double(void* items, size_t num)
+{
+	size_t i;
+	double* d = (double*)items;
+	for(i=0; i < num; i++)
+		d[i] = (double)rand()/RAND_MAX * 1e-3;
+}
+
+static void fill_int64(void* items, size_t num)
+{
+	size_t i;
+	int64_t* v = (int64_t*)items;
+	for(i=0; i < num; i++)
+		v[i] = rand() % 1000;
+}
+
+static void fill_ones(void* items, size_t num)
+{
+	size_t i;
+	uint64_t* v = (uint64_t*)items;
+	for(i=0; i < num; i++)
+		v[i] = 1;
+}
+
+static void fill_updown(void* items, size_t num)
+{
+	size_t i;
+	int64_t* v = (int64_t*)items;
+	for(i=0; i < num; i++)
+		v[i] = (i % 2) ? -1 : 1;
+}
+
+static void fill_hash(void* items, size_t num)
+{
+	size_t i;
+	uint64_t* v = (uint64_t*)items;
+	for(i=0; i < num; i++)
+		v[i] = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+}
+
+static void fill_topk(void* items, size_t num)
+{
+	size_t i;
+	mdcs_counter_topk_item_t* v = (mdcs_counter_topk_item_t*)items;
+	for(i=0; i < num; i++) {
+		// a few heavy keys among many light ones
+		v[i].key = (rand() % 4) ? (uint64_t)(rand() % 100000) : (uint64_t)(rand() % 8);
+		v[i].weight = 1;
+	}
+}
+
+static void fill_covariance(void* items, size_t num)
+{
+	size_t i;
+	mdcs_counter_covariance_item_t* v = (mdcs_counter_covariance_item_t*)items;
+	for(i=0; i < num; i++) {
+		v[i].x = (double)rand()/RAND_MAX;
+		v[i].y = 2.0*v[i].x + (double)rand()/RAND_MAX;
+	}
+}
+
+static bench_type_t bench_types[] = {
+	{ "LAST_DOUBLE",      &MDCS_COUNTER_LAST_DOUBLE,      sizeof(double),   fill_double, 0 },
+	{ "LAST_INT64",       &MDCS_COUNTER_LAST_INT64,       sizeof(int64_t),  fill_int64, 0 },
+	{ "STAT_DOUBLE",      &MDCS_COUNTER_STAT_DOUBLE,      sizeof(double),   fill_double, 0 },
+	{ "STAT_INT64",       &MDCS_COUNTER_STAT_INT64,       sizeof(int64_t),  fill_int64, 0 },
+	{ "RATE",             &MDCS_COUNTER_RATE,             sizeof(uint64_t), fill_ones, 0 },
+	{ "WINDOW_DOUBLE",    &MDCS_COUNTER_WINDOW_DOUBLE,    sizeof(double),   fill_double, 0 },
+	{ "HLL",              &MDCS_COUNTER_HLL,              sizeof(uint64_t), fill_hash, 0 },
+	{ "TOPK",             &MDCS_COUNTER_TOPK,             sizeof(mdcs_counter_topk_item_t), fill_topk, 0 },
+	{ "RESERVOIR_DOUBLE", &MDCS_COUNTER_RESERVOIR_DOUBLE, sizeof(double),   fill_double, 0 },
+	{ "COVARIANCE",       &MDCS_COUNTER_COVARIANCE,       sizeof(mdcs_counter_covariance_item_t), fill_covariance, 0 },
+	{ "ATOMIC",           &MDCS_COUNTER_ATOMIC,           sizeof(uint64_t), fill_ones, 1 },
+	{ "HISTOGRAM",        &MDCS_COUNTER_HISTOGRAM,        sizeof(double),   fill_double, 0 },
+	{ "GAUGE",            &MDCS_COUNTER_GAUGE,            sizeof(int64_t),  fill_updown, 0 }
+};
+
+static const size_t buffer_sizes[] = { 0, 16, 1024, 65536 };
+
+#define NUM_TYPES        (sizeof(bench_types)/sizeof(bench_types[0]))
+#define NUM_BUFFER_SIZES (sizeof(buffer_sizes)/sizeof(buffer_sizes[0]))
+
+/**
+ * Pushes num items one at a time, digesting the
+ * buffer at the end. Returns the elapsed time.
+ */
+static double run_push(mdcs_counter_t counter, const char* items,
+		size_t item_size, size_t num)
+{
+	size_t i;
+	mdcs_timer_t timer = mdcs_timer_start();
+	for(i=0; i < num; i++) {
+		mdcs_counter_push(counter, items + i*item_size);
+	}
+	mdcs_counter_digest(counter);
+	return mdcs_timer_elapsed(timer);
+}
+
+/**
+ * Pushes num items in batches of batch items. Returns the elapsed time.
+ */
+static double run_push_multi(mdcs_counter_t counter, const char* items,
+		size_t item_size, size_t num, size_t batch)
+{
+	size_t i;
+	mdcs_timer_t timer = mdcs_timer_start();
+	for(i=0; i < num; i += batch) {
+		size_t n = (num - i < batch) ? num - i : batch;
+		mdcs_counter_push_multi(counter, items + i*item_size, n);
+	}
+	return mdcs_timer_elapsed(timer);
+}
+
+int main(int argc, char** argv)
+{
+	size_t num_items = DEFAULT_NUM_ITEMS;
+	size_t i, j;
+	int first = 1;
+
+	if(argc > 1) num_items = strtoul(argv[1], NULL, 10);
+	if(num_items == 0) {
+		fprintf(stderr, "usage: %s [num_items]\n", argv[0]);
+		return 1;
+	}
+
+	srand(42);
+
+	ABT_init(argc, argv);
+
+	int ret = mdcs_init(MARGO_INSTANCE_NULL, MDCS_FALSE, ABT_POOL_NULL);
+	assert(ret == MDCS_SUCCESS);
+
+	printf("{\n");
+	printf("  \"benchmark\": \"push\",\n");
+	printf("  \"num_items\": %zu,\n", num_items);
+	printf("  \"results\": [\n");
+
+	for(i=0; i < NUM_TYPES; i++) {
+		bench_type_t* bt = &bench_types[i];
+
+		char* items = (char*)malloc(num_items * bt->item_size);
+		assert(items != NULL);
+		bt->fill(items, num_items);
+
+		for(j=0; j < NUM_BUFFER_SIZES; j++) {
+			size_t bsize = buffer_sizes[j];
+			mdcs_counter_t counter = MDCS_COUNTER_NULL;
+			char name[128];
+			double t;
+
+			if(bsize == 0 || !bt->lock_free) {
+				sprintf(name, "bench:%s:push:%zu", bt->name, bsize);
+				ret = mdcs_counter_register(name, *(bt->type), bsize, &counter);
+				assert(ret == MDCS_SUCCESS);
+
+				// warm-up run, then the measured one
+				run_push(counter, items, bt->item_size, num_items/10);
+				mdcs_counter_reset(counter);
+				t = run_push(counter, items, bt->item_size, num_items);
+				bench_print_result(&first, bt->name, "push", bsize, num_items, t);
+			}
+
+			if(bsize == 0) continue;
+
+			sprintf(name, "bench:%s:push_multi:%zu", bt->name, bsize);
+			ret = mdcs_counter_register(name, *(bt->type), 0, &counter);
+			assert(ret == MDCS_SUCCESS);
+
+			run_push_multi(counter, items, bt->item_size, num_items/10, bsize);
+			mdcs_counter_reset(counter);
+			t = run_push_multi(counter, items, bt->item_size, num_items, bsize);
+			bench_print_result(&first, bt->name, "push_multi", bsize, num_items, t);
+		}
+
+		free(items);
+	}
+
+	printf("\n  ]\n}\n");
+
+	mdcs_finalize();
+	ABT_finalize();
+
+	return 0;
+}
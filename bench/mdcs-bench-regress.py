@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2017 UChicago Argonne, LLC
+#
+# See COPYRIGHT in top-level directory.
+#
+# Runs the MDCS push and fetch benchmarks several times, writes the results
+# as JSON keyed by git revision, and compares them with a reference: the
+# results stored for the closest ancestor revision that was measured on the
+# same machine, or a baseline file if one is provided and was recorded on
+# this machine. Results recorded on another machine are never compared with,
+# since costs depend on the CPU; the check then passes with a warning, as it
+# does when no reference exists yet (e.g. on the first run on a machine).
+#
+# For each metric (the cost of a push in nanoseconds, the median latency of
+# a fetch in microseconds), the median of the runs and a 95% bootstrap
+# confidence interval of that median are computed. A metric regresses when
+# its median exceeds the baseline's by more than the threshold AND its
+# confidence interval lies entirely above the baseline's, so that noise
+# alone does not fail the check. The script exits with a non-zero status
+# if any metric regresses.
+#
+# usage: mdcs-bench-regress.py --bench-dir DIR [--baseline FILE] [options]
+#        (--update-baseline writes the current results as the new baseline)
+
+import argparse
+import json
+import os
+import platform
+import random
+import subprocess
+import sys
+
+BOOTSTRAP_SAMPLES = 2000
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    if n % 2:
+        return s[n // 2]
+    return 0.5 * (s[n // 2 - 1] + s[n // 2])
+
+
+def bootstrap_ci(values, confidence=0.95):
+    """Confidence interval of the median, by resampling the runs."""
+    if len(values) < 2:
+        return values[0], values[0]
+    rng = random.Random(42)
+    medians = sorted(
+        median([rng.choice(values) for _ in values])
+        for _ in range(BOOTSTRAP_SAMPLES))
+    lo = int((1.0 - confidence) / 2.0 * BOOTSTRAP_SAMPLES)
+    hi = BOOTSTRAP_SAMPLES - 1 - lo
+    return medians[lo], medians[hi]
+
+
+def run_json(cmd):
+    out = subprocess.run(cmd, check=True, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout
+    return json.loads(out)
+
+
+def push_metrics(bench_dir, num_items):
+    """Cost of a push, in nanoseconds, for each type, mode and buffer size."""
+    res = run_json([os.path.join(bench_dir, "mdcs-bench-push"), str(num_items)])
+    return {"push/%s/%s/%d" % (r["type"], r["mode"], r["buffer"]): r["ns_per_push"]
+            for r in res["results"]}
+
+
+def fetch_metrics(bench_dir, protocol, num_fetches):
+    """Median latency of a fetch, in microseconds, for each case."""
+    res = run_json([os.path.join(bench_dir, "mdcs-bench-fetch"),
+                    protocol, str(num_fetches)])
+    return {"fetch/%s/%d/%d" % (r["mode"], r["slots"], r["concurrency"]): r["p50_us"]
+            for r in res["results"]}
+
+
+def git(source_dir, *args):
+    return subprocess.run(["git", "-C", source_dir] + list(args),
+                          check=True, stdout=subprocess.PIPE,
+                          universal_newlines=True).stdout.strip()
+
+
+def git_revision(source_dir):
+    """Returns (short revision, full commit hash, whether the tree is dirty)."""
+    try:
+        commit = git(source_dir, "rev-parse", "HEAD")
+        rev = git(source_dir, "rev-parse", "--short", "HEAD")
+        dirty = bool(git(source_dir, "status", "--porcelain", "--untracked-files=no"))
+        return rev + ("-dirty" if dirty else ""), commit, dirty
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown", None, True
+
+
+def git_ancestors(source_dir, max_count=200):
+    """Full hashes of HEAD and its ancestors, closest first."""
+    try:
+        return git(source_dir, "rev-list", "--max-count=%d" % max_count, "HEAD").split()
+    except (OSError, subprocess.CalledProcessError):
+        return []
+
+
+def host_info():
+    """Identifies the machine, since results only compare on the same one."""
+    cpu = platform.processor()
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    return {"hostname": platform.node(), "cpu": cpu, "cpus": os.cpu_count()}
+
+
+def load_json(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+def find_reference(args, commit, dirty, host):
+    """Returns the results to compare with and a description of them, or (None, None)."""
+    if args.baseline:
+        baseline = load_json(args.baseline)
+        if baseline is None or not baseline.get("metrics"):
+            print("Warning: baseline %s is missing or empty" % args.baseline, file=sys.stderr)
+        elif baseline.get("host") != host:
+            print("Warning: baseline %s was recorded on %s, not on this machine (%s),"
+                  " ignoring it" % (args.baseline, baseline.get("host"), host), file=sys.stderr)
+        else:
+            return baseline, "baseline %s" % baseline.get("revision", "unknown")
+
+    # results of committed revisions measured on this machine, by commit;
+    # revisions that regressed are not references, or the next would pass
+    stored = {}
+    for name in os.listdir(args.output_dir):
+        if not name.endswith(".json"):
+            continue
+        res = load_json(os.path.join(args.output_dir, name))
+        if (res and res.get("commit") and not res.get("dirty")
+                and not res.get("regressions") and res.get("host") == host):
+            stored[res["commit"]] = res
+
+    for ancestor in git_ancestors(args.source_dir):
+        # the results of a clean HEAD are the ones being compared
+        if ancestor == commit and not dirty:
+            continue
+        if ancestor in stored:
+            return stored[ancestor], "revision %s" % stored[ancestor]["revision"]
+    return None, None
+
+
+def summarize(runs):
+    """Turns a list of {metric: value} dicts into {metric: statistics}."""
+    metrics = {}
+    for key in sorted(runs[0]):
+        values = [r[key] for r in runs if key in r]
+        lo, hi = bootstrap_ci(values)
+        metrics[key] = {"median": median(values), "ci_low": lo, "ci_high": hi,
+                        "runs": values}
+    return metrics
+
+
+def compare(current, baseline, threshold):
+    """Returns the list of regressed metrics, printing a report on stderr."""
+    regressions = []
+    for key, cur in sorted(current.items()):
+        base = baseline.get(key)
+        if base is None:
+            print("  %-48s %12.3f  (no baseline)" % (key, cur["median"]), file=sys.stderr)
+            continue
+        if base["median"] <= 0:
+            print("  %-48s %12.3f  (baseline is zero)" % (key, cur["median"]), file=sys.stderr)
+            continue
+        change = (cur["median"] - base["median"]) / base["median"] * 100.0
+        regressed = (change > threshold and cur["ci_low"] > base["ci_high"])
+        print("  %-48s %12.3f  %+7.2f%%%s" % (key, cur["median"], change,
+              "  REGRESSION" if regressed else ""), file=sys.stderr)
+        if regressed:
+            regressions.append(key)
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Runs the MDCS benchmarks and compares them with earlier results.")
+    parser.add_argument("--bench-dir", required=True,
+                        help="directory containing the benchmark executables")
+    parser.add_argument("--baseline",
+                        help="baseline JSON file to compare with, if recorded on this machine")
+    parser.add_argument("--output-dir", default=".",
+                        help="directory where <revision>.json is written, and where"
+                             " the results of earlier revisions are looked up")
+    parser.add_argument("--source-dir", default=os.path.dirname(os.path.abspath(__file__)),
+                        help="git working tree giving the revision")
+    parser.add_argument("--protocol", default="na+sm",
+                        help="transport of the fetch benchmark ('' to skip it)")
+    parser.add_argument("--repeat", type=int, default=5,
+                        help="number of runs of each benchmark")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="regression threshold, in percent")
+    parser.add_argument("--push-items", type=int, default=1 << 20)
+    parser.add_argument("--fetch-count", type=int, default=2000)
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="write the results as the new baseline")
+    args = parser.parse_args()
+
+    runs = []
+    for _ in range(args.repeat):
+        metrics = push_metrics(args.bench_dir, args.push_items)
+        if args.protocol:
+            metrics.update(fetch_metrics(args.bench_dir, args.protocol, args.fetch_count))
+        runs.append(metrics)
+
+    revision, commit, dirty = git_revision(args.source_dir)
+    host = host_info()
+    result = {"revision": revision, "commit": commit, "dirty": dirty, "host": host,
+              "repeat": args.repeat, "metrics": summarize(runs)}
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    reference, description = find_reference(args, commit, dirty, host)
+
+    if args.update_baseline:
+        if not args.baseline:
+            print("--update-baseline requires --baseline", file=sys.stderr)
+            return 1
+        with open(args.baseline, "w") as f:
+            json.dump(result, f, indent=2, sort_keys=True)
+        print("Baseline updated", file=sys.stderr)
+    elif reference is None:
+        print("Warning: no earlier results from this machine to compare with;"
+              " these results are the reference for later revisions", file=sys.stderr)
+    else:
+        print("Comparing with %s (threshold %.1f%%):"
+              % (description, args.threshold), file=sys.stderr)
+        result["regressions"] = compare(result["metrics"], reference.get("metrics", {}),
+                                        args.threshold)
+
+    path = os.path.join(args.output_dir, revision + ".json")
+    with open(path, "w") as f:
+        json.dump(result, f, indent=2, sort_keys=True)
+    print("Results of %s written to %s" % (revision, path), file=sys.stderr)
+
+    regressions = result.get("regressions")
+    if regressions:
+        print("%d metric(s) regressed" % len(regressions), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
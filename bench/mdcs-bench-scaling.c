@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <abt.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-timer.h>
+
+/*
+ * Measures how pushes scale with the number of Argobots execution
+ * streams, and prints the results as JSON on stdout.
+ *
+ * usage: mdcs-bench-scaling [max_xstreams] [ults_per_xstream] [pushes_per_ult]
+ *
+ * The number of execution streams K goes through the powers of two
+ * up to max_xstreams, and max_xstreams itself. max_xstreams defaults to
+ * the number of cores minus one, since the primary execution stream,
+ * which starts the ULTs and waits for them, runs alongside the K others.
+ * The K execution streams are created before, and joined after, the
+ * runs with K, so that idle execution streams do not compete for cores
+ * with the ones being measured. For each K, the ULTs push into:
+ *  - "shared_atomic": a single atomic counter with a cache line per ULT;
+ *  - "shared_locked": a single STAT_DOUBLE counter protected by a mutex;
+ *  - "private": a STAT_DOUBLE counter per ULT;
+ *  - "private_buffered": a STAT_DOUBLE counter per ULT, with a buffer;
+ *  - "vector_slots": a slot per ULT of a STAT_DOUBLE vector counter,
+ *    where neighbouring slots may share cache lines.
+ */
+
+#define DEFAULT_ULTS_PER_XSTREAM 1
+#define DEFAULT_PUSHES_PER_ULT   (1 << 20)
+#define PRIVATE_BUFFER_SIZE      1024
+#define MAX_ATOMIC_SLOTS         4096
+
+typedef enum {
+	SHARED_ATOMIC,
+	SHARED_LOCKED,
+	PRIVATE,
+	PRIVATE_BUFFERED,
+	VECTOR_SLOTS,
+	NUM_MODES
+} scaling_mode_t;
+
+static const char* mode_names[NUM_MODES] = {
+	"shared_atomic",
+	"shared_locked",
+	"private",
+	"private_buffered",
+	"vector_slots"
+};
+
+typedef struct {
+	scaling_mode_t mode;       // what the ULT pushes into
+	mdcs_counter_t counter;    // counter to push into
+	size_t         slot;       // slot of the vector counter
+	ABT_mutex      mutex;      // mutex protecting a shared counter
+	size_t         num_pushes; // number of pushes to do
+	volatile int*  go;         // set to 1 when all the ULTs are ready
+} scaling_ult_arg_t;
+
+static void scaling_ult(void* arg)
+{
+	scaling_ult_arg_t* a = (scaling_ult_arg_t*)arg;
+	size_t i;
+	double d = 1.0;
+	uint64_t one = 1;
+
+	while(!__atomic_load_n(a->go, __ATOMIC_ACQUIRE))
+		ABT_thread_yield();
+
+	switch(a->mode) {
+	case SHARED_ATOMIC:
+		for(i=0; i < a->num_pushes; i++)
+			mdcs_counter_push(a->counter, &one);
+		break;
+	case SHARED_LOCKED:
+		for(i=0; i < a->num_pushes; i++) {
+			ABT_mutex_lock(a->mutex);
+			mdcs_counter_push(a->counter, &d);
+			ABT_mutex_unlock(a->mutex);
+		}
+		break;
+	case PRIVATE:
+	case PRIVATE_BUFFERED:
+		for(i=0; i < a->num_pushes; i++)
+			mdcs_counter_push(a->counter, &d);
+		mdcs_counter_digest(a->counter);
+		break;
+	case VECTOR_SLOTS:
+		for(i=0; i < a->num_pushes; i++)
+			mdcs_counter_vector_push(a->counter, a->slot, &d);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Runs one mode on the given execution streams and returns the elapsed time.
+ */
+static double run_mode(scaling_mode_t mode, ABT_pool* pools, size_t num_xstreams,
+		size_t ults_per_xstream, size_t num_pushes, unsigned run)
+{
+	size_t i;
+	size_t num_ults = num_xstreams * ults_per_xstream;
+	mdcs_counter_t shared = MDCS_COUNTER_NULL;
+	mdcs_counter_type_t atomic_type = MDCS_COUNTER_TYPE_NULL;
+	ABT_mutex mutex = ABT_MUTEX_NULL;
+	volatile int go = 0;
+	char name[128];
+	int ret;
+
+	scaling_ult_arg_t* args = (scaling_ult_arg_t*)calloc(num_ults, sizeof(*args));
+	ABT_thread* threads = (ABT_thread*)calloc(num_ults, sizeof(*threads));
+	assert(args != NULL && threads != NULL);
+
+	sprintf(name, "bench:scaling:%u:%s", run, mode_names[mode]);
+	switch(mode) {
+	case SHARED_ATOMIC:
+		ret = mdcs_counter_type_atomic_create(
+				num_ults < MAX_ATOMIC_SLOTS ? num_ults : MAX_ATOMIC_SLOTS, &atomic_type);
+		if(ret == MDCS_SUCCESS)
+			ret = mdcs_counter_register(name, atomic_type, 0, &shared);
+		break;
+	case SHARED_LOCKED:
+		ret = mdcs_counter_register(name, MDCS_COUNTER_STAT_DOUBLE, 0, &shared);
+		ABT_mutex_create(&mutex);
+		break;
+	case VECTOR_SLOTS:
+		ret = mdcs_counter_vector_register(name, MDCS_COUNTER_STAT_DOUBLE, num_ults, &shared);
+		break;
+	default:
+		ret = MDCS_SUCCESS;
+		break;
+	}
+	assert(ret == MDCS_SUCCESS);
+
+	for(i=0; i < num_ults; i++) {
+		args[i].mode = mode;
+		args[i].counter = shared;
+		args[i].slot = i;
+		args[i].mutex = mutex;
+		args[i].num_pushes = num_pushes;
+		args[i].go = &go;
+		if(mode == PRIVATE || mode == PRIVATE_BUFFERED) {
+			sprintf(name, "bench:scaling:%u:%s:%zu", run, mode_names[mode], i);
+			ret = mdcs_counter_register(name, MDCS_COUNTER_STAT_DOUBLE,
+					mode == PRIVATE ? 0 : PRIVATE_BUFFER_SIZE, &args[i].counter);
+			assert(ret == MDCS_SUCCESS);
+		}
+	}
+
+	// ULTs are spread round-robin over the execution streams
+	for(i=0; i < num_ults; i++) {
+		ret = ABT_thread_create(pools[i % num_xstreams], scaling_ult, &args[i],
+				ABT_THREAD_ATTR_NULL, &threads[i]);
+		assert(ret == ABT_SUCCESS);
+	}
+
+	mdcs_timer_t timer = mdcs_timer_start();
+	__atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+	for(i=0; i < num_ults; i++) {
+		ABT_thread_join(threads[i]);
+		ABT_thread_free(&threads[i]);
+	}
+	double elapsed = mdcs_timer_elapsed(timer);
+
+	if(mutex != ABT_MUTEX_NULL) ABT_mutex_free(&mutex);
+	// the counter holds its own reference on the type
+	mdcs_counter_type_destroy(atomic_type);
+	free(threads);
+	free(args);
+
+	return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+	long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_xstreams = num_cores > 1 ? (size_t)(num_cores - 1) : 1;
+	size_t ults_per_xstream = DEFAULT_ULTS_PER_XSTREAM;
+	size_t num_pushes = DEFAULT_PUSHES_PER_ULT;
+	size_t i, k;
+	unsigned run = 0;
+	int first = 1;
+	int ret;
+
+	if(argc > 1) max_xstreams = strtoul(argv[1], NULL, 10);
+	if(argc > 2) ults_per_xstream = strtoul(argv[2], NULL, 10);
+	if(argc > 3) num_pushes = strtoul(argv[3], NULL, 10);
+	if(max_xstreams == 0 || ults_per_xstream == 0 || num_pushes == 0) {
+		fprintf(stderr, "usage: %s [max_xstreams] [ults_per_xstream] [pushes_per_ult]\n", argv[0]);
+		return 1;
+	}
+
+	ABT_init(argc, argv);
+
+	ret = mdcs_init(MARGO_INSTANCE_NULL, MDCS_FALSE, ABT_POOL_NULL);
+	assert(ret == MDCS_SUCCESS);
+
+	ABT_xstream* xstreams = (ABT_xstream*)calloc(max_xstreams, sizeof(ABT_xstream));
+	ABT_pool* pools = (ABT_pool*)calloc(max_xstreams, sizeof(ABT_pool));
+	assert(xstreams != NULL && pools != NULL);
+
+	printf("{\n");
+	printf("  \"benchmark\": \"scaling\",\n");
+	printf("  \"ults_per_xstream\": %zu,\n", ults_per_xstream);
+	printf("  \"pushes_per_ult\": %zu,\n", num_pushes);
+	printf("  \"results\": [\n");
+
+	for(k=1; k <= max_xstreams; k = (k < max_xstreams && 2*k > max_xstreams) ? max_xstreams : 2*k) {
+		size_t j;
+		for(j=0; j < k; j++) {
+			ret = ABT_xstream_create(ABT_SCHED_NULL, &xstreams[j]);
+			assert(ret == ABT_SUCCESS);
+			ABT_xstream_get_main_pools(xstreams[j], 1, &pools[j]);
+		}
+		for(i=0; i < NUM_MODES; i++) {
+			double t = run_mode((scaling_mode_t)i, pools, k, ults_per_xstream, num_pushes, run++);
+			double total = (double)k * ults_per_xstream * num_pushes;
+			printf("%s    { \"mode\": \"%s\", \"xstreams\": %zu, "
+				"\"pushes_per_sec\": %.1f, \"pushes_per_sec_per_xstream\": %.1f }",
+				first ? "" : ",\n", mode_names[i], k, total/t, total/t/k);
+			first = 0;
+		}
+		for(j=0; j < k; j++) {
+			ABT_xstream_join(xstreams[j]);
+			ABT_xstream_free(&xstreams[j]);
+		}
+	}
+
+	printf("\n  ]\n}\n");
+
+	free(pools);
+	free(xstreams);
+
+	mdcs_finalize();
+	ABT_finalize();
+
+	return 0;
+}
@@ -16,6 +16,15 @@ extern mdcs_counter_type_t MDCS_COUNTER_LAST_DOUBLE;
 extern mdcs_counter_type_t MDCS_COUNTER_LAST_INT64;
 extern mdcs_counter_type_t MDCS_COUNTER_STAT_DOUBLE;
 extern mdcs_counter_type_t MDCS_COUNTER_STAT_INT64;
+extern mdcs_counter_type_t MDCS_COUNTER_RATE;
+extern mdcs_counter_type_t MDCS_COUNTER_WINDOW_DOUBLE;
+extern mdcs_counter_type_t MDCS_COUNTER_HLL;
+extern mdcs_counter_type_t MDCS_COUNTER_TOPK;
+extern mdcs_counter_type_t MDCS_COUNTER_RESERVOIR_DOUBLE;
+extern mdcs_counter_type_t MDCS_COUNTER_COVARIANCE;
+extern mdcs_counter_type_t MDCS_COUNTER_ATOMIC;
+extern mdcs_counter_type_t MDCS_COUNTER_HISTOGRAM;
+extern mdcs_counter_type_t MDCS_COUNTER_GAUGE;
 
 typedef double mdcs_counter_last_double_item_t;
 typedef double mdcs_counter_last_double_value_t;
@@ -45,6 +54,270 @@ typedef struct {
 	int64_t last;
 } mdcs_counter_stat_int64_value_t;
 
+/*
+ * Rate counters are pushed amounts (e.g. 1 per operation, or a number
+ * of bytes) and track their total as well as their rate per second,
+ * as exponentially-weighted moving averages over several time windows.
+ * MDCS_COUNTER_RATE uses windows of 1, 5 and 15 seconds, other windows
+ * can be used with mdcs_counter_type_rate_create.
+ */
+typedef uint64_t mdcs_counter_rate_item_t;
+
+typedef struct {
+	uint64_t total;
+	double   rate[3];
+} mdcs_counter_rate_value_t;
+
+/* size of the value of a rate counter with n windows: the total
+ * followed by the rate for each window, in the order of the windows */
+#define MDCS_COUNTER_RATE_VALUE_SIZE(n) (sizeof(uint64_t) + (n)*sizeof(double))
+
+/**
+ * Creates a rate counter type with custom windows. The type must be
+ * destroyed with mdcs_counter_type_destroy.
+ *
+ * \param[in] windows Time constants of the moving averages, in seconds.
+ * \param[in] num_windows Number of windows.
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_rate_create(const double* windows, size_t num_windows,
+		mdcs_counter_type_t* type);
+
+/*
+ * Window counters track the same statistics as MDCS_COUNTER_STAT_DOUBLE,
+ * but only over the values pushed during a recent window of time, split
+ * into a ring of buckets: the statistics cover the last num_buckets
+ * sub-intervals of window/num_buckets seconds (including the current,
+ * incomplete one), and no reset is needed to forget old values.
+ * MDCS_COUNTER_WINDOW_DOUBLE uses a 60 seconds window with 12 buckets.
+ */
+typedef double mdcs_counter_window_double_item_t;
+typedef mdcs_counter_stat_double_value_t mdcs_counter_window_double_value_t;
+
+/**
+ * Creates a window counter type with a custom window. The type must be
+ * destroyed with mdcs_counter_type_destroy.
+ *
+ * \param[in] window Duration of the window, in seconds.
+ * \param[in] num_buckets Number of sub-intervals in the window.
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_window_create(double window, size_t num_buckets,
+		mdcs_counter_type_t* type);
+
+/*
+ * HyperLogLog counters estimate the number of distinct keys pushed into
+ * them using 2^precision one-byte registers (the standard error is about
+ * 1.04/sqrt(2^precision)). Keys are 64-bit integers, hashed internally.
+ * MDCS_COUNTER_HLL uses a precision of 12 (4 KB, about 1.6% error),
+ * other precisions can be used with mdcs_counter_type_hll_create.
+ * Values carry the registers, so values fetched from different servers
+ * can be merged with mdcs_counter_type_merge to count distinct keys
+ * across servers.
+ */
+#define MDCS_COUNTER_HLL_PRECISION 12
+
+typedef uint64_t mdcs_counter_hll_item_t;
+
+typedef struct {
+	double   estimate;
+	uint32_t precision;
+	uint32_t reserved;
+	uint8_t  registers[1 << MDCS_COUNTER_HLL_PRECISION];
+} mdcs_counter_hll_value_t;
+
+/* size of the value of a HyperLogLog counter with precision p */
+#define MDCS_COUNTER_HLL_VALUE_SIZE(p) (sizeof(double) + 2*sizeof(uint32_t) + ((size_t)1 << (p)))
+
+/**
+ * Creates a HyperLogLog counter type with a custom precision.
+ * The type must be destroyed with mdcs_counter_type_destroy.
+ *
+ * \param[in] precision Log2 of the number of registers (between 4 and 18).
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_hll_create(unsigned precision, mdcs_counter_type_t* type);
+
+/*
+ * Top-k counters find the heavy hitters among the keys pushed into them.
+ * Each item is a 64-bit key (e.g. a hash of an object name or a tenant id)
+ * with a weight (e.g. 1 per request, or a number of bytes). Weights are
+ * accumulated in a count-min sketch of depth rows and width columns, and
+ * the k keys with the largest estimated weights are kept in a heap.
+ * The value lists these keys sorted by decreasing estimated weight
+ * (estimates can only overcount), followed by the sketch, so that values
+ * fetched from different servers can be merged with mdcs_counter_type_merge.
+ * MDCS_COUNTER_TOPK uses a depth of 4, a width of 1024 and k = 16,
+ * other dimensions can be used with mdcs_counter_type_topk_create.
+ */
+#define MDCS_COUNTER_TOPK_DEPTH 4
+#define MDCS_COUNTER_TOPK_WIDTH 1024
+#define MDCS_COUNTER_TOPK_K     16
+
+typedef struct {
+	uint64_t key;
+	uint64_t weight;
+} mdcs_counter_topk_item_t;
+
+typedef struct {
+	uint64_t key;
+	uint64_t count;
+} mdcs_counter_topk_entry_t;
+
+typedef struct {
+	uint32_t depth;
+	uint32_t width;
+	uint32_t k;
+	uint32_t num_entries;
+	mdcs_counter_topk_entry_t entries[MDCS_COUNTER_TOPK_K];
+	uint64_t sketch[MDCS_COUNTER_TOPK_DEPTH*MDCS_COUNTER_TOPK_WIDTH];
+} mdcs_counter_topk_value_t;
+
+/* size of the value of a top-k counter with the provided dimensions */
+#define MDCS_COUNTER_TOPK_VALUE_SIZE(d,w,k) (4*sizeof(uint32_t) \
+	+ (size_t)(k)*sizeof(mdcs_counter_topk_entry_t) + (size_t)(d)*(w)*sizeof(uint64_t))
+
+/**
+ * Creates a top-k counter type with custom dimensions.
+ * The type must be destroyed with mdcs_counter_type_destroy.
+ *
+ * \param[in] depth Number of rows of the count-min sketch.
+ * \param[in] width Number of columns of the count-min sketch.
+ * \param[in] k Number of heavy hitters to track.
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_topk_create(unsigned depth, unsigned width, unsigned k,
+		mdcs_counter_type_t* type);
+
+/*
+ * Reservoir counters keep a uniform random sample of the items pushed
+ * into them, so that individual raw values (e.g. outliers) can be
+ * inspected. The value holds the number of items seen, the capacity of
+ * the reservoir, the number of samples it holds, the size of an item,
+ * and the samples in no particular order.
+ * MDCS_COUNTER_RESERVOIR_DOUBLE samples 128 doubles, reservoirs of other
+ * sizes or of other items can be created with
+ * mdcs_counter_type_reservoir_create.
+ */
+#define MDCS_COUNTER_RESERVOIR_SIZE 128
+
+typedef double mdcs_counter_reservoir_double_item_t;
+
+typedef struct {
+	uint64_t seen;
+	uint32_t capacity;
+	uint32_t num_samples;
+	uint32_t item_size;
+	uint32_t reserved;
+	double   samples[MDCS_COUNTER_RESERVOIR_SIZE];
+} mdcs_counter_reservoir_double_value_t;
+
+/* size of the value of a reservoir of k items of size s */
+#define MDCS_COUNTER_RESERVOIR_VALUE_SIZE(s,k) (sizeof(uint64_t) + 4*sizeof(uint32_t) + (size_t)(s)*(k))
+
+/**
+ * Creates a reservoir counter type for items of any size.
+ * The type must be destroyed with mdcs_counter_type_destroy.
+ *
+ * \param[in] item_size Size of the items.
+ * \param[in] capacity Number of items in the reservoir.
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_reservoir_create(size_t item_size, size_t capacity,
+		mdcs_counter_type_t* type);
+
+/*
+ * Covariance counters track joint statistics of (x, y) pairs: means,
+ * variances, covariance, slope of the least-squares regression of y
+ * on x, and correlation coefficient. Variances and covariance are
+ * population statistics, as in MDCS_COUNTER_STAT_DOUBLE.
+ */
+typedef struct {
+	double x;
+	double y;
+} mdcs_counter_covariance_item_t;
+
+typedef struct {
+	size_t count;
+	double mean_x;
+	double mean_y;
+	double var_x;
+	double var_y;
+	double cov;
+	double slope;
+	double correlation;
+} mdcs_counter_covariance_value_t;
+
+/*
+ * Atomic counters tally the amounts pushed into them. They are
+ * thread-safe and cannot have a buffer: each push is a single atomic
+ * addition into the cache line of the calling execution stream, and
+ * reads sum these cache lines. MDCS_COUNTER_ATOMIC has 16 cache lines,
+ * so pushes from up to 16 execution streams do not contend; types with
+ * more can be created with mdcs_counter_type_atomic_create.
+ */
+#define MDCS_COUNTER_ATOMIC_SLOTS 16
+
+typedef uint64_t mdcs_counter_atomic_item_t;
+typedef uint64_t mdcs_counter_atomic_value_t;
+
+/**
+ * Creates an atomic counter type with a custom number of cache lines,
+ * which should be at least the number of execution streams pushing
+ * into its counters. The type must be destroyed with
+ * mdcs_counter_type_destroy.
+ *
+ * \param[in] num_slots Number of cache lines (between 1 and 4096).
+ * \param[out] type Resulting counter type.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_atomic_create(size_t num_slots, mdcs_counter_type_t* type);
+
+/**
+ * Adds an amount to an atomic counter. This is equivalent to pushing
+ * the amount with mdcs_counter_push, without the generic dispatch.
+ *
+ * \param[in] counter Atomic counter.
+ * \param[in] amount Amount to add.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR if the counter is not atomic.
+ */
+int mdcs_counter_atomic_add(mdcs_counter_t counter, uint64_t amount);
+
+/*
+ * Histogram counters count the durations pushed into them, in seconds,
+ * in buckets of exponentially growing width: bucket 0 counts durations
+ * up to 1 microsecond, bucket i the durations in (2^(i-1), 2^i]
+ * microseconds, and the last bucket also counts all the longer ones.
+ */
+#define MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS 32
+
+typedef double mdcs_counter_histogram_item_t;
+
+typedef struct {
+	uint64_t count;
+	double   sum;
+	uint64_t buckets[MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS];
+} mdcs_counter_histogram_value_t;
+
+/*
+ * Gauge counters track a level that goes up and down, such as a number
+ * of operations in flight. Items are signed increments of the level.
+ * The value holds the current level and the lowest and highest levels
+ * reached since the last reset (resetting a gauge keeps its level).
+ */
+typedef int64_t mdcs_counter_gauge_item_t;
+
+typedef struct {
+	int64_t current;
+	int64_t min;
+	int64_t max;
+} mdcs_counter_gauge_value_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_MARGO_H
+#define __MDCS_MARGO_H
+
+#include <margo.h>
+#include <mdcs/mdcs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Registers an RPC with Margo, with a handler instrumented by MDCS.
+ * MDCS dispatches the RPC itself: it runs the handler in a new ULT
+ * of the provided pool (or of Margo's handler pool if pool is
+ * ABT_POOL_NULL), as DEFINE_MARGO_RPC_HANDLER would, and maintains
+ * the following counters for the RPC:
+ *  - "rpc:<name>:calls" (MDCS_COUNTER_ATOMIC): number of calls;
+ *  - "rpc:<name>:inflight" (MDCS_COUNTER_GAUGE): calls being handled;
+ *  - "rpc:<name>:queue_time" (MDCS_COUNTER_HISTOGRAM): time between the
+ *    arrival of a call and the start of its handler;
+ *  - "rpc:<name>:handler_time" (MDCS_COUNTER_HISTOGRAM): duration of
+ *    the handler.
+ * If provider_id is not MARGO_DEFAULT_PROVIDER_ID, "<name>" is followed
+ * by "@<provider_id>". The state used to time calls is preallocated
+ * when the RPC is registered, so calls do not allocate memory.
+ *
+ * MDCS must be initialized before registering instrumented RPCs,
+ * and the data attached to the RPC with margo_register_data is
+ * reserved for MDCS.
+ *
+ * \param[in] mid Margo instance.
+ * \param[in] name Name of the RPC.
+ * \param[in] in_proc Proc function of the RPC's input.
+ * \param[in] out_proc Proc function of the RPC's output.
+ * \param[in] handler Function handling the RPC (not the one
+ *            generated by DEFINE_MARGO_RPC_HANDLER).
+ * \param[in] provider_id Provider id.
+ * \param[in] pool Pool in which to run the handler.
+ * \return The id of the RPC, 0 in case of error.
+ */
+hg_id_t mdcs_rpc_register(margo_instance_id mid, const char* name,
+		hg_proc_cb_t in_proc, hg_proc_cb_t out_proc, hg_rpc_cb_t handler,
+		uint16_t provider_id, ABT_pool pool);
+
+/**
+ * Instrumented counterpart of MARGO_REGISTER. The handler
+ * is the function itself, e.g. MDCS_REGISTER(mid, "sum",
+ * sum_in_t, sum_out_t, sum).
+ */
+#define MDCS_REGISTER(__mid, __name, __in_t, __out_t, __handler) \
+	mdcs_rpc_register(__mid, __name, hg_proc_ ## __in_t, hg_proc_ ## __out_t, \
+		__handler, MARGO_DEFAULT_PROVIDER_ID, ABT_POOL_NULL)
+
+/**
+ * Instrumented counterpart of MARGO_REGISTER_PROVIDER.
+ */
+#define MDCS_REGISTER_PROVIDER(__mid, __name, __in_t, __out_t, __handler, __provider_id, __pool) \
+	mdcs_rpc_register(__mid, __name, hg_proc_ ## __in_t, hg_proc_ ## __out_t, \
+		__handler, __provider_id, __pool)
+
+/**
+ * Wrappers of Margo functions maintaining the following counters:
+ *  - "margo:forward:count" (MDCS_COUNTER_ATOMIC) and "margo:forward:time"
+ *    (MDCS_COUNTER_HISTOGRAM): number and round-trip time of the RPCs
+ *    forwarded with mdcs_margo_forward;
+ *  - "margo:handles" (MDCS_COUNTER_GAUGE): handles created with
+ *    mdcs_margo_create and not yet destroyed with mdcs_margo_destroy
+ *    (handles received by RPC handlers should still be destroyed
+ *    with margo_destroy);
+ *  - "margo:bulk_pull:count", "margo:bulk_pull:bytes" (MDCS_COUNTER_ATOMIC)
+ *    and "margo:bulk_pull:time" (MDCS_COUNTER_HISTOGRAM): number, size, and
+ *    duration of the successful transfers done with mdcs_margo_bulk_transfer
+ *    and HG_BULK_PULL, and likewise "margo:bulk_push:*" for HG_BULK_PUSH.
+ * MDCS uses these wrappers for its own RPCs and bulk transfers. Margo
+ * does not expose its progress loop, but "margo:progress_lag"
+ * (MDCS_COUNTER_HISTOGRAM) is maintained by the Argobots sampler (see
+ * mdcs_abt_sampler_start): it measures how late a ULT placed in the
+ * progress pool is woken up, i.e. for how long the progress loop keeps
+ * its execution stream busy.
+ * The wrappers take the same arguments as the functions they wrap.
+ */
+hg_return_t mdcs_margo_create(margo_instance_id mid, hg_addr_t addr,
+		hg_id_t id, hg_handle_t* handle);
+
+hg_return_t mdcs_margo_destroy(hg_handle_t handle);
+
+hg_return_t mdcs_margo_forward(hg_handle_t handle, void* in);
+
+hg_return_t mdcs_margo_bulk_transfer(margo_instance_id mid, hg_bulk_op_t op,
+		hg_addr_t origin_addr, hg_bulk_t origin_handle, size_t origin_offset,
+		hg_bulk_t local_handle, size_t local_offset, size_t size);
+
+/**
+ * Adds an Argobots pool to the pools sampled by the Argobots sampler.
+ * The sampler maintains two counters of type MDCS_COUNTER_GAUGE for
+ * the pool: "abt:<name>:ready" (ULTs ready to run) and "abt:<name>:blocked"
+ * (ULTs blocked or suspended). Pools must be added before starting
+ * the sampler.
+ *
+ * \param[in] name Name of the pool in the counters' names.
+ * \param[in] pool Pool to sample.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_abt_sampler_add_pool(const char* name, ABT_pool pool);
+
+/**
+ * Starts the Argobots sampler, a ULT running in Margo's handler pool
+ * that samples the pools at the provided interval. Margo's handler
+ * and progress pools are sampled under the names "handler" and
+ * "progress" if they were not added explicitly. The sampler also
+ * maintains "abt:xstreams" (MDCS_COUNTER_LAST_INT64), the number of
+ * execution streams, and "abt:sampler_lag" (MDCS_COUNTER_HISTOGRAM),
+ * the time by which its wake-ups are late, which measures how long
+ * a ULT that becomes ready waits in the handler pool.
+ *
+ * \param[in] interval Sampling interval in seconds.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_abt_sampler_start(double interval);
+
+/**
+ * Stops the Argobots sampler. This function waits for the sampler's
+ * next wake-up, hence for up to the sampling interval. The sampler
+ * is stopped automatically by mdcs_finalize.
+ *
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_abt_sampler_stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
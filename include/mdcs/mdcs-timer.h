@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_TIMER_H
+#define __MDCS_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <mdcs/mdcs.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MDCS_TIMER_HAVE_TSC 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Source of the timestamps used by timers. MDCS uses the CPU's
+ * timestamp counter if it is invariant (constant rate, not stopped
+ * in idle states), calibrated against the monotonic clock when MDCS
+ * is initialized. Otherwise it falls back to the monotonic clock,
+ * which is read through the vDSO without a system call.
+ */
+typedef struct {
+	int    use_tsc;          // whether timestamps come from the TSC
+	double seconds_per_tick; // duration of a tick of the source
+} mdcs_timer_source_t;
+
+extern mdcs_timer_source_t mdcs_timer_source;
+
+/**
+ * A running timer, started with mdcs_timer_start. Timers should be
+ * started after MDCS has been initialized, as the initialization
+ * may change the source of the timestamps.
+ */
+typedef struct {
+	uint64_t start; // timestamp at which the timer was started
+} mdcs_timer_t;
+
+/**
+ * Returns the current timestamp, in ticks of the timer source.
+ */
+static inline uint64_t mdcs_timer_ticks(void)
+{
+#ifdef MDCS_TIMER_HAVE_TSC
+	if(mdcs_timer_source.use_tsc)
+		return __rdtsc();
+#endif
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Starts a timer.
+ *
+ * \return The running timer.
+ */
+static inline mdcs_timer_t mdcs_timer_start(void)
+{
+	mdcs_timer_t timer;
+	timer.start = mdcs_timer_ticks();
+	return timer;
+}
+
+/**
+ * Returns the time elapsed since a timer was started, in seconds.
+ *
+ * \param[in] timer Running timer.
+ * \return Elapsed time in seconds.
+ */
+static inline double mdcs_timer_elapsed(mdcs_timer_t timer)
+{
+	return (double)(mdcs_timer_ticks() - timer.start)*mdcs_timer_source.seconds_per_tick;
+}
+
+/**
+ * Stops a timer and pushes the elapsed time, in seconds, into a counter.
+ * The counter's items must be doubles (e.g. MDCS_COUNTER_STAT_DOUBLE,
+ * MDCS_COUNTER_WINDOW_DOUBLE, or MDCS_COUNTER_RESERVOIR_DOUBLE).
+ *
+ * \param[in] timer Running timer.
+ * \param[in] counter Counter in which to push the elapsed time.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+static inline int mdcs_timer_stop(mdcs_timer_t timer, mdcs_counter_t counter)
+{
+	double elapsed = mdcs_timer_elapsed(timer);
+	return mdcs_counter_push(counter, &elapsed);
+}
+
+/**
+ * Stops a timer and pushes the elapsed time, in seconds, into a counter
+ * along with a tag (e.g. a request id), so that the measurement can be
+ * kept as an exemplar (see mdcs_counter_enable_exemplars).
+ *
+ * \param[in] timer Running timer.
+ * \param[in] counter Counter in which to push the elapsed time.
+ * \param[in] tag Tag identifying the measured operation.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+static inline int mdcs_timer_stop_tagged(mdcs_timer_t timer,
+		mdcs_counter_t counter, uint64_t tag)
+{
+	double elapsed = mdcs_timer_elapsed(timer);
+	return mdcs_counter_push_tagged(counter, &elapsed, tag);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
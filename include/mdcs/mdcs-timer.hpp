@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_TIMER_HPP
+#define __MDCS_TIMER_HPP
+
+#include <mdcs/mdcs-timer.h>
+
+namespace mdcs {
+
+/**
+ * Timer that measures the lifetime of a scope and pushes it,
+ * in seconds, into a counter when the scope is exited.
+ */
+class scoped_timer {
+
+    public:
+
+    explicit scoped_timer(mdcs_counter_t counter)
+    : m_counter(counter), m_timer(mdcs_timer_start()) {}
+
+    ~scoped_timer() {
+        mdcs_timer_stop(m_timer, m_counter);
+    }
+
+    /**
+     * Returns the time elapsed since the timer was created, in seconds.
+     */
+    double elapsed() const {
+        return mdcs_timer_elapsed(m_timer);
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+    private:
+
+    mdcs_counter_t m_counter;
+    mdcs_timer_t   m_timer;
+};
+
+}
+
+#endif
@@ -25,12 +25,101 @@ typedef void  (*mdcs_reset_f)(void* counter_data);
 typedef void  (*mdcs_get_value_f)(void* counter_data, void* val);
 typedef void  (*mdcs_push_one_f)(void* counter_data, const void* val);
 typedef void  (*mdcs_push_multi_f)(void* counter_data, const void* val, size_t num);
-typedef struct mdcs_counter_type_s* mdcs_counter_type_t;
-typedef struct mdcs_counter_s*      mdcs_counter_t;
-typedef uint64_t                    mdcs_counter_id_t;
+typedef int   (*mdcs_merge_f)(void* val, const void* other_val);
+typedef struct mdcs_counter_type_s*   mdcs_counter_type_t;
+typedef struct mdcs_counter_s*        mdcs_counter_t;
+typedef struct mdcs_counter_family_s* mdcs_counter_family_t;
+typedef uint64_t                      mdcs_counter_id_t;
+typedef uint64_t                      mdcs_counter_type_id_t;
 
-#define MDCS_COUNTER_NULL      ((mdcs_counter_t)NULL)
-#define MDCS_COUNTER_TYPE_NULL ((mdcs_counter_type_t)NULL)
+#define MDCS_COUNTER_NULL        ((mdcs_counter_t)NULL)
+#define MDCS_COUNTER_TYPE_NULL   ((mdcs_counter_type_t)NULL)
+#define MDCS_COUNTER_FAMILY_NULL ((mdcs_counter_family_t)NULL)
+
+/**
+ * Types of the fields of a counter value.
+ */
+typedef enum {
+	MDCS_FIELD_INT8,
+	MDCS_FIELD_UINT8,
+	MDCS_FIELD_INT32,
+	MDCS_FIELD_UINT32,
+	MDCS_FIELD_INT64,
+	MDCS_FIELD_UINT64,
+	MDCS_FIELD_FLOAT,
+	MDCS_FIELD_DOUBLE
+} mdcs_field_type_t;
+
+/* field type to use for size_t members */
+#define MDCS_FIELD_SIZE_T (sizeof(size_t) == 8 ? MDCS_FIELD_UINT64 : MDCS_FIELD_UINT32)
+
+/**
+ * Description of a field of a counter value: its name, type,
+ * offset in the value, and number of consecutive elements
+ * (1 for a scalar field, more for an array).
+ */
+typedef struct {
+	const char*       name;
+	mdcs_field_type_t type;
+	size_t            offset;
+	size_t            count;
+} mdcs_counter_field_t;
+
+/**
+ * Schema of a registered counter type, describing the layout
+ * of its values so that they can be decoded generically.
+ */
+typedef struct {
+	const char*                 type_name;  // name under which the type is registered
+	mdcs_counter_type_id_t      type_id;    // id of the type (hash of its name)
+	size_t                      item_size;  // size of the items pushed into counters
+	size_t                      value_size; // size of the values read from counters
+	size_t                      num_fields; // number of fields in the value
+	const mdcs_counter_field_t* fields;     // fields of the value
+} mdcs_counter_schema_t;
+
+/**
+ * Description of a counter, as returned by mdcs_remote_counter_list.
+ */
+typedef struct {
+	mdcs_counter_id_t id;  // id of the counter
+	const char* name;      // name of the counter
+	mdcs_counter_type_id_t type_id; // id of the counter's type, 0 if not registered
+	size_t item_size;      // size of the items pushed into the counter
+	size_t value_size;     // size of the value (of one slot for vector counters)
+	size_t num_slots;      // number of slots of a vector counter, 0 otherwise
+} mdcs_counter_info_t;
+
+/**
+ * Item kept as an exemplar by a counter (see mdcs_counter_enable_exemplars),
+ * along with the tag it was pushed with (e.g. a request id).
+ */
+typedef struct {
+	double   value; // pushed item
+	uint64_t tag;   // tag provided by the caller
+} mdcs_exemplar_t;
+
+/**
+ * Comparison performed by a watch predicate (see mdcs_remote_counter_watch).
+ */
+typedef enum {
+	MDCS_WATCH_ABOVE,      // field greater than the threshold
+	MDCS_WATCH_BELOW,      // field less than the threshold
+	MDCS_WATCH_RATE_ABOVE  // absolute rate of change of the field, per second,
+	                       // greater than the threshold
+} mdcs_watch_op_t;
+
+/**
+ * Predicate on a field of the value of a counter. The field is
+ * described by its type and offset, as in the schema of the
+ * counter's type (see mdcs_remote_counter_type_schema).
+ */
+typedef struct {
+	mdcs_watch_op_t   op;           // comparison to perform
+	mdcs_field_type_t field_type;   // type of the field
+	size_t            field_offset; // offset of the field in the value
+	double            threshold;    // threshold to compare the field to
+} mdcs_watch_predicate_t;
 
 /**
  * Type of a printer function, used by mdcs_set_error_printer
@@ -40,9 +129,11 @@ typedef void (*mdcs_printer_f)(const char*);
 
 /**
  * Initializes the MDCS service by registering the proper
- * RPCs using the provided margo instance.
+ * RPCs using the provided margo instance. If mid is
+ * MARGO_INSTANCE_NULL, no RPC is registered and counters
+ * can only be used locally (ABT_init must have been called).
  *
- * \param[in] mid Initialized margo instance.
+ * \param[in] mid Initialized margo instance, or MARGO_INSTANCE_NULL.
  * \param[in] listening MDCS_TRUE if we are listening for queries.
  * \param[in] pool Argobots pool in which to execute RPC handlers
  *            associated with MDCS. Relevant on servers only.
@@ -61,7 +152,9 @@ int mdcs_init(margo_instance_id mid, int listening, ABT_pool pool);
 int mdcs_initialized(int* flag);
 
 /**
- * Finalizes the MDCS service.
+ * Finalizes the MDCS service. If RPCs were registered with
+ * MDCS_REGISTER, this must be called before their Margo instance
+ * is finalized, since it waits for their calls to complete.
  *
  * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
  */
@@ -118,6 +211,100 @@ int mdcs_counter_type_create(size_t itemsize, size_t valuesize,
  */		
 int mdcs_counter_type_destroy(mdcs_counter_type_t type);
 
+/**
+ * Declares that the internal data created by a counter type's create
+ * function is a flat block of datasize bytes, holding no pointer to
+ * other allocations. This allows vector counters of this type to lay
+ * all their slots out in a single contiguous allocation.
+ *
+ * \param[in] type Counter type (cannot be a built-in type).
+ * \param[in] datasize Size of the counter's internal data.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_set_data_size(mdcs_counter_type_t type, size_t datasize);
+
+/**
+ * Declares that the items of a counter type are single doubles, which
+ * allows exemplars to be enabled on counters of this type. Among the
+ * built-in types, LAST_DOUBLE, STAT_DOUBLE, WINDOW_DOUBLE,
+ * RESERVOIR_DOUBLE and HISTOGRAM have double items.
+ *
+ * \param[in] type Counter type (cannot be a built-in type).
+ * 
+eturn MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_set_double_items(mdcs_counter_type_t type);
+
+/**
+ * Registers a counter type under a name, along with the schema of its
+ * values. Registered types can be looked up by name, and their schema
+ * can be fetched by clients (see mdcs_remote_counter_type_schema) to
+ * decode the values of counters of this type without hard-coding their
+ * layout. Built-in types are registered automatically.
+ *
+ * \param[in] name Name of the type.
+ * \param[in] type Counter type.
+ * \param[in] fields Fields of the type's values.
+ * \param[in] num_fields Number of fields.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_register(const char* name, mdcs_counter_type_t type,
+		const mdcs_counter_field_t* fields, size_t num_fields);
+
+/**
+ * Finds a registered counter type by its name.
+ *
+ * \param[in] name Name of the type.
+ * \param[out] type Returned type.
+ * \return MDCS_SUCCESS if the type is found, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_find_by_name(const char* name, mdcs_counter_type_t* type);
+
+/**
+ * Gets the schema of a registered counter type.
+ *
+ * \param[in] type Counter type.
+ * \param[out] schema Schema of the type (owned by MDCS).
+ * \return MDCS_SUCCESS on success, MDCS_ERROR if the type is not registered.
+ */
+int mdcs_counter_type_get_schema(mdcs_counter_type_t type,
+		const mdcs_counter_schema_t** schema);
+
+/**
+ * Returns the size of a field type.
+ *
+ * \param[in] type Field type.
+ * \return Size in bytes of a single element of this type.
+ */
+size_t mdcs_field_type_size(mdcs_field_type_t type);
+
+/**
+ * Sets the function used to merge two values of a counter type. Merging
+ * is what allows the values of several counters (e.g. the members of a
+ * counter family, or the same counter on several servers) to be
+ * aggregated into a single value. The function must combine the second
+ * value into the first one, and return MDCS_SUCCESS, or MDCS_ERROR if
+ * the values cannot be merged.
+ *
+ * \param[in] type Counter type (cannot be a built-in type).
+ * \param[in] merge_fn Function used to merge values.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_type_set_merge(mdcs_counter_type_t type, mdcs_merge_f merge_fn);
+
+/**
+ * Merges a value into another, using the merge function of the
+ * provided counter type. Can be used by clients to combine values
+ * fetched from several servers.
+ *
+ * \param[in] type Counter type of the values.
+ * \param[inout] value Value into which to merge.
+ * \param[in] other Value to merge.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR if the type
+ *         does not support merging or the values cannot be merged.
+ */
+int mdcs_counter_type_merge(mdcs_counter_type_t type, void* value, const void* other);
+
 /**
  * Registers a new counter. Will fail if the name of the
  * counter already exists.
@@ -133,6 +320,69 @@ int mdcs_counter_register(const char* name,
         mdcs_counter_type_t type, size_t buffer_size, 
         mdcs_counter_t* counter);
 
+/**
+ * Registers a new vector counter, i.e. a counter made of num_slots
+ * independent slots of the same type under a single name. The state
+ * of all the slots is laid out contiguously when the type allows it
+ * (see mdcs_counter_type_set_data_size). Vector counters are not
+ * buffered: pushes go directly to the slot.
+ *
+ * \param[in] name Name of the counter.
+ * \param[in] type Type of each slot.
+ * \param[in] num_slots Number of slots.
+ * \param[out] counter Newly created counter.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_vector_register(const char* name,
+		mdcs_counter_type_t type, size_t num_slots,
+		mdcs_counter_t* counter);
+
+/**
+ * Gets the number of slots of a counter (0 if the counter is
+ * not a vector counter).
+ *
+ * \param[in] counter Counter.
+ * \param[out] num_slots Number of slots.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_vector_size(mdcs_counter_t counter, size_t* num_slots);
+
+/**
+ * Pushes a value into a slot of a vector counter.
+ *
+ * \param[in] counter Vector counter.
+ * \param[in] slot Index of the slot.
+ * \param[in] value Pointer to the value to push.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_vector_push(mdcs_counter_t counter, size_t slot, const void* value);
+
+/**
+ * Pushes an array of values into a slot of a vector counter.
+ *
+ * \param[in] counter Vector counter.
+ * \param[in] slot Index of the slot.
+ * \param[in] values Pointer to an array of values.
+ * \param[in] num Number of values in the array.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_vector_push_multi(mdcs_counter_t counter, size_t slot,
+		const void* values, size_t num);
+
+/**
+ * Gets the values of a range of slots of a vector counter. The values
+ * are placed one after the other in the provided buffer. Calling
+ * mdcs_counter_value on a vector counter gets the values of all the slots.
+ *
+ * \param[in] counter Vector counter.
+ * \param[in] first Index of the first slot.
+ * \param[in] count Number of slots.
+ * \param[out] values Buffer of count values.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_vector_value(mdcs_counter_t counter, size_t first,
+		size_t count, void* values);
+
 /**
  * Pushes a value into a counter.
  * 
@@ -142,6 +392,18 @@ int mdcs_counter_register(const char* name,
  */
 int mdcs_counter_push(mdcs_counter_t counter, const void* value);
 
+/**
+ * Pushes an array of values into a counter. The values bypass the
+ * counter's buffer and are handed directly to the counter type's
+ * push_multi function (values already in the buffer are digested first).
+ *
+ * \param[in] counter Counter in which to push the values.
+ * \param[in] values Pointer to an array of values.
+ * \param[in] num Number of values in the array.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_push_multi(mdcs_counter_t counter, const void* values, size_t num);
+
 /**
  * Forces all values present in the buffer to be pushed into the counter,
  * and empties the buffer.
@@ -171,6 +433,45 @@ int mdcs_counter_value(mdcs_counter_t counter, void* value);
  */
 int mdcs_counter_reset(mdcs_counter_t counter);
 
+/**
+ * Enables exemplars on a scalar counter whose items are doubles
+ * (e.g. latencies), see mdcs_counter_type_set_double_items. The counter then keeps the max_exemplars largest
+ * items pushed with mdcs_counter_push_tagged during the current
+ * interval and during the previous one, along with their tags.
+ * Exemplars are forgotten when the counter is reset.
+ *
+ * \param[in] counter Counter on which to enable exemplars.
+ * \param[in] max_exemplars Number of exemplars kept per interval.
+ * \param[in] interval Duration of an interval in seconds,
+ *            0 to keep exemplars until the counter is reset.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_enable_exemplars(mdcs_counter_t counter,
+		size_t max_exemplars, double interval);
+
+/**
+ * Pushes a value into a counter, like mdcs_counter_push, and offers
+ * it as an exemplar if exemplars are enabled on the counter.
+ *
+ * \param[in] counter Counter in which to push a value.
+ * \param[in] value Pointer to the value to push.
+ * \param[in] tag Tag identifying the origin of the value.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_push_tagged(mdcs_counter_t counter, const void* value, uint64_t tag);
+
+/**
+ * Gets the exemplars of a counter, largest first.
+ *
+ * \param[in] counter Counter from which to get the exemplars.
+ * \param[out] exemplars Array of at least max exemplars.
+ * \param[in] max Maximum number of exemplars to return.
+ * \param[out] num Number of exemplars returned.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_exemplars(mdcs_counter_t counter, mdcs_exemplar_t* exemplars,
+		size_t max, size_t* num);
+
 /**
  * Finds a counter by its id.
  *
@@ -189,6 +490,67 @@ int mdcs_counter_find_by_id(uint64_t id, mdcs_counter_t* counter);
  */
 int mdcs_counter_find_by_name(const char* name, mdcs_counter_t* counter);
 
+/**
+ * Registers a new counter family. A family is a set of counters of
+ * the same type, distinguished by the values of a fixed list of labels
+ * (e.g. "op" and "target"). Label values are interned, so the memory
+ * and lookup cost of a member depend on the number of distinct label
+ * values rather than on their length. Will fail if the name of the
+ * family is already used by a counter or another family.
+ *
+ * \param[in] name Name of the family.
+ * \param[in] type Type of the counters in the family.
+ * \param[in] num_labels Number of labels.
+ * \param[in] label_names Names of the labels.
+ * \param[in] buffer_size Size of the buffer of each member counter.
+ * \param[out] family Newly created family.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_family_register(const char* name,
+		mdcs_counter_type_t type, size_t num_labels,
+		const char* const* label_names, size_t buffer_size,
+		mdcs_counter_family_t* family);
+
+/**
+ * Finds a counter family by its name.
+ *
+ * \param[in] name Name of the family.
+ * \param[out] family Returned family.
+ * \return MDCS_SUCCESS if the family is found, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_family_find_by_name(const char* name, mdcs_counter_family_t* family);
+
+/**
+ * Gets the member of a family corresponding to the provided label
+ * values, creating it if it does not exist yet. The returned counter
+ * can be used with mdcs_counter_push, mdcs_counter_value, etc.
+ * and remains valid until MDCS is finalized, so callers should
+ * keep it rather than looking it up for every push.
+ *
+ * \param[in] family Counter family.
+ * \param[in] label_values One value for each label of the family.
+ * \param[out] counter Member counter.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_family_get(mdcs_counter_family_t family,
+		const char* const* label_values, mdcs_counter_t* counter);
+
+/**
+ * Aggregates the values of all the members of a family matching a
+ * label selector. The selector provides one value per label; a NULL
+ * entry matches any value of the corresponding label. Only members
+ * that match are visited. The counter type must support merging
+ * (see mdcs_counter_type_set_merge) if more than one member matches.
+ *
+ * \param[in] family Counter family.
+ * \param[in] label_values Selector (one entry per label, NULL for any).
+ * \param[out] value Pointer to the location where the aggregated
+ *             value should be placed.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_counter_family_aggregate(mdcs_counter_family_t family,
+		const char* const* label_values, void* value);
+
 /**
  * Gets the id of a counter in a given namespace.
  * 
@@ -209,6 +571,104 @@ int mdcs_remote_counter_get_id(const char* name, mdcs_counter_id_t* counter);
  */
 int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* value, size_t size);
 
+/**
+ * Fetches the values of a range of slots of a vector counter from
+ * a remote address, using a single bulk transfer.
+ *
+ * \param[in] addr Server address from which to fetch the values.
+ * \param[in] counter ID of the vector counter.
+ * \param[in] first Index of the first slot.
+ * \param[in] count Number of slots.
+ * \param[out] values Pointer to a buffer where to store the values.
+ * \param[in] size Size of the buffer (count times the value size).
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_fetch_slots(hg_addr_t addr, mdcs_counter_id_t counter,
+		size_t first, size_t count, void* values, size_t size);
+
+/**
+ * Fetches the value of a remote counter along with its exemplars,
+ * largest first, in a single RPC. A counter that does not keep
+ * exemplars returns none.
+ *
+ * \param[in] addr Server address from which to fetch the value.
+ * \param[in] counter ID of the counter.
+ * \param[out] value Pointer to a buffer where to store the value.
+ * \param[in] size Size of the value buffer.
+ * \param[out] exemplars Array of at least max exemplars.
+ * \param[in] max Maximum number of exemplars to return.
+ * \param[out] num Number of exemplars returned.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_fetch_exemplars(hg_addr_t addr, mdcs_counter_id_t counter,
+		void* value, size_t size, mdcs_exemplar_t* exemplars, size_t max, size_t* num);
+
+/**
+ * Watches a remote counter until a predicate on its value fires. The
+ * server evaluates the predicate when the watch is received, then every
+ * time items are digested by the counter, and responds as soon as it
+ * fires or when the timeout expires. Rates of change are computed over
+ * periods of at least 100 ms, starting when the watch is received.
+ * Watches are only supported on scalar counters.
+ *
+ * \param[in] addr Server address.
+ * \param[in] counter ID of the counter.
+ * \param[in] pred Predicate on the value of the counter.
+ * \param[in] timeout Maximum time to wait, in seconds (the server
+ *            waits for at most an hour).
+ * \param[out] value Value of the counter when the predicate fired
+ *             or when the timeout expired.
+ * \param[in] size Size of the value buffer.
+ * \param[out] fired Set to MDCS_TRUE if the predicate fired,
+ *             MDCS_FALSE if the timeout expired.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_watch(hg_addr_t addr, mdcs_counter_id_t counter,
+		const mdcs_watch_predicate_t* pred, double timeout,
+		void* value, size_t size, int* fired);
+
+/**
+ * Lists the counters of a remote server whose name matches a pattern.
+ * The pattern is either a prefix (e.g. "example:") or a glob pattern
+ * (e.g. "example:*_lat"); an empty pattern lists all the counters.
+ * Counters are returned in lexicographic order of their names, and at
+ * most max_entries of them are returned per call. To get the next
+ * page, call the function again passing the name of the last returned
+ * counter as start_after.
+ *
+ * The returned array, including the names it points to, is allocated
+ * as a single block and must be freed by the caller using free().
+ *
+ * \param[in] addr Server address.
+ * \param[in] pattern Prefix or glob pattern.
+ * \param[in] start_after Only names strictly after this one are
+ *            returned (can be NULL).
+ * \param[in] max_entries Maximum number of entries to return
+ *            (0 for the server's maximum).
+ * \param[out] infos Array of counter descriptions.
+ * \param[out] num_infos Number of entries in the array.
+ * \param[out] more Set to MDCS_TRUE if more entries remain.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_list(hg_addr_t addr, const char* pattern,
+		const char* start_after, size_t max_entries,
+		mdcs_counter_info_t** infos, size_t* num_infos, int* more);
+
+/**
+ * Gets the schema of a counter type registered at a remote address.
+ * Schemas are cached: only the first request for a given type id
+ * issues an RPC. Type ids are derived from type names, hence servers
+ * are expected to register types with the same name consistently.
+ *
+ * \param[in] addr Server address.
+ * \param[in] type_id Id of the type (e.g. from mdcs_remote_counter_list).
+ * \param[out] schema Schema of the type (owned by MDCS, valid until
+ *             MDCS is finalized).
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_type_schema(hg_addr_t addr, mdcs_counter_type_id_t type_id,
+		const mdcs_counter_schema_t** schema);
+
 /**
  * Resets a counter at a remote address.
  * 
@@ -218,6 +678,63 @@ int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* v
  */
 int mdcs_remote_counter_reset(hg_addr_t addr, mdcs_counter_id_t counter);
 
+/**
+ * Aggregates the values of the members of a counter family at a
+ * remote address (see mdcs_counter_family_aggregate). The id of the
+ * family is obtained from its name using mdcs_remote_counter_get_id.
+ *
+ * \param[in] addr Server address.
+ * \param[in] family ID of the family.
+ * \param[in] label_values Selector (one entry per label, NULL for any).
+ * \param[in] num_labels Number of entries in the selector.
+ * \param[out] value Pointer to a buffer where to store the value.
+ * \param[in] size Size of the value buffer.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_family_aggregate(hg_addr_t addr, mdcs_counter_id_t family,
+		const char* const* label_values, size_t num_labels,
+		void* value, size_t size);
+
+/**
+ * Pushes a batch of items into a counter at a remote address using
+ * a single RPC. Small batches are sent inline with the RPC, large ones
+ * are pulled by the server using a bulk transfer. The server hands the
+ * items to the counter type's push_multi function, and rejects batches
+ * larger than 64 MiB.
+ *
+ * \param[in] addr Address of the server in which the counter lives.
+ * \param[in] counter ID of the counter in which to push the items.
+ * \param[in] items Pointer to an array of items.
+ * \param[in] n Number of items in the array.
+ * \param[in] itemsize Size of an individual item (must match the
+ *            item size of the remote counter's type).
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_remote_counter_push_multi(hg_addr_t addr, mdcs_counter_id_t counter,
+		const void* items, size_t n, size_t itemsize);
+
+/**
+ * Starts an HTTP endpoint serving the named counters in the OpenMetrics
+ * text format, so that they can be scraped by Prometheus-compatible tools.
+ * Members of families are exported under the family's name, labelled by
+ * their label values. The endpoint requires a Margo instance and runs as
+ * a ULT in Margo's handler pool, and reuses its buffers from one scrape
+ * to the next.
+ *
+ * \param[in] address Either a port number (the endpoint then listens on
+ *            the loopback interface) or "unix:<path>" for a Unix socket.
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_exporter_start(const char* address);
+
+/**
+ * Stops the endpoint started by mdcs_exporter_start. The endpoint is
+ * also stopped by mdcs_finalize.
+ *
+ * \return MDCS_SUCCESS on success, MDCS_ERROR otherwise.
+ */
+int mdcs_exporter_stop();
+
 #ifdef __cplusplus
 }
 #endif
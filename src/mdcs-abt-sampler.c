@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-margo.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter.h"
+#include "mdcs-abt-sampler.h"
+#include "mdcs-margo-stats.h"
+#include "mdcs-time.h"
+#include "mdcs-error.h"
+
+/* maximum length of the names of the sampler's counters */
+#define MDCS_ABT_SAMPLER_NAME_MAX 256
+
+extern mdcs_t g_mdcs;
+
+/**
+ * Returns the sampler's state, creating it and its global counters
+ * the first time it is needed.
+ */
+static mdcs_abt_sampler_t abt_sampler_get()
+{
+	if(g_mdcs->abt_sampler != NULL)
+		return g_mdcs->abt_sampler;
+
+	mdcs_abt_sampler_t s = (mdcs_abt_sampler_t)calloc(1, sizeof(*s));
+	if(s == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for Argobots sampler");
+		return NULL;
+	}
+
+	if(mdcs_counter_register("abt:xstreams", MDCS_COUNTER_LAST_INT64, 0, &s->xstreams) != MDCS_SUCCESS
+	|| mdcs_counter_register("abt:sampler_lag", MDCS_COUNTER_HISTOGRAM, 0, &s->lag) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not register Argobots sampler counters");
+		goto error;
+	}
+
+	s->thread = ABT_THREAD_NULL;
+	s->probe = ABT_THREAD_NULL;
+	g_mdcs->abt_sampler = s;
+	return s;
+
+error:
+	mdcs_counter_unregister(s->xstreams);
+	mdcs_counter_unregister(s->lag);
+	free(s);
+	return NULL;
+}
+
+/**
+ * Pushes the change of a sampled level into a gauge.
+ */
+static void abt_sampler_level(mdcs_counter_t gauge, int64_t* last, int64_t level)
+{
+	int64_t delta = level - *last;
+	if(delta == 0) return;
+	mdcs_counter_push(gauge, &delta);
+	*last = level;
+}
+
+/**
+ * Takes one sample of all the pools.
+ */
+static void abt_sampler_sample(mdcs_abt_sampler_t s)
+{
+	size_t i;
+	for(i=0; i < s->num_pools; i++) {
+		mdcs_abt_pool_sample_t* p = &s->pools[i];
+		size_t size = 0, total = 0;
+		if(ABT_pool_get_size(p->pool, &size) != ABT_SUCCESS
+		|| ABT_pool_get_total_size(p->pool, &total) != ABT_SUCCESS)
+			continue;
+		abt_sampler_level(p->ready, &p->last_ready, (int64_t)size);
+		abt_sampler_level(p->blocked, &p->last_blocked,
+				total > size ? (int64_t)(total - size) : 0);
+	}
+
+	int num_xstreams = 0;
+	if(ABT_xstream_get_num(&num_xstreams) == ABT_SUCCESS) {
+		int64_t n = num_xstreams;
+		mdcs_counter_push(s->xstreams, &n);
+	}
+}
+
+/**
+ * Sleeps for the sampling interval and returns
+ * the time by which the wake-up was late.
+ */
+static double abt_sampler_sleep(mdcs_abt_sampler_t s)
+{
+	double before = mdcs_time_now();
+	margo_thread_sleep(g_mdcs->mid, s->interval*1000.0);
+	double lag = mdcs_time_now() - before - s->interval;
+	return lag < 0.0 ? 0.0 : lag;
+}
+
+/**
+ * Sampler ULT. The time by which its wake-ups are late measures
+ * how long a ULT that becomes ready waits in the sampler's pool.
+ */
+static void abt_sampler_ult(void* arg)
+{
+	mdcs_abt_sampler_t s = (mdcs_abt_sampler_t)arg;
+
+	while(__atomic_load_n(&s->running, __ATOMIC_ACQUIRE)) {
+		abt_sampler_sample(s);
+		double lag = abt_sampler_sleep(s);
+		mdcs_counter_push(s->lag, &lag);
+		// without a probe, the progress loop shares the sampler's pool
+		if(s->probe == ABT_THREAD_NULL)
+			mdcs_margo_stats_time(g_mdcs->margo_stats->progress_lag, lag);
+	}
+}
+
+/**
+ * Probe ULT running in the progress pool. Its wake-ups are late by
+ * the time the progress loop keeps the execution stream busy.
+ */
+static void abt_sampler_probe_ult(void* arg)
+{
+	mdcs_abt_sampler_t s = (mdcs_abt_sampler_t)arg;
+
+	while(__atomic_load_n(&s->running, __ATOMIC_ACQUIRE)) {
+		double lag = abt_sampler_sleep(s);
+		mdcs_margo_stats_time(g_mdcs->margo_stats->progress_lag, lag);
+	}
+}
+
+int mdcs_abt_sampler_add_pool(const char* name, ABT_pool pool)
+{
+	char ready_name[MDCS_ABT_SAMPLER_NAME_MAX];
+	char blocked_name[MDCS_ABT_SAMPLER_NAME_MAX];
+	size_t i;
+
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(pool == ABT_POOL_NULL) {
+		MDCS_PRINT_ERROR("Trying to sample a NULL pool");
+		return MDCS_ERROR;
+	}
+
+	mdcs_abt_sampler_t s = abt_sampler_get();
+	if(s == NULL) return MDCS_ERROR;
+
+	if(s->thread != ABT_THREAD_NULL) {
+		MDCS_PRINT_ERROR("Pools cannot be added while the sampler is running");
+		return MDCS_ERROR;
+	}
+
+	for(i=0; i < s->num_pools; i++) {
+		if(s->pools[i].pool == pool) {
+			MDCS_PRINT_ERROR("Pool is already sampled");
+			return MDCS_ERROR;
+		}
+	}
+
+	int n1 = snprintf(ready_name, sizeof(ready_name), "abt:%s:ready", name);
+	int n2 = snprintf(blocked_name, sizeof(blocked_name), "abt:%s:blocked", name);
+	if(n1 < 0 || (size_t)n1 >= sizeof(ready_name)
+	|| n2 < 0 || (size_t)n2 >= sizeof(blocked_name)) {
+		MDCS_PRINT_ERROR("Pool name is too long");
+		return MDCS_ERROR;
+	}
+
+	if(s->num_pools == s->max_pools) {
+		size_t max = s->max_pools ? 2*s->max_pools : 4;
+		mdcs_abt_pool_sample_t* pools = (mdcs_abt_pool_sample_t*)realloc(s->pools,
+				max*sizeof(mdcs_abt_pool_sample_t));
+		if(pools == NULL) {
+			MDCS_PRINT_ERROR("Could not allocate memory for sampled pools");
+			return MDCS_ERROR;
+		}
+		s->pools = pools;
+		s->max_pools = max;
+	}
+
+	mdcs_abt_pool_sample_t* p = &s->pools[s->num_pools];
+	memset(p, 0, sizeof(*p));
+	p->pool = pool;
+	if(mdcs_counter_register(ready_name, MDCS_COUNTER_GAUGE, 0, &p->ready) != MDCS_SUCCESS
+	|| mdcs_counter_register(blocked_name, MDCS_COUNTER_GAUGE, 0, &p->blocked) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not register pool counters");
+		goto error;
+	}
+	s->num_pools += 1;
+
+	return MDCS_SUCCESS;
+
+error:
+	mdcs_counter_unregister(p->ready);
+	mdcs_counter_unregister(p->blocked);
+	memset(p, 0, sizeof(*p));
+	return MDCS_ERROR;
+}
+
+int mdcs_abt_sampler_start(double interval)
+{
+	ABT_pool handler_pool = ABT_POOL_NULL;
+	ABT_pool progress_pool = ABT_POOL_NULL;
+	size_t i;
+
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(g_mdcs->mid == MARGO_INSTANCE_NULL) {
+		MDCS_PRINT_ERROR("Argobots sampler requires a Margo instance");
+		return MDCS_ERROR;
+	}
+
+	if(interval <= 0.0) {
+		MDCS_PRINT_ERROR("Sampling interval must be positive");
+		return MDCS_ERROR;
+	}
+
+	mdcs_abt_sampler_t s = abt_sampler_get();
+	if(s == NULL) return MDCS_ERROR;
+
+	if(s->thread != ABT_THREAD_NULL) {
+		MDCS_PRINT_ERROR("Argobots sampler is already running");
+		return MDCS_ERROR;
+	}
+
+	// Margo's pools are always sampled, unless they were added by the user
+	margo_get_handler_pool(g_mdcs->mid, &handler_pool);
+	margo_get_progress_pool(g_mdcs->mid, &progress_pool);
+	int have_handler = (handler_pool == ABT_POOL_NULL);
+	int have_progress = (progress_pool == ABT_POOL_NULL || progress_pool == handler_pool);
+	for(i=0; i < s->num_pools; i++) {
+		if(s->pools[i].pool == handler_pool) have_handler = 1;
+		if(s->pools[i].pool == progress_pool) have_progress = 1;
+	}
+	if(!have_handler && mdcs_abt_sampler_add_pool("handler", handler_pool) != MDCS_SUCCESS)
+		return MDCS_ERROR;
+	if(!have_progress && mdcs_abt_sampler_add_pool("progress", progress_pool) != MDCS_SUCCESS)
+		return MDCS_ERROR;
+
+	s->interval = interval;
+	__atomic_store_n(&s->running, 1, __ATOMIC_RELEASE);
+
+	if(progress_pool != ABT_POOL_NULL && handler_pool != ABT_POOL_NULL
+	&& progress_pool != handler_pool) {
+		if(ABT_thread_create(progress_pool, abt_sampler_probe_ult, s,
+				ABT_THREAD_ATTR_NULL, &s->probe) != ABT_SUCCESS) {
+			MDCS_PRINT_WARNING("Could not create progress pool probe ULT");
+			s->probe = ABT_THREAD_NULL;
+		}
+	}
+
+	if(ABT_thread_create(handler_pool != ABT_POOL_NULL ? handler_pool : progress_pool,
+			abt_sampler_ult, s, ABT_THREAD_ATTR_NULL, &s->thread) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create Argobots sampler ULT");
+		__atomic_store_n(&s->running, 0, __ATOMIC_RELEASE);
+		s->thread = ABT_THREAD_NULL;
+		if(s->probe != ABT_THREAD_NULL) {
+			ABT_thread_join(s->probe);
+			ABT_thread_free(&s->probe);
+			s->probe = ABT_THREAD_NULL;
+		}
+		return MDCS_ERROR;
+	}
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_abt_sampler_stop()
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	mdcs_abt_sampler_t s = g_mdcs->abt_sampler;
+	if(s == NULL || s->thread == ABT_THREAD_NULL) {
+		MDCS_PRINT_ERROR("Argobots sampler is not running");
+		return MDCS_ERROR;
+	}
+
+	// the sampler notices the request at its next wake-up
+	__atomic_store_n(&s->running, 0, __ATOMIC_RELEASE);
+	ABT_thread_join(s->thread);
+	ABT_thread_free(&s->thread);
+	s->thread = ABT_THREAD_NULL;
+	if(s->probe != ABT_THREAD_NULL) {
+		ABT_thread_join(s->probe);
+		ABT_thread_free(&s->probe);
+		s->probe = ABT_THREAD_NULL;
+	}
+
+	return MDCS_SUCCESS;
+}
+
+void mdcs_abt_sampler_finalize()
+{
+	mdcs_abt_sampler_t s = g_mdcs->abt_sampler;
+	if(s == NULL) return;
+	if(s->thread != ABT_THREAD_NULL)
+		mdcs_abt_sampler_stop();
+	free(s->pools);
+	free(s);
+	g_mdcs->abt_sampler = NULL;
+}
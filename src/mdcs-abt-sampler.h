@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_ABT_SAMPLER_H
+#define __MDCS_ABT_SAMPLER_H
+
+#include <stdint.h>
+#include <abt.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * Pool sampled by the Argobots sampler. The last sampled sizes are
+ * kept so that the gauges are only pushed the difference with them.
+ */
+typedef struct {
+	ABT_pool       pool;         // sampled pool
+	mdcs_counter_t ready;        // gauge of the ULTs ready to run
+	mdcs_counter_t blocked;      // gauge of the ULTs blocked or suspended
+	int64_t        last_ready;   // last sampled number of ready ULTs
+	int64_t        last_blocked; // last sampled number of blocked ULTs
+} mdcs_abt_pool_sample_t;
+
+/*
+ * State of the Argobots sampler.
+ */
+typedef struct mdcs_abt_sampler_s {
+	mdcs_abt_pool_sample_t* pools;     // sampled pools
+	size_t                  num_pools; // number of sampled pools
+	size_t                  max_pools; // capacity of the pools array
+	mdcs_counter_t          xstreams;  // number of execution streams
+	mdcs_counter_t          lag;       // delay of the sampler's wake-ups
+	double                  interval;  // sampling interval in seconds
+	int                     running;   // whether the sampler ULT should run
+	ABT_thread              thread;    // sampler ULT, ABT_THREAD_NULL if not started
+	ABT_thread              probe;     // ULT measuring the progress pool's lag, if
+	                                   // the progress pool is not the handler pool
+}* mdcs_abt_sampler_t;
+
+/**
+ * Stops the sampler if it is running and frees its state.
+ */
+void mdcs_abt_sampler_finalize();
+
+#endif
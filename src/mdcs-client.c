@@ -4,13 +4,20 @@
  * See COPYRIGHT in top-level directory.
  */
 #include <assert.h>
+#include <string.h>
 #include <mdcs/mdcs.h>
+#include <mdcs/mdcs-margo.h>
 #include "mdcs-global-data.h"
 #include "mdcs-rpc-types.h"
 #include "mdcs-rpc.h"
 #include "mdcs-hash-string.h"
+#include "mdcs-counter-schema.h"
 #include "mdcs-error.h"
 
+/* batches larger than this (in bytes) are pulled by the server
+ * using a bulk transfer instead of being sent inline */
+#define MDCS_PUSH_INLINE_MAX 4096
+
 extern mdcs_t g_mdcs;
 
 int mdcs_remote_counter_get_id(const char* name, mdcs_counter_id_t* counter)
@@ -19,7 +26,12 @@ int mdcs_remote_counter_get_id(const char* name, mdcs_counter_id_t* counter)
 	return MDCS_SUCCESS;
 }
 
-int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* value, size_t size)
+/**
+ * Sends a fetch RPC. Exemplars are requested if max_exemplars is not 0.
+ */
+static int remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter,
+		size_t first, size_t count, void* value, size_t size,
+		mdcs_exemplar_t* exemplars, size_t max_exemplars, size_t* num_exemplars)
 {
 	int result = MDCS_SUCCESS;
 	hg_return_t ret = HG_SUCCESS;
@@ -28,13 +40,19 @@ int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* v
 	fetch_counter_in_t in = {
 		.counter_id = counter,
 		.size = size,
+		.first_slot = first,
+		.num_slots = count,
+		.max_exemplars = max_exemplars,
 		.bulk_handle = HG_BULK_NULL
 	};
 	fetch_counter_out_t out = {
-		.ret = MDCS_SUCCESS
+		.ret = MDCS_SUCCESS,
+		.value_size = 0,
+		.type_id = 0,
+		.exemplars = { 0, NULL }
 	};
 
-	ret = margo_create(g_mdcs->mid, addr, g_mdcs->rpc_fetch_id, &handle);
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_fetch_id, &handle);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_ERROR("Could not create RPC handle");
 		result = MDCS_ERROR;
@@ -49,7 +67,7 @@ int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* v
 		goto cleanup;
 	}
 
-	ret = margo_forward(handle, &in);
+	ret = mdcs_margo_forward(handle, &in);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_ERROR("Count not forward RPC");
 		result = MDCS_ERROR;
@@ -63,6 +81,20 @@ int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* v
 		goto cleanup;
 	}
 
+	result = out.ret;
+	if(result != MDCS_SUCCESS && out.value_size != 0
+	&& size % out.value_size != 0) {
+		MDCS_PRINT_ERROR("Buffer size is not a multiple of the counter's value size"
+				" (use mdcs_remote_counter_type_schema to get the value layout)");
+	}
+
+	if(result == MDCS_SUCCESS && num_exemplars != NULL) {
+		size_t n = out.exemplars.size/sizeof(mdcs_exemplar_t);
+		if(n > max_exemplars) n = max_exemplars;
+		if(n != 0) memcpy(exemplars, out.exemplars.data, n*sizeof(mdcs_exemplar_t));
+		*num_exemplars = n;
+	}
+
 cleanup:
 
 	ret = margo_bulk_free(in.bulk_handle);
@@ -75,7 +107,7 @@ cleanup:
 		MDCS_PRINT_WARNING("Coult not free RPC output");
 	}
 
-	ret = margo_destroy(handle);
+	ret = mdcs_margo_destroy(handle);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_WARNING("Could not destroy RPC handle");
 	}
@@ -83,6 +115,24 @@ cleanup:
 	return result;
 }
 
+int mdcs_remote_counter_fetch(hg_addr_t addr, mdcs_counter_id_t counter, void* value, size_t size)
+{
+	return remote_counter_fetch(addr, counter, 0, 0, value, size, NULL, 0, NULL);
+}
+
+int mdcs_remote_counter_fetch_slots(hg_addr_t addr, mdcs_counter_id_t counter,
+		size_t first, size_t count, void* value, size_t size)
+{
+	return remote_counter_fetch(addr, counter, first, count, value, size, NULL, 0, NULL);
+}
+
+int mdcs_remote_counter_fetch_exemplars(hg_addr_t addr, mdcs_counter_id_t counter,
+		void* value, size_t size, mdcs_exemplar_t* exemplars, size_t max, size_t* num)
+{
+	*num = 0;
+	return remote_counter_fetch(addr, counter, 0, 0, value, size, exemplars, max, num);
+}
+
 int mdcs_remote_counter_reset(hg_addr_t addr, mdcs_counter_id_t counter)
 {
 	int result = MDCS_SUCCESS;
@@ -96,14 +146,14 @@ int mdcs_remote_counter_reset(hg_addr_t addr, mdcs_counter_id_t counter)
 		.ret = MDCS_SUCCESS
 	};
 
-	ret = margo_create(g_mdcs->mid, addr, g_mdcs->rpc_reset_id, &handle);
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_reset_id, &handle);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_ERROR("Could not create RPC handle");
 		result = MDCS_ERROR;
 		goto cleanup;
 	}
 
-	ret = margo_forward(handle, &in);
+	ret = mdcs_margo_forward(handle, &in);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_ERROR("Could not forward RPC");
 		result = MDCS_ERROR;
@@ -124,10 +174,446 @@ cleanup:
 		MDCS_PRINT_WARNING("Could not free output");
 	}
 
-	ret = margo_destroy(handle);
+	ret = mdcs_margo_destroy(handle);
 	if(ret != HG_SUCCESS) {
 		MDCS_PRINT_WARNING("Could not free RPC handle");
 	}
 
 	return result;
 }
+
+int mdcs_remote_counter_push_multi(hg_addr_t addr, mdcs_counter_id_t counter,
+		const void* items, size_t n, size_t itemsize)
+{
+	int result = MDCS_SUCCESS;
+	hg_return_t ret = HG_SUCCESS;
+	hg_handle_t handle = HG_HANDLE_NULL;
+	hg_size_t size = n*itemsize;
+
+	push_counter_in_t in = {
+		.counter_id = counter,
+		.item_size = itemsize,
+		.num_items = n,
+		.items = { .size = 0, .data = NULL },
+		.bulk_handle = HG_BULK_NULL
+	};
+	push_counter_out_t out = {
+		.ret = MDCS_SUCCESS
+	};
+
+	if(n == 0) return MDCS_SUCCESS;
+
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_push_id, &handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	if(size <= MDCS_PUSH_INLINE_MAX) {
+		in.items.size = size;
+		in.items.data = (void*)items;
+	} else {
+		void* buf = (void*)items;
+		ret = margo_bulk_create(g_mdcs->mid, 1, &buf, &size,
+				HG_BULK_READ_ONLY, &(in.bulk_handle));
+		if(ret != HG_SUCCESS) {
+			MDCS_PRINT_ERROR("Could not create bulk handle");
+			result = MDCS_ERROR;
+			goto cleanup;
+		}
+	}
+
+	ret = mdcs_margo_forward(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not forward RPC");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get RPC output");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	result = out.ret;
+
+cleanup:
+
+	ret = margo_bulk_free(in.bulk_handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free bulk handle");
+	}
+
+	ret = margo_free_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free output");
+	}
+
+	ret = mdcs_margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+	}
+
+	return result;
+}
+
+int mdcs_remote_counter_family_aggregate(hg_addr_t addr, mdcs_counter_id_t family,
+		const char* const* label_values, size_t num_labels,
+		void* value, size_t size)
+{
+	int result = MDCS_SUCCESS;
+	hg_return_t ret = HG_SUCCESS;
+	hg_handle_t handle = HG_HANDLE_NULL;
+	size_t i;
+	char* p;
+
+	aggregate_family_in_t in = {
+		.family_id = family,
+		.size = size,
+		.selector = { .size = 0, .data = NULL },
+		.bulk_handle = HG_BULK_NULL
+	};
+	aggregate_family_out_t out = {
+		.ret = MDCS_SUCCESS
+	};
+
+	// pack the selector (see aggregate_family_in_t)
+	for(i=0; i < num_labels; i++) {
+		in.selector.size += 1;
+		if(label_values[i] != NULL)
+			in.selector.size += strlen(label_values[i]) + 1;
+	}
+	in.selector.data = malloc(in.selector.size);
+	if(in.selector.data == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate label selector");
+		return MDCS_ERROR;
+	}
+	p = in.selector.data;
+	for(i=0; i < num_labels; i++) {
+		if(label_values[i] == NULL) {
+			*p++ = 0;
+		} else {
+			size_t len = strlen(label_values[i]) + 1;
+			*p++ = 1;
+			memcpy(p, label_values[i], len);
+			p += len;
+		}
+	}
+
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_aggregate_id, &handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_bulk_create(g_mdcs->mid, 1, &value, &size,
+			HG_BULK_WRITE_ONLY, &(in.bulk_handle));
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create bulk handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = mdcs_margo_forward(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not forward RPC");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get RPC output");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	result = out.ret;
+
+cleanup:
+
+	free(in.selector.data);
+
+	ret = margo_bulk_free(in.bulk_handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free bulk handle");
+	}
+
+	ret = margo_free_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free output");
+	}
+
+	ret = mdcs_margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+	}
+
+	return result;
+}
+
+int mdcs_remote_counter_list(hg_addr_t addr, const char* pattern,
+		const char* start_after, size_t max_entries,
+		mdcs_counter_info_t** infos, size_t* num_infos, int* more)
+{
+	int result = MDCS_SUCCESS;
+	hg_return_t ret = HG_SUCCESS;
+	hg_handle_t handle = HG_HANDLE_NULL;
+	mdcs_counter_info_t* array = NULL;
+
+	list_counters_in_t in = {
+		.pattern = (hg_string_t)(pattern ? pattern : ""),
+		.start_after = (hg_string_t)(start_after ? start_after : ""),
+		.max_entries = max_entries
+	};
+	list_counters_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.num_entries = 0,
+		.more = 0,
+		.entries = { .size = 0, .data = NULL }
+	};
+
+	*infos = NULL;
+	*num_infos = 0;
+	*more = MDCS_FALSE;
+
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_list_id, &handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = mdcs_margo_forward(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not forward RPC");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get RPC output");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	result = out.ret;
+	if(result != MDCS_SUCCESS) goto cleanup;
+
+	// the names are copied right after the array, so the
+	// caller can release everything with a single free()
+	size_t n = out.num_entries;
+	size_t array_size = n*sizeof(mdcs_counter_info_t);
+	array = (mdcs_counter_info_t*)malloc(array_size + out.entries.size + 1);
+	if(array == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate counter list");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	char* names = (char*)array + array_size;
+	const char* p = out.entries.data;
+	const char* end = p + out.entries.size;
+	size_t i;
+	if(out.entries.size) memcpy(names, p, out.entries.size);
+
+	for(i=0; i < n; i++) {
+		mdcs_list_entry_t entry;
+		if(p + sizeof(entry) > end) break;
+		memcpy(&entry, p, sizeof(entry));
+		p += sizeof(entry);
+		const char* eos = memchr(p, '\0', end - p);
+		if(eos == NULL) break;
+		array[i].id = entry.id;
+		array[i].type_id = entry.type_id;
+		array[i].name = names + (p - (const char*)out.entries.data);
+		array[i].item_size = entry.item_size;
+		array[i].value_size = entry.value_size;
+		array[i].num_slots = entry.num_slots;
+		p = eos + 1;
+	}
+	if(i != n) {
+		MDCS_PRINT_ERROR("Malformed counter list received");
+		free(array);
+		array = NULL;
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	*infos = array;
+	*num_infos = n;
+	*more = out.more ? MDCS_TRUE : MDCS_FALSE;
+
+cleanup:
+
+	ret = margo_free_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free output");
+	}
+
+	ret = mdcs_margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+	}
+
+	return result;
+}
+
+int mdcs_remote_counter_type_schema(hg_addr_t addr, mdcs_counter_type_id_t type_id,
+		const mdcs_counter_schema_t** schema)
+{
+	int result = MDCS_SUCCESS;
+	hg_return_t ret = HG_SUCCESS;
+	hg_handle_t handle = HG_HANDLE_NULL;
+	mdcs_schema_entry_t entry = NULL;
+
+	HASH_FIND(hh, g_mdcs->schema_cache, &type_id, sizeof(uint64_t), entry);
+	if(entry != NULL) {
+		*schema = &entry->schema;
+		return MDCS_SUCCESS;
+	}
+
+	get_type_schema_in_t in = {
+		.type_id = type_id
+	};
+	get_type_schema_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.schema = { .size = 0, .data = NULL }
+	};
+
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_schema_id, &handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = mdcs_margo_forward(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not forward RPC");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get RPC output");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	result = out.ret;
+	if(result != MDCS_SUCCESS) goto cleanup;
+
+	entry = mdcs_counter_schema_unpack(out.schema.data, out.schema.size);
+	if(entry == NULL || entry->schema.type_id != type_id) {
+		MDCS_PRINT_ERROR("Malformed counter type schema received");
+		free(entry);
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	// another ULT may have cached the same schema while we were waiting
+	mdcs_schema_entry_t existing = NULL;
+	HASH_FIND(hh, g_mdcs->schema_cache, &type_id, sizeof(uint64_t), existing);
+	if(existing != NULL) {
+		free(entry);
+		entry = existing;
+	} else {
+		HASH_ADD(hh, g_mdcs->schema_cache, schema.type_id, sizeof(uint64_t), entry);
+	}
+
+	*schema = &entry->schema;
+
+cleanup:
+
+	ret = margo_free_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free output");
+	}
+
+	ret = mdcs_margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+	}
+
+	return result;
+}
+
+int mdcs_remote_counter_watch(hg_addr_t addr, mdcs_counter_id_t counter,
+		const mdcs_watch_predicate_t* pred, double timeout,
+		void* value, size_t size, int* fired)
+{
+	int result = MDCS_SUCCESS;
+	hg_return_t ret = HG_SUCCESS;
+	hg_handle_t handle = HG_HANDLE_NULL;
+
+	watch_counter_in_t in = {
+		.counter_id = counter,
+		.op = pred->op,
+		.field_type = pred->field_type,
+		.field_offset = pred->field_offset,
+		.threshold = pred->threshold,
+		.timeout = timeout,
+		.size = size
+	};
+	watch_counter_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.fired = 0,
+		.value = { .size = 0, .data = NULL }
+	};
+
+	*fired = MDCS_FALSE;
+
+	ret = mdcs_margo_create(g_mdcs->mid, addr, g_mdcs->rpc_watch_id, &handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC handle");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	// watches are expected to be long, they are not timed with other RPCs
+	ret = margo_forward(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not forward RPC");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get RPC output");
+		result = MDCS_ERROR;
+		goto cleanup;
+	}
+
+	result = out.ret;
+	if(result == MDCS_SUCCESS) {
+		if(out.value.size != size) {
+			MDCS_PRINT_ERROR("Unexpected value size in watch response");
+			result = MDCS_ERROR;
+		} else {
+			memcpy(value, out.value.data, size);
+			*fired = out.fired ? MDCS_TRUE : MDCS_FALSE;
+		}
+	}
+
+	ret = margo_free_output(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free RPC output");
+	}
+
+cleanup:
+
+	ret = mdcs_margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+	}
+
+	return result;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <stdint.h>
+#include <mdcs/mdcs.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-counter-exemplars.h"
+#include "mdcs-time.h"
+#include "mdcs-error.h"
+
+extern mdcs_t g_mdcs;
+
+mdcs_exemplars_t mdcs_exemplars_create(size_t capacity, double interval)
+{
+	if(capacity > (SIZE_MAX - sizeof(struct mdcs_exemplars_s)) / (2*sizeof(mdcs_exemplar_t)))
+		return NULL;
+
+	// the two heaps are placed right after the structure
+	mdcs_exemplars_t ex = (mdcs_exemplars_t)malloc(sizeof(*ex)
+			+ 2*capacity*sizeof(mdcs_exemplar_t));
+	if(ex == NULL) return NULL;
+	ex->capacity = capacity;
+	ex->interval = interval;
+	ex->current  = (mdcs_exemplar_t*)(ex + 1);
+	ex->previous = ex->current + capacity;
+	mdcs_exemplars_reset(ex);
+	return ex;
+}
+
+void mdcs_exemplars_free(mdcs_exemplars_t ex)
+{
+	free(ex);
+}
+
+void mdcs_exemplars_reset(mdcs_exemplars_t ex)
+{
+	ex->num_current = 0;
+	ex->num_previous = 0;
+	ex->interval_start = mdcs_time_now();
+}
+
+/**
+ * Moves to the interval containing the current time, if the current
+ * interval is over. The current exemplars become the previous ones,
+ * unless more than a whole interval has passed since.
+ */
+static void exemplars_advance(mdcs_exemplars_t ex)
+{
+	if(ex->interval <= 0.0) return;
+	double now = mdcs_time_now();
+	double elapsed = now - ex->interval_start;
+	if(elapsed < ex->interval) return;
+
+	mdcs_exemplar_t* tmp = ex->previous;
+	ex->previous = ex->current;
+	ex->current = tmp;
+	ex->num_previous = elapsed < 2*ex->interval ? ex->num_current : 0;
+	ex->num_current = 0;
+	ex->interval_start += ex->interval*(double)(uint64_t)(elapsed/ex->interval);
+}
+
+void mdcs_exemplars_offer(mdcs_exemplars_t ex, double value, uint64_t tag)
+{
+	exemplars_advance(ex);
+
+	mdcs_exemplar_t* heap = ex->current;
+	size_t n = ex->num_current;
+	size_t i;
+
+	if(n < ex->capacity) {
+		// sift the new exemplar up from the last position
+		i = n;
+		while(i > 0 && heap[(i-1)/2].value > value) {
+			heap[i] = heap[(i-1)/2];
+			i = (i-1)/2;
+		}
+		heap[i].value = value;
+		heap[i].tag = tag;
+		ex->num_current = n+1;
+		return;
+	}
+
+	// common case: not larger than the smallest kept exemplar
+	if(n == 0 || value <= heap[0].value) return;
+
+	// replace the root and sift it down
+	i = 0;
+	while(1) {
+		size_t c = 2*i+1;
+		if(c >= n) break;
+		if(c+1 < n && heap[c+1].value < heap[c].value) c += 1;
+		if(heap[c].value >= value) break;
+		heap[i] = heap[c];
+		i = c;
+	}
+	heap[i].value = value;
+	heap[i].tag = tag;
+}
+
+static int exemplar_compare(const void* a, const void* b)
+{
+	double va = ((const mdcs_exemplar_t*)a)->value;
+	double vb = ((const mdcs_exemplar_t*)b)->value;
+	return (va < vb) - (va > vb);
+}
+
+size_t mdcs_exemplars_collect(mdcs_exemplars_t ex, mdcs_exemplar_t* out, size_t max)
+{
+	exemplars_advance(ex);
+
+	size_t n = ex->num_current + ex->num_previous;
+	if(n == 0 || max == 0) return 0;
+
+	mdcs_exemplar_t* all = (mdcs_exemplar_t*)malloc(n*sizeof(mdcs_exemplar_t));
+	if(all == NULL) return 0;
+	memcpy(all, ex->current, ex->num_current*sizeof(mdcs_exemplar_t));
+	memcpy(all + ex->num_current, ex->previous, ex->num_previous*sizeof(mdcs_exemplar_t));
+	qsort(all, n, sizeof(mdcs_exemplar_t), exemplar_compare);
+
+	if(n > max) n = max;
+	memcpy(out, all, n*sizeof(mdcs_exemplar_t));
+	free(all);
+	return n;
+}
+
+int mdcs_counter_enable_exemplars(mdcs_counter_t counter,
+		size_t max_exemplars, double interval)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to enable exemplars on a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(counter->exemplars != NULL) {
+		MDCS_PRINT_ERROR("Exemplars are already enabled on this counter");
+		return MDCS_ERROR;
+	}
+
+	if(counter->num_slots != 0 || counter->t->lock_free || !counter->t->double_items) {
+		MDCS_PRINT_ERROR("Exemplars require a scalar counter whose items are doubles");
+		return MDCS_ERROR;
+	}
+
+	if(max_exemplars == 0 || interval < 0.0) {
+		MDCS_PRINT_ERROR("Invalid exemplar parameters");
+		return MDCS_ERROR;
+	}
+
+	counter->exemplars = mdcs_exemplars_create(max_exemplars, interval);
+	if(counter->exemplars == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for exemplars");
+		return MDCS_ERROR;
+	}
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_push_tagged(mdcs_counter_t counter, const void* value, uint64_t tag)
+{
+	int ret = mdcs_counter_push(counter, value);
+	if(ret != MDCS_SUCCESS) return ret;
+
+	if(counter->exemplars != NULL) {
+		double v;
+		memcpy(&v, value, sizeof(double));
+		mdcs_exemplars_offer(counter->exemplars, v, tag);
+	}
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_exemplars(mdcs_counter_t counter, mdcs_exemplar_t* exemplars,
+		size_t max, size_t* num)
+{
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to get exemplars of a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(counter->exemplars == NULL) {
+		*num = 0;
+		return MDCS_SUCCESS;
+	}
+
+	*num = mdcs_exemplars_collect(counter->exemplars, exemplars, max);
+	return MDCS_SUCCESS;
+}
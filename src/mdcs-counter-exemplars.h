@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_COUNTER_EXEMPLARS_H
+#define __MDCS_COUNTER_EXEMPLARS_H
+
+#include <stdint.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * Exemplars of a counter: the largest items pushed with a tag during
+ * the current interval and during the previous one. Each set is a
+ * min-heap of fixed capacity, so that an item smaller than the
+ * smallest kept exemplar is rejected in constant time.
+ */
+typedef struct mdcs_exemplars_s {
+	size_t           capacity;       // maximum number of exemplars per interval
+	double           interval;       // duration of an interval, 0 for "until reset"
+	double           interval_start; // start time of the current interval
+	size_t           num_current;    // number of exemplars in the current interval
+	size_t           num_previous;   // number of exemplars in the previous interval
+	mdcs_exemplar_t* current;        // min-heap of the current interval
+	mdcs_exemplar_t* previous;       // min-heap of the previous interval
+}* mdcs_exemplars_t;
+
+/**
+ * Allocates an empty set of exemplars.
+ */
+mdcs_exemplars_t mdcs_exemplars_create(size_t capacity, double interval);
+
+/**
+ * Frees a set of exemplars.
+ */
+void mdcs_exemplars_free(mdcs_exemplars_t ex);
+
+/**
+ * Forgets all the exemplars and starts a new interval.
+ */
+void mdcs_exemplars_reset(mdcs_exemplars_t ex);
+
+/**
+ * Offers an item to the set of exemplars of the current interval.
+ */
+void mdcs_exemplars_offer(mdcs_exemplars_t ex, double value, uint64_t tag);
+
+/**
+ * Copies up to max exemplars of the current and previous intervals
+ * into the provided array, largest first, and returns their number.
+ */
+size_t mdcs_exemplars_collect(mdcs_exemplars_t ex, mdcs_exemplar_t* out, size_t max);
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include "mdcs-global-data.h"
+#include "mdcs-hash-string.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-counter-family.h"
+#include "mdcs-error.h"
+
+/* maximum number of labels in a family, so that label tuples
+ * can be built on the stack when looking up members */
+#define MDCS_FAMILY_MAX_LABELS 32
+
+#define MDCS_LABEL_ANY UINT32_MAX
+
+extern mdcs_t g_mdcs;
+
+/**
+ * Makes sure the array pointed to by array can hold at least
+ * needed elements of size elemsize, doubling its capacity if not.
+ */
+static int ensure_capacity(void** array, size_t* capacity, size_t elemsize, size_t needed)
+{
+	if(needed <= *capacity) return MDCS_SUCCESS;
+	size_t newcap = *capacity ? 2*(*capacity) : 4;
+	while(newcap < needed) newcap *= 2;
+	void* p = realloc(*array, newcap*elemsize);
+	if(p == NULL) return MDCS_ERROR;
+	*array = p;
+	*capacity = newcap;
+	return MDCS_SUCCESS;
+}
+
+static mdcs_label_value_t label_find(mdcs_label_t* label, const char* str)
+{
+	mdcs_label_value_t v = NULL;
+	HASH_FIND_STR(label->value_hash, str, v);
+	return v;
+}
+
+static mdcs_label_value_t label_intern(mdcs_label_t* label, const char* str)
+{
+	mdcs_label_value_t v = label_find(label, str);
+	if(v != NULL) return v;
+
+	if(ensure_capacity((void**)&label->values, &label->max_values,
+			sizeof(mdcs_label_value_t), label->num_values+1) != MDCS_SUCCESS)
+		return NULL;
+
+	v = (mdcs_label_value_t)calloc(1, sizeof(*v));
+	if(v == NULL) return NULL;
+	v->str = strdup(str);
+	if(v->str == NULL) {
+		free(v);
+		return NULL;
+	}
+	v->id = label->num_values;
+
+	label->values[label->num_values] = v;
+	label->num_values += 1;
+	HASH_ADD_KEYPTR(hh, label->value_hash, v->str, strlen(v->str), v);
+	return v;
+}
+
+int mdcs_counter_family_register(const char* name,
+		mdcs_counter_type_t type, size_t num_labels,
+		const char* const* label_names, size_t buffer_size,
+		mdcs_counter_family_t* family)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(num_labels == 0 || num_labels > MDCS_FAMILY_MAX_LABELS) {
+		MDCS_PRINT_ERROR("Invalid number of labels for counter family");
+		return MDCS_ERROR;
+	}
+
+	if(type->lock_free && buffer_size != 0) {
+		MDCS_PRINT_ERROR("Counters of a lock-free type cannot have a buffer");
+		return MDCS_ERROR;
+	}
+
+	uint64_t id = mdcs_hash_string(name);
+	mdcs_counter_t c;
+	mdcs_counter_family_t f;
+	size_t i;
+
+	if(mdcs_counter_find_by_id(id, &c) == MDCS_SUCCESS
+	|| mdcs_counter_family_find_by_id(id, &f) == MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Hash collision or a counter with the same name already exists");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_family_t newfamily = (mdcs_counter_family_t)calloc(1, sizeof(*newfamily));
+	if(newfamily == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for counter family");
+		return MDCS_ERROR;
+	}
+
+	newfamily->name = strdup(name);
+	if(newfamily->name == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for counter family name");
+		goto error;
+	}
+	newfamily->id = id;
+	newfamily->t = type;
+	newfamily->buffer_size = buffer_size;
+	newfamily->num_labels = num_labels;
+	newfamily->labels = (mdcs_label_t*)calloc(num_labels, sizeof(mdcs_label_t));
+	if(newfamily->labels == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for counter family labels");
+		goto error;
+	}
+
+	for(i=0; i < num_labels; i++) {
+		newfamily->labels[i].name = strdup(label_names[i]);
+		if(newfamily->labels[i].name == NULL) {
+			MDCS_PRINT_ERROR("Could not allocate memory for counter family labels");
+			goto error;
+		}
+	}
+
+	// the family holds a reference to its type, built-in types are not counted
+	if(type->refcount > 0) type->refcount += 1;
+
+	HASH_ADD(hh, g_mdcs->family_hash, id, sizeof(uint64_t), newfamily);
+
+	*family = newfamily;
+	return MDCS_SUCCESS;
+
+error:
+	if(newfamily->labels != NULL) {
+		for(i=0; i < num_labels; i++)
+			free(newfamily->labels[i].name);
+		free(newfamily->labels);
+	}
+	free(newfamily->name);
+	free(newfamily);
+	return MDCS_ERROR;
+}
+
+int mdcs_counter_family_find_by_id(uint64_t id, mdcs_counter_family_t* family)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_family_t f;
+	HASH_FIND(hh, g_mdcs->family_hash, &id, sizeof(uint64_t), f);
+	if(f == NULL) return MDCS_ERROR;
+	*family = f;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_family_find_by_name(const char* name, mdcs_counter_family_t* family)
+{
+	uint64_t id = mdcs_hash_string(name);
+	return mdcs_counter_family_find_by_id(id, family);
+}
+
+static mdcs_family_member_t member_find(mdcs_counter_family_t family, const uint32_t* key)
+{
+	mdcs_family_member_t m = NULL;
+	HASH_FIND(hh, family->member_hash, key, family->num_labels*sizeof(uint32_t), m);
+	return m;
+}
+
+static mdcs_family_member_t member_create(mdcs_counter_family_t family,
+		const char* const* label_values)
+{
+	size_t i;
+	size_t n = family->num_labels;
+	mdcs_label_value_t values[MDCS_FAMILY_MAX_LABELS];
+
+	if(ensure_capacity((void**)&family->members, &family->max_members,
+			sizeof(mdcs_family_member_t), family->num_members+1) != MDCS_SUCCESS)
+		return NULL;
+
+	for(i=0; i < n; i++) {
+		values[i] = label_intern(&family->labels[i], label_values[i]);
+		if(values[i] == NULL) return NULL;
+		if(ensure_capacity((void**)&values[i]->members, &values[i]->max_members,
+				sizeof(size_t), values[i]->num_members+1) != MDCS_SUCCESS)
+			return NULL;
+	}
+
+	mdcs_family_member_t m = (mdcs_family_member_t)malloc(sizeof(*m) + n*sizeof(uint32_t));
+	if(m == NULL) return NULL;
+
+	if(mdcs_counter_create(NULL, family->id, family->t,
+			family->buffer_size, 0, &m->counter) != MDCS_SUCCESS) {
+		free(m);
+		return NULL;
+	}
+
+	for(i=0; i < n; i++) {
+		m->labels[i] = values[i]->id;
+		values[i]->members[values[i]->num_members] = family->num_members;
+		values[i]->num_members += 1;
+	}
+
+	family->members[family->num_members] = m;
+	family->num_members += 1;
+	HASH_ADD_KEYPTR(hh, family->member_hash, m->labels, n*sizeof(uint32_t), m);
+
+	return m;
+}
+
+int mdcs_counter_family_get(mdcs_counter_family_t family,
+		const char* const* label_values, mdcs_counter_t* counter)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(family == MDCS_COUNTER_FAMILY_NULL) {
+		MDCS_PRINT_ERROR("Trying to get a member of a NULL family");
+		return MDCS_ERROR;
+	}
+
+	size_t i;
+	uint32_t key[MDCS_FAMILY_MAX_LABELS];
+	mdcs_family_member_t m = NULL;
+
+	// all the values are checked, since the lookup may stop at the first new one
+	for(i=0; i < family->num_labels; i++) {
+		if(label_values[i] == NULL) {
+			MDCS_PRINT_ERROR("Missing label value for counter family member");
+			return MDCS_ERROR;
+		}
+	}
+
+	for(i=0; i < family->num_labels; i++) {
+		mdcs_label_value_t v = label_find(&family->labels[i], label_values[i]);
+		if(v == NULL) break;
+		key[i] = v->id;
+	}
+
+	if(i == family->num_labels)
+		m = member_find(family, key);
+
+	if(m == NULL) {
+		m = member_create(family, label_values);
+		if(m == NULL) {
+			MDCS_PRINT_ERROR("Could not create counter family member");
+			return MDCS_ERROR;
+		}
+	}
+
+	*counter = m->counter;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_family_aggregate(mdcs_counter_family_t family,
+		const char* const* label_values, void* value)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(family == MDCS_COUNTER_FAMILY_NULL) {
+		MDCS_PRINT_ERROR("Trying to aggregate a NULL family");
+		return MDCS_ERROR;
+	}
+
+	size_t i, j;
+	uint32_t selector[MDCS_FAMILY_MAX_LABELS];
+	mdcs_label_value_t smallest = NULL;
+	mdcs_counter_type_t t = family->t;
+	int found = 0;
+	int ret = MDCS_SUCCESS;
+	void* other = NULL;
+
+	// resolve the selector and pick the label value with the fewest
+	// members, whose member list is the only one we will scan
+	for(i=0; i < family->num_labels; i++) {
+		if(label_values == NULL || label_values[i] == NULL) {
+			selector[i] = MDCS_LABEL_ANY;
+			continue;
+		}
+		mdcs_label_value_t v = label_find(&family->labels[i], label_values[i]);
+		if(v == NULL) goto empty;
+		selector[i] = v->id;
+		if(smallest == NULL || v->num_members < smallest->num_members)
+			smallest = v;
+	}
+
+	size_t num_candidates = smallest ? smallest->num_members : family->num_members;
+
+	for(j=0; j < num_candidates; j++) {
+		size_t idx = smallest ? smallest->members[j] : j;
+		mdcs_family_member_t m = family->members[idx];
+
+		for(i=0; i < family->num_labels; i++) {
+			if(selector[i] != MDCS_LABEL_ANY && selector[i] != m->labels[i])
+				break;
+		}
+		if(i != family->num_labels) continue;
+
+		if(!found) {
+			ret = mdcs_counter_value(m->counter, value);
+			if(ret != MDCS_SUCCESS) goto finish;
+			found = 1;
+			continue;
+		}
+
+		if(!mdcs_counter_type_can_merge(t)) {
+			MDCS_PRINT_ERROR("Counter type does not support merging values");
+			ret = MDCS_ERROR;
+			goto finish;
+		}
+		if(other == NULL) {
+			other = malloc(t->counter_value_size);
+			if(other == NULL) {
+				MDCS_PRINT_ERROR("Could not allocate memory for value");
+				ret = MDCS_ERROR;
+				goto finish;
+			}
+		}
+		ret = mdcs_counter_value(m->counter, other);
+		if(ret != MDCS_SUCCESS) goto finish;
+		ret = mdcs_counter_type_merge_values(t, value, other);
+		if(ret != MDCS_SUCCESS) goto finish;
+	}
+
+	if(found) goto finish;
+
+empty:
+	// no member matches, return the value of a freshly reset counter
+	other = mdcs_counter_type_create_data(t);
+	if(other == NULL) {
+		MDCS_PRINT_ERROR("Could not create counter's internal data");
+		return MDCS_ERROR;
+	}
+	t->reset_f(other);
+	t->get_value_f(other, value);
+	t->destroy_f(other);
+	return MDCS_SUCCESS;
+
+finish:
+	free(other);
+	return ret;
+}
+
+void mdcs_counter_family_free(mdcs_counter_family_t family)
+{
+	size_t i, j;
+
+	HASH_CLEAR(hh, family->member_hash);
+	for(i=0; i < family->num_members; i++) {
+		mdcs_counter_free(family->members[i]->counter);
+		free(family->members[i]);
+	}
+	free(family->members);
+
+	for(i=0; i < family->num_labels; i++) {
+		mdcs_label_t* label = &family->labels[i];
+		HASH_CLEAR(hh, label->value_hash);
+		for(j=0; j < label->num_values; j++) {
+			free(label->values[j]->str);
+			free(label->values[j]->members);
+			free(label->values[j]);
+		}
+		free(label->values);
+		free(label->name);
+	}
+	free(family->labels);
+
+	mdcs_counter_type_destroy(family->t);
+	free(family->name);
+	free(family);
+}
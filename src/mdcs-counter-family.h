@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_COUNTER_FAMILY_H
+#define __MDCS_COUNTER_FAMILY_H
+
+#include <stdint.h>
+#include <mdcs/mdcs.h>
+#include "uthash.h"
+
+/*
+ * Interned value of a label. Each distinct value of a label is stored
+ * once and identified by a small integer. The entry also indexes the
+ * members of the family that carry this value, so that aggregations
+ * over a label only visit the relevant members.
+ */
+typedef struct mdcs_label_value_s {
+	char*    str;          // string value of the label
+	uint32_t id;           // interned id of the value
+	size_t*  members;      // indices of the members carrying this value
+	size_t   num_members;  // number of such members
+	size_t   max_members;  // capacity of the members array
+	UT_hash_handle hh;     // values are placed in a hash by string
+}* mdcs_label_value_t;
+
+/*
+ * Interning table of a single label.
+ */
+typedef struct mdcs_label_s {
+	char*               name;       // name of the label
+	mdcs_label_value_t  value_hash; // values by string
+	mdcs_label_value_t* values;     // values by interned id
+	size_t              num_values; // number of distinct values
+	size_t              max_values; // capacity of the values array
+} mdcs_label_t;
+
+/*
+ * Member of a family, keyed by the tuple of interned label ids.
+ */
+typedef struct mdcs_family_member_s {
+	mdcs_counter_t counter;  // counter holding the member's data
+	UT_hash_handle hh;       // members are placed in a hash by label tuple
+	uint32_t labels[];       // interned id of each label value
+}* mdcs_family_member_t;
+
+struct mdcs_counter_family_s {
+	char* name;                    // name of the family
+	uint64_t id;                   // id of the family
+	mdcs_counter_type_t t;         // type of the member counters
+	size_t buffer_size;            // buffer size of the member counters
+	size_t num_labels;             // number of labels
+	mdcs_label_t* labels;          // interning table of each label
+	mdcs_family_member_t member_hash; // members by label tuple
+	mdcs_family_member_t* members; // members by index
+	size_t num_members;            // number of members
+	size_t max_members;            // capacity of the members array
+	UT_hash_handle hh;             // families are placed in a hash by id
+};
+
+/**
+ * Finds a counter family by its id.
+ */
+int mdcs_counter_family_find_by_id(uint64_t id, mdcs_counter_family_t* family);
+
+/**
+ * Frees a family and all its members. The family must have been
+ * removed from the global family hash.
+ */
+void mdcs_counter_family_free(mdcs_counter_family_t family);
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include "mdcs-global-data.h"
+#include "mdcs-hash-string.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter-schema.h"
+#include "mdcs-rpc-types.h"
+#include "mdcs-error.h"
+
+extern mdcs_t g_mdcs;
+
+size_t mdcs_field_type_size(mdcs_field_type_t type)
+{
+	switch(type) {
+	case MDCS_FIELD_INT8:
+	case MDCS_FIELD_UINT8:
+		return 1;
+	case MDCS_FIELD_INT32:
+	case MDCS_FIELD_UINT32:
+	case MDCS_FIELD_FLOAT:
+		return 4;
+	case MDCS_FIELD_INT64:
+	case MDCS_FIELD_UINT64:
+	case MDCS_FIELD_DOUBLE:
+		return 8;
+	}
+	return 0;
+}
+
+/**
+ * Checks that the fields of a schema are well-formed and
+ * fit in a value of the provided size.
+ */
+static int fields_check(const mdcs_counter_field_t* fields,
+		size_t num_fields, size_t value_size)
+{
+	size_t i;
+	for(i=0; i < num_fields; i++) {
+		size_t s = mdcs_field_type_size(fields[i].type);
+		if(fields[i].name == NULL || s == 0 || fields[i].count == 0)
+			return MDCS_ERROR;
+		if(fields[i].offset > value_size
+		|| fields[i].count > (value_size - fields[i].offset)/s)
+			return MDCS_ERROR;
+	}
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_find_by_id(uint64_t id, mdcs_counter_type_t* type)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_type_t t;
+	HASH_FIND(hh, g_mdcs->type_hash, &id, sizeof(uint64_t), t);
+	if(t == NULL) return MDCS_ERROR;
+	*type = t;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_find_by_name(const char* name, mdcs_counter_type_t* type)
+{
+	uint64_t id = mdcs_hash_string(name);
+	return mdcs_counter_type_find_by_id(id, type);
+}
+
+int mdcs_counter_type_register(const char* name, mdcs_counter_type_t type,
+		const mdcs_counter_field_t* fields, size_t num_fields)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(type == MDCS_COUNTER_TYPE_NULL) {
+		MDCS_PRINT_ERROR("Trying to register a NULL counter type");
+		return MDCS_ERROR;
+	}
+
+	if(type->schema.type_name != NULL) {
+		MDCS_PRINT_ERROR("Counter type is already registered");
+		return MDCS_ERROR;
+	}
+
+	if(num_fields == 0
+	|| fields_check(fields, num_fields, type->counter_value_size) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Invalid counter type schema");
+		return MDCS_ERROR;
+	}
+
+	uint64_t id = mdcs_hash_string(name);
+	mdcs_counter_type_t t;
+	if(mdcs_counter_type_find_by_id(id, &t) == MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Hash collision or a type with the same name already exists");
+		return MDCS_ERROR;
+	}
+
+	// the fields, the type name and the field names share a single allocation
+	size_t i;
+	size_t size = num_fields*sizeof(mdcs_counter_field_t) + strlen(name) + 1;
+	for(i=0; i < num_fields; i++)
+		size += strlen(fields[i].name) + 1;
+
+	mdcs_counter_field_t* f = (mdcs_counter_field_t*)malloc(size);
+	if(f == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for counter type schema");
+		return MDCS_ERROR;
+	}
+
+	char* str = (char*)(f + num_fields);
+	size_t len = strlen(name) + 1;
+	memcpy(str, name, len);
+	type->schema.type_name = str;
+	str += len;
+
+	for(i=0; i < num_fields; i++) {
+		f[i] = fields[i];
+		len = strlen(fields[i].name) + 1;
+		memcpy(str, fields[i].name, len);
+		f[i].name = str;
+		str += len;
+	}
+
+	type->schema.type_id    = id;
+	type->schema.item_size  = type->counter_item_size;
+	type->schema.value_size = type->counter_value_size;
+	type->schema.num_fields = num_fields;
+	type->schema.fields     = f;
+
+	// the registry holds a reference to the type
+	if(type->refcount > 0) type->refcount += 1;
+
+	HASH_ADD(hh, g_mdcs->type_hash, schema.type_id, sizeof(uint64_t), type);
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_get_schema(mdcs_counter_type_t type,
+		const mdcs_counter_schema_t** schema)
+{
+	if(type == MDCS_COUNTER_TYPE_NULL || type->schema.type_name == NULL) {
+		MDCS_PRINT_ERROR("Counter type is not registered");
+		return MDCS_ERROR;
+	}
+	*schema = &type->schema;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_types_init()
+{
+	size_t i;
+	for(i=0; mdcs_builtin_counter_types[i] != NULL; i++) {
+		mdcs_counter_type_t t = mdcs_builtin_counter_types[i];
+		t->schema.type_id = mdcs_hash_string(t->schema.type_name);
+		HASH_ADD(hh, g_mdcs->type_hash, schema.type_id, sizeof(uint64_t), t);
+	}
+	return MDCS_SUCCESS;
+}
+
+void mdcs_counter_types_finalize()
+{
+	mdcs_counter_type_t current_type, tmp_type;
+
+	HASH_ITER(hh, g_mdcs->type_hash, current_type, tmp_type) {
+		HASH_DEL(g_mdcs->type_hash, current_type);
+		mdcs_counter_type_destroy(current_type);
+	}
+
+	mdcs_schema_entry_t current_entry, tmp_entry;
+
+	HASH_ITER(hh, g_mdcs->schema_cache, current_entry, tmp_entry) {
+		HASH_DEL(g_mdcs->schema_cache, current_entry);
+		free(current_entry);
+	}
+}
+
+int mdcs_counter_schema_pack(const mdcs_counter_schema_t* schema,
+		void** buf, size_t* size)
+{
+	size_t i;
+	size_t s = sizeof(mdcs_schema_header_t) + strlen(schema->type_name) + 1;
+	for(i=0; i < schema->num_fields; i++)
+		s += sizeof(mdcs_schema_field_entry_t) + strlen(schema->fields[i].name) + 1;
+
+	char* b = (char*)malloc(s);
+	if(b == NULL) return MDCS_ERROR;
+
+	mdcs_schema_header_t header = {
+		.type_id = schema->type_id,
+		.item_size = schema->item_size,
+		.value_size = schema->value_size,
+		.num_fields = schema->num_fields
+	};
+	char* p = b;
+	memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	size_t len = strlen(schema->type_name) + 1;
+	memcpy(p, schema->type_name, len);
+	p += len;
+
+	for(i=0; i < schema->num_fields; i++) {
+		mdcs_schema_field_entry_t entry = {
+			.offset = schema->fields[i].offset,
+			.count = schema->fields[i].count,
+			.type = schema->fields[i].type,
+			.reserved = 0
+		};
+		memcpy(p, &entry, sizeof(entry));
+		p += sizeof(entry);
+		len = strlen(schema->fields[i].name) + 1;
+		memcpy(p, schema->fields[i].name, len);
+		p += len;
+	}
+
+	*buf = b;
+	*size = s;
+	return MDCS_SUCCESS;
+}
+
+mdcs_schema_entry_t mdcs_counter_schema_unpack(const void* buf, size_t size)
+{
+	mdcs_schema_header_t header;
+	const char* p = (const char*)buf;
+	const char* end = p + size;
+
+	if(size < sizeof(header)) return NULL;
+	memcpy(&header, p, sizeof(header));
+	p += sizeof(header);
+
+	if(header.num_fields == 0
+	|| header.num_fields > size/sizeof(mdcs_schema_field_entry_t))
+		return NULL;
+
+	// the strings are copied after the fields, they cannot
+	// take more space than the whole packed buffer
+	size_t n = header.num_fields;
+	mdcs_schema_entry_t e = (mdcs_schema_entry_t)malloc(sizeof(*e)
+			+ n*sizeof(mdcs_counter_field_t) + size);
+	if(e == NULL) return NULL;
+
+	mdcs_counter_field_t* fields = (mdcs_counter_field_t*)(e + 1);
+	char* str = (char*)(fields + n);
+	size_t i;
+
+	const char* eos = memchr(p, '\0', end - p);
+	if(eos == NULL) goto error;
+	memcpy(str, p, eos - p + 1);
+	e->schema.type_name = str;
+	str += eos - p + 1;
+	p = eos + 1;
+
+	for(i=0; i < n; i++) {
+		mdcs_schema_field_entry_t entry;
+		if((size_t)(end - p) < sizeof(entry)) goto error;
+		memcpy(&entry, p, sizeof(entry));
+		p += sizeof(entry);
+		eos = memchr(p, '\0', end - p);
+		if(eos == NULL) goto error;
+		memcpy(str, p, eos - p + 1);
+		fields[i].name = str;
+		fields[i].type = (mdcs_field_type_t)entry.type;
+		fields[i].offset = entry.offset;
+		fields[i].count = entry.count;
+		str += eos - p + 1;
+		p = eos + 1;
+	}
+
+	if(fields_check(fields, n, header.value_size) != MDCS_SUCCESS)
+		goto error;
+
+	e->schema.type_id = header.type_id;
+	e->schema.item_size = header.item_size;
+	e->schema.value_size = header.value_size;
+	e->schema.num_fields = n;
+	e->schema.fields = fields;
+	return e;
+
+error:
+	free(e);
+	return NULL;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_COUNTER_SCHEMA_H
+#define __MDCS_COUNTER_SCHEMA_H
+
+#include <stdint.h>
+#include <mdcs/mdcs.h>
+#include "uthash.h"
+
+/*
+ * Schema received from a remote server and cached on the client.
+ * The fields and all the strings are allocated along with the entry.
+ */
+typedef struct mdcs_schema_entry_s {
+	mdcs_counter_schema_t schema; // decoded schema
+	UT_hash_handle hh;            // entries are placed in a hash by type id
+}* mdcs_schema_entry_t;
+
+/**
+ * Registers the built-in counter types.
+ */
+int mdcs_counter_types_init();
+
+/**
+ * Releases the registered types and the cached remote schemas.
+ */
+void mdcs_counter_types_finalize();
+
+/**
+ * Finds a registered counter type by its id.
+ */
+int mdcs_counter_type_find_by_id(uint64_t id, mdcs_counter_type_t* type);
+
+/**
+ * Packs a schema into a newly allocated buffer, to be sent over RPC.
+ */
+int mdcs_counter_schema_pack(const mdcs_counter_schema_t* schema,
+		void** buf, size_t* size);
+
+/**
+ * Unpacks a schema received over RPC into a newly allocated cache entry.
+ * Returns NULL if the buffer is malformed or memory could not be allocated.
+ */
+mdcs_schema_entry_t mdcs_counter_schema_unpack(const void* buf, size_t size);
+
+#endif
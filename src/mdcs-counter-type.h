@@ -7,6 +7,12 @@
 #define __MDCS_COUNTER_TYPE_H
 
 #include <stdint.h>
+#include "uthash.h"
+
+/* function used to allocate the internal data of a parameterized type */
+typedef void* (*mdcs_create_args_f)(const void* args);
+/* function used to merge two values of a parameterized type */
+typedef int (*mdcs_merge_args_f)(const void* args, void* val, const void* other_val);
 
 struct mdcs_counter_type_s {
 	size_t            counter_item_size;  // size of items pushed into the counter
@@ -17,7 +23,50 @@ struct mdcs_counter_type_s {
 	mdcs_get_value_f  get_value_f;        // function used to get the value of the counter
 	mdcs_push_one_f   push_one_f;         // function used to push a new value to a counter
 	mdcs_push_multi_f push_multi_f;       // function used to push multiple values to a counter
+	mdcs_merge_f      merge_f;            // function used to merge two values (optional)
+	size_t            counter_data_size;  // size of the internal data if it is a flat block, 0 otherwise
+	mdcs_create_args_f create_args_f;     // used instead of create_f if set, called with args
+	mdcs_merge_args_f merge_args_f;       // used instead of merge_f if set, called with args
+	void*             args;               // parameters of the type, freed along with the type
+	int               lock_free;          // pushes are thread-safe and are never buffered
+	int               double_items;       // items are single doubles, as exemplars require
+	mdcs_counter_schema_t schema;         // name and value layout, type_name is NULL if not registered
+	UT_hash_handle    hh;                 // registered types are placed in a hash by type id
 	int refcount;                         // number of objects pointing to this counter type
 };
 
+/**
+ * Allocates the internal data of a counter of the provided type.
+ */
+static inline void* mdcs_counter_type_create_data(struct mdcs_counter_type_s* type)
+{
+	if(type->create_args_f != NULL)
+		return type->create_args_f(type->args);
+	return type->create_f();
+}
+
+/**
+ * Checks whether values of the provided type can be merged.
+ */
+static inline int mdcs_counter_type_can_merge(struct mdcs_counter_type_s* type)
+{
+	return type->merge_f != NULL || type->merge_args_f != NULL;
+}
+
+/**
+ * Merges other_val into val, the type must support merging.
+ * Returns MDCS_ERROR if the values cannot be merged.
+ */
+static inline int mdcs_counter_type_merge_values(struct mdcs_counter_type_s* type,
+		void* val, const void* other_val)
+{
+	if(type->merge_args_f != NULL)
+		return type->merge_args_f(type->args, val, other_val);
+	else
+		return type->merge_f(val, other_val);
+}
+
+/* NULL-terminated list of the built-in counter types */
+extern struct mdcs_counter_type_s* const mdcs_builtin_counter_types[];
+
 #endif
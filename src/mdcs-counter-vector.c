@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include "mdcs-global-data.h"
+#include "mdcs-hash-string.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-counter-family.h"
+#include "mdcs-error.h"
+
+/* contiguous slots are aligned on cache lines, and padded
+ * to a multiple of this alignment for their internal values */
+#define MDCS_SLOT_BLOCK_ALIGN 64
+#define MDCS_SLOT_ALIGN       8
+
+extern mdcs_t g_mdcs;
+
+void* mdcs_counter_slots_create(mdcs_counter_type_t type,
+		size_t num_slots, size_t* stride)
+{
+	size_t i;
+
+	if(type->counter_data_size == 0) {
+		// the internal data may hold pointers, create each slot separately
+		void** slots = (void**)calloc(num_slots, sizeof(void*));
+		if(slots == NULL) return NULL;
+		for(i=0; i < num_slots; i++) {
+			slots[i] = mdcs_counter_type_create_data(type);
+			if(slots[i] == NULL) {
+				while(i > 0) type->destroy_f(slots[--i]);
+				free(slots);
+				return NULL;
+			}
+		}
+		*stride = 0;
+		return slots;
+	}
+
+	// flat internal data: create one instance and copy it into each slot
+	size_t s = (type->counter_data_size + MDCS_SLOT_ALIGN - 1) & ~(size_t)(MDCS_SLOT_ALIGN - 1);
+	void* proto = mdcs_counter_type_create_data(type);
+	if(proto == NULL) return NULL;
+
+	void* block = NULL;
+	if(posix_memalign(&block, MDCS_SLOT_BLOCK_ALIGN, s*num_slots) != 0) {
+		type->destroy_f(proto);
+		return NULL;
+	}
+	for(i=0; i < num_slots; i++) {
+		memcpy((char*)block + i*s, proto, type->counter_data_size);
+	}
+	type->destroy_f(proto);
+
+	*stride = s;
+	return block;
+}
+
+void mdcs_counter_slots_destroy(mdcs_counter_t counter)
+{
+	if(counter->slot_stride == 0) {
+		size_t i;
+		void** slots = (void**)(counter->counter_internal_data);
+		for(i=0; i < counter->num_slots; i++)
+			counter->t->destroy_f(slots[i]);
+	}
+	free(counter->counter_internal_data);
+}
+
+int mdcs_counter_vector_register(const char* name,
+		mdcs_counter_type_t type, size_t num_slots,
+		mdcs_counter_t* counter)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(num_slots == 0) {
+		MDCS_PRINT_ERROR("A vector counter needs at least one slot");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_t c;
+	mdcs_counter_family_t f;
+	int ret;
+
+	uint64_t id = mdcs_hash_string(name);
+
+	if(mdcs_counter_find_by_id(id, &c) == MDCS_SUCCESS
+	|| mdcs_counter_family_find_by_id(id, &f) == MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Hash collision or a counter with the same name already exists");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_t newcounter = MDCS_COUNTER_NULL;
+	ret = mdcs_counter_create(name, id, type, 0, num_slots, &newcounter);
+	if(ret != MDCS_SUCCESS) {
+		return MDCS_ERROR;
+	}
+
+	ret = mdcs_name_trie_insert(&g_mdcs->counter_trie, name, newcounter);
+	if(ret != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not index counter name");
+		mdcs_counter_free(newcounter);
+		return MDCS_ERROR;
+	}
+
+	HASH_ADD(hh, g_mdcs->counter_hash, id, sizeof(uint64_t), newcounter);
+
+	*counter = newcounter;
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_vector_size(mdcs_counter_t counter, size_t* num_slots)
+{
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to get the size of a NULL counter");
+		return MDCS_ERROR;
+	}
+	*num_slots = counter->num_slots;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_vector_push(mdcs_counter_t counter, size_t slot, const void* value)
+{
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to push in a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(slot >= counter->num_slots) {
+		MDCS_PRINT_ERROR("Slot index out of range");
+		return MDCS_ERROR;
+	}
+
+	counter->t->push_one_f(mdcs_counter_slot_data(counter, slot), value);
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_vector_push_multi(mdcs_counter_t counter, size_t slot,
+		const void* values, size_t num)
+{
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to push in a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(slot >= counter->num_slots) {
+		MDCS_PRINT_ERROR("Slot index out of range");
+		return MDCS_ERROR;
+	}
+
+	if(num == 0) return MDCS_SUCCESS;
+
+	void* data = mdcs_counter_slot_data(counter, slot);
+	if(counter->t->push_multi_f != NULL) {
+		counter->t->push_multi_f(data, values, num);
+	} else {
+		size_t i;
+		const char* value = values;
+		for(i=0; i < num; i++) {
+			counter->t->push_one_f(data, value);
+			value += counter->t->counter_item_size;
+		}
+	}
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_vector_value(mdcs_counter_t counter, size_t first,
+		size_t count, void* values)
+{
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to get value of a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(first > counter->num_slots || count > counter->num_slots - first) {
+		MDCS_PRINT_ERROR("Slot range out of bounds");
+		return MDCS_ERROR;
+	}
+
+	size_t i;
+	char* v = values;
+	for(i=first; i < first+count; i++) {
+		counter->t->get_value_f(mdcs_counter_slot_data(counter, i), v);
+		v += counter->t->counter_value_size;
+	}
+
+	return MDCS_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <mdcs/mdcs.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-counter-watch.h"
+#include "mdcs-time.h"
+#include "mdcs-error.h"
+
+/* longest a watch may wait, in seconds; longer timeouts are clamped */
+#define MDCS_WATCH_MAX_TIMEOUT 3600.0
+
+extern mdcs_t g_mdcs;
+
+/**
+ * Reads a field of a value and converts it into a double.
+ */
+static double field_as_double(const void* value, mdcs_field_type_t type, size_t offset)
+{
+	const char* p = (const char*)value + offset;
+	switch(type) {
+	case MDCS_FIELD_INT8:   { int8_t v;   memcpy(&v, p, sizeof(v)); return v; }
+	case MDCS_FIELD_UINT8:  { uint8_t v;  memcpy(&v, p, sizeof(v)); return v; }
+	case MDCS_FIELD_INT32:  { int32_t v;  memcpy(&v, p, sizeof(v)); return v; }
+	case MDCS_FIELD_UINT32: { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+	case MDCS_FIELD_INT64:  { int64_t v;  memcpy(&v, p, sizeof(v)); return (double)v; }
+	case MDCS_FIELD_UINT64: { uint64_t v; memcpy(&v, p, sizeof(v)); return (double)v; }
+	case MDCS_FIELD_FLOAT:  { float v;    memcpy(&v, p, sizeof(v)); return v; }
+	case MDCS_FIELD_DOUBLE: { double v;   memcpy(&v, p, sizeof(v)); return v; }
+	}
+	return 0.0;
+}
+
+int mdcs_watch_predicate_check(const mdcs_watch_predicate_t* pred, size_t value_size)
+{
+	size_t s = mdcs_field_type_size(pred->field_type);
+	if(s == 0 || pred->field_offset > value_size || s > value_size - pred->field_offset)
+		return MDCS_ERROR;
+	switch(pred->op) {
+	case MDCS_WATCH_ABOVE:
+	case MDCS_WATCH_BELOW:
+	case MDCS_WATCH_RATE_ABOVE:
+		return MDCS_SUCCESS;
+	}
+	return MDCS_ERROR;
+}
+
+/**
+ * Evaluates the predicate of a watch on a value of the counter.
+ */
+static int watch_evaluate(mdcs_watch_t w, const void* value, double now)
+{
+	double v = field_as_double(value, w->pred.field_type, w->pred.field_offset);
+	switch(w->pred.op) {
+	case MDCS_WATCH_ABOVE:
+		return v > w->pred.threshold;
+	case MDCS_WATCH_BELOW:
+		return v < w->pred.threshold;
+	case MDCS_WATCH_RATE_ABOVE: {
+		double dt = now - w->ref_time;
+		if(dt < MDCS_WATCH_RATE_PERIOD) return 0;
+		double rate = (v - w->ref_value)/dt;
+		w->ref_value = v;
+		w->ref_time = now;
+		return fabs(rate) > w->pred.threshold;
+	}
+	}
+	return 0;
+}
+
+void mdcs_counter_watch_notify(mdcs_counter_t counter)
+{
+	ABT_mutex_lock(g_mdcs->watch_mutex);
+
+	mdcs_watch_t* prev = &counter->watches;
+	mdcs_watch_t w = counter->watches;
+	if(w != NULL) {
+		// all the watches of a counter share the same value
+		void* value = w->value;
+		double now = mdcs_time_now();
+		counter->t->get_value_f(counter->counter_internal_data, value);
+		while(w != NULL) {
+			mdcs_watch_t next = w->next;
+			if(w->value != value) memcpy(w->value, value, counter->t->counter_value_size);
+			if(watch_evaluate(w, w->value, now)) {
+				w->fired = 1;
+				*prev = next;
+				ABT_cond_signal(w->cond);
+			} else {
+				prev = &w->next;
+			}
+			w = next;
+		}
+	}
+
+	ABT_mutex_unlock(g_mdcs->watch_mutex);
+}
+
+void mdcs_counter_watch_release(mdcs_counter_t counter)
+{
+	ABT_mutex_lock(g_mdcs->watch_mutex);
+
+	mdcs_watch_t w = counter->watches;
+	while(w != NULL) {
+		mdcs_watch_t next = w->next;
+		w->counter = MDCS_COUNTER_NULL;
+		ABT_cond_signal(w->cond);
+		w = next;
+	}
+	counter->watches = NULL;
+
+	ABT_mutex_unlock(g_mdcs->watch_mutex);
+}
+
+void mdcs_counter_watch_finalize()
+{
+	mdcs_counter_t current_counter, tmp;
+
+	ABT_mutex_lock(g_mdcs->watch_mutex);
+	g_mdcs->watch_closed = 1;
+	ABT_mutex_unlock(g_mdcs->watch_mutex);
+
+	HASH_ITER(hh, g_mdcs->counter_hash, current_counter, tmp) {
+		mdcs_counter_watch_release(current_counter);
+	}
+
+	// parked ULTs may still need the counters and the mutex once woken up
+	while(__atomic_load_n(&g_mdcs->watch_parked, __ATOMIC_ACQUIRE) != 0)
+		ABT_thread_yield();
+}
+
+int mdcs_counter_watch_wait(mdcs_counter_t counter, const mdcs_watch_predicate_t* pred,
+		double timeout, void* value, int* fired)
+{
+	struct mdcs_watch_s w;
+	int ret;
+
+	if(counter->num_slots != 0) {
+		MDCS_PRINT_ERROR("Watches are not supported on vector counters");
+		return MDCS_ERROR;
+	}
+
+	if(mdcs_watch_predicate_check(pred, counter->t->counter_value_size) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Invalid watch predicate");
+		return MDCS_ERROR;
+	}
+
+	if(isnan(timeout)) {
+		MDCS_PRINT_ERROR("Invalid watch timeout");
+		return MDCS_ERROR;
+	}
+	if(timeout > MDCS_WATCH_MAX_TIMEOUT) timeout = MDCS_WATCH_MAX_TIMEOUT;
+
+	ret = mdcs_counter_value(counter, value);
+	if(ret != MDCS_SUCCESS) return ret;
+
+	w.counter   = counter;
+	w.pred      = *pred;
+	w.ref_value = field_as_double(value, pred->field_type, pred->field_offset);
+	w.ref_time  = mdcs_time_now();
+	w.fired     = 0;
+	w.value     = value;
+	w.cond      = ABT_COND_NULL;
+	w.next      = NULL;
+
+	// rate predicates need a reference point, the others may fire right away
+	if(pred->op != MDCS_WATCH_RATE_ABOVE && watch_evaluate(&w, value, w.ref_time)) {
+		*fired = 1;
+		return MDCS_SUCCESS;
+	}
+
+	if(timeout <= 0.0) {
+		*fired = 0;
+		return MDCS_SUCCESS;
+	}
+
+	if(ABT_cond_create(&w.cond) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create condition variable");
+		return MDCS_ERROR;
+	}
+
+	// condition variables wait until an absolute time of the realtime clock
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	double secs = floor(timeout);
+	deadline.tv_sec += (time_t)secs;
+	deadline.tv_nsec += (long)((timeout - secs)*1e9);
+	if(deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	ABT_mutex_lock(g_mdcs->watch_mutex);
+
+	if(g_mdcs->watch_closed) {
+		ABT_mutex_unlock(g_mdcs->watch_mutex);
+		ABT_cond_free(&w.cond);
+		MDCS_PRINT_ERROR("MDCS is being finalized");
+		return MDCS_ERROR;
+	}
+
+	// counted until the ULT stops using the counter and the mutex
+	__atomic_add_fetch(&g_mdcs->watch_parked, 1, __ATOMIC_ACQ_REL);
+
+	w.next = counter->watches;
+	counter->watches = &w;
+
+	while(!w.fired && w.counter != MDCS_COUNTER_NULL) {
+		if(ABT_cond_timedwait(w.cond, g_mdcs->watch_mutex, &deadline) != ABT_SUCCESS)
+			break;
+	}
+
+	if(!w.fired && w.counter != MDCS_COUNTER_NULL) {
+		// timed out, the watch is still in the counter's list
+		mdcs_watch_t* prev = &counter->watches;
+		while(*prev != &w) prev = &(*prev)->next;
+		*prev = w.next;
+	}
+
+	ABT_mutex_unlock(g_mdcs->watch_mutex);
+
+	ABT_cond_free(&w.cond);
+
+	if(w.counter == MDCS_COUNTER_NULL) {
+		ret = MDCS_ERROR;
+	} else {
+		*fired = w.fired;
+		ret = w.fired ? MDCS_SUCCESS : mdcs_counter_value(counter, value);
+	}
+
+	// from here on, g_mdcs and the counter may be freed by mdcs_finalize
+	__atomic_sub_fetch(&g_mdcs->watch_parked, 1, __ATOMIC_ACQ_REL);
+
+	if(w.counter == MDCS_COUNTER_NULL)
+		MDCS_PRINT_ERROR("Watched counter was freed");
+	return ret;
+}
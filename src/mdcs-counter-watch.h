@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_COUNTER_WATCH_H
+#define __MDCS_COUNTER_WATCH_H
+
+#include <abt.h>
+#include <mdcs/mdcs.h>
+
+/* minimum period over which the rate of change of a field is computed */
+#define MDCS_WATCH_RATE_PERIOD 0.1
+
+/*
+ * Watch placed on a counter by a parked watch RPC. Watches are
+ * chained in the counter's list and protected by the global
+ * watch mutex. The RPC's ULT waits on the condition variable
+ * until the predicate fires, the timeout expires, or the counter
+ * is freed (in which case the counter pointer is set to NULL).
+ */
+typedef struct mdcs_watch_s {
+	mdcs_counter_t         counter;    // watched counter
+	mdcs_watch_predicate_t pred;       // predicate to evaluate
+	double                 ref_value;  // reference value for rate predicates
+	double                 ref_time;   // time at which ref_value was taken
+	int                    fired;      // whether the predicate fired
+	void*                  value;      // value of the counter when it fired
+	ABT_cond               cond;       // signaled when the watch completes
+	struct mdcs_watch_s*   next;       // next watch on the same counter
+}* mdcs_watch_t;
+
+/**
+ * Checks that a predicate applies to values of the provided size.
+ */
+int mdcs_watch_predicate_check(const mdcs_watch_predicate_t* pred, size_t value_size);
+
+/**
+ * Evaluates the watches of a counter after items were digested,
+ * completing the ones whose predicate fires.
+ */
+void mdcs_counter_watch_notify(mdcs_counter_t counter);
+
+/**
+ * Completes all the watches of a counter that is being freed.
+ */
+void mdcs_counter_watch_release(mdcs_counter_t counter);
+
+/**
+ * Completes the watches of all the counters, refuses new ones,
+ * and waits until the ULTs parked in mdcs_counter_watch_wait
+ * have stopped using the counters and the watch mutex.
+ */
+void mdcs_counter_watch_finalize();
+
+/**
+ * Evaluates a predicate on a counter and, if it does not fire,
+ * waits until it does or until the timeout (in seconds) expires.
+ * The value of the counter when the predicate fired, or when the
+ * wait ended, is copied into value.
+ */
+int mdcs_counter_watch_wait(mdcs_counter_t counter, const mdcs_watch_predicate_t* pred,
+		double timeout, void* value, int* fired);
+
+#endif
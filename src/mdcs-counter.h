@@ -7,6 +7,7 @@
 #define MDCS_COUNTER_H
 
 #include "uthash.h"
+#include "mdcs-counter-exemplars.h"
 
 struct mdcs_counter_s {
 	char* name;                  // name of the counter
@@ -16,7 +17,58 @@ struct mdcs_counter_s {
 	void* buffer;                // buffer to hold pushed values
 	size_t max_buffer_size;      // maximum number of elements the buffer can hold
 	size_t num_buffered;         // number of elements currently in the buffer
+	size_t num_slots;            // number of slots for vector counters, 0 otherwise
+	size_t slot_stride;          // distance between contiguous slots, 0 if allocated separately
+	mdcs_exemplars_t exemplars;  // largest tagged items, NULL if not enabled
+	struct mdcs_watch_s* watches; // watches parked on the counter
 	UT_hash_handle hh;           // counters are placed in a hash by id
 };
 
+/**
+ * Allocates and resets a counter without registering it. The name may
+ * be NULL for counters that are not reachable by name (e.g. members
+ * of a counter family). A non-zero num_slots creates a vector counter.
+ */
+int mdcs_counter_create(const char* name, uint64_t id,
+		mdcs_counter_type_t type, size_t buffer_size,
+		size_t num_slots, mdcs_counter_t* counter);
+
+/**
+ * Frees a counter created by mdcs_counter_create. The counter must
+ * have been removed from any hash it was placed in.
+ */
+void mdcs_counter_free(mdcs_counter_t counter);
+
+/**
+ * Removes a registered counter from the registry and frees it.
+ * Used to roll back registrations when a component fails to
+ * initialize.
+ */
+void mdcs_counter_unregister(mdcs_counter_t counter);
+
+/**
+ * Allocates the internal data of the slots of a vector counter. If the
+ * type's internal data is a flat block, all the slots are placed in a
+ * single contiguous allocation and *stride is set to the distance
+ * between two slots. Otherwise an array of separately created slots
+ * is returned and *stride is set to 0.
+ */
+void* mdcs_counter_slots_create(mdcs_counter_type_t type,
+		size_t num_slots, size_t* stride);
+
+/**
+ * Frees the slots of a vector counter.
+ */
+void mdcs_counter_slots_destroy(mdcs_counter_t counter);
+
+/**
+ * Returns the internal data of a slot of a vector counter.
+ */
+static inline void* mdcs_counter_slot_data(mdcs_counter_t counter, size_t slot)
+{
+	if(counter->slot_stride != 0)
+		return (char*)(counter->counter_internal_data) + slot*(counter->slot_stride);
+	return ((void**)(counter->counter_internal_data))[slot];
+}
+
 #endif
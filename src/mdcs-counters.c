@@ -4,9 +4,15 @@
  * See COPYRIGHT in top-level directory.
  */
 #include <string.h>
+#include <stddef.h>
+#include <math.h>
 #include <mdcs/mdcs.h>
 #include <mdcs/mdcs-counters.h>
 #include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-time.h"
+#include "mdcs-hash-string.h"
+#include "mdcs-error.h"
 
 ////////////////////////////////////////////////////////////////////////////
 // Simple double value counter, tracks the last pushed value
@@ -52,6 +58,18 @@ static void last_double_push_multi(
 	internal->value = items[count-1];
 }
 
+static int last_double_merge(
+	mdcs_counter_last_double_value_t* v,
+	const mdcs_counter_last_double_value_t* other)
+{
+	*v = *other;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t last_double_fields[] = {
+	{ "value", MDCS_FIELD_DOUBLE, 0, 1 }
+};
+
 struct mdcs_counter_type_s MDCS_COUNTER_LAST_DOUBLE_S = {
 	.counter_item_size  = sizeof(mdcs_counter_last_double_item_t),
    	.counter_value_size = sizeof(mdcs_counter_last_double_value_t), 
@@ -61,6 +79,16 @@ struct mdcs_counter_type_s MDCS_COUNTER_LAST_DOUBLE_S = {
     .get_value_f        = (mdcs_get_value_f)last_double_get_value,
     .push_one_f         = (mdcs_push_one_f)last_double_push_one,
     .push_multi_f       = (mdcs_push_multi_f)last_double_push_multi,
+    .merge_f            = (mdcs_merge_f)last_double_merge,
+    .counter_data_size  = sizeof(mdcs_counter_last_double_internal),
+    .double_items       = 1,
+    .schema             = {
+        .type_name  = "last_double",
+        .item_size  = sizeof(mdcs_counter_last_double_item_t),
+        .value_size = sizeof(mdcs_counter_last_double_value_t),
+        .num_fields = sizeof(last_double_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = last_double_fields
+    },
     .refcount           = -1
 };
 
@@ -108,6 +136,18 @@ static void last_int64_push_multi(
 	internal->value = items[count-1];
 }
 
+static int last_int64_merge(
+	mdcs_counter_last_int64_value_t* v,
+	const mdcs_counter_last_int64_value_t* other)
+{
+	*v = *other;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t last_int64_fields[] = {
+	{ "value", MDCS_FIELD_INT64, 0, 1 }
+};
+
 struct mdcs_counter_type_s MDCS_COUNTER_LAST_INT64_S = {
     .counter_item_size  = sizeof(mdcs_counter_last_int64_item_t), 
   	.counter_value_size = sizeof(mdcs_counter_last_int64_value_t), 
@@ -117,6 +157,15 @@ struct mdcs_counter_type_s MDCS_COUNTER_LAST_INT64_S = {
     .get_value_f        = (mdcs_get_value_f)last_int64_get_value,
     .push_one_f         = (mdcs_push_one_f)last_int64_push_one,
     .push_multi_f       = (mdcs_push_multi_f)last_int64_push_multi,
+    .merge_f            = (mdcs_merge_f)last_int64_merge,
+    .counter_data_size  = sizeof(mdcs_counter_last_int64_internal),
+    .schema             = {
+        .type_name  = "last_int64",
+        .item_size  = sizeof(mdcs_counter_last_int64_item_t),
+        .value_size = sizeof(mdcs_counter_last_int64_value_t),
+        .num_fields = sizeof(last_int64_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = last_int64_fields
+    },
     .refcount           = -1
 };
 
@@ -168,7 +217,7 @@ static void stat_double_push_one(
 		double old_avg = internal->avg;
 		double k = internal->count - 1;
 		double p = k/(k+1);
-		internal->avg = p*old_avg + (x/k);
+		internal->avg = p*old_avg + x/(k+1);
 		double new_avg = internal->avg;
 		double old_var = internal->var;
 		internal->var = p*(old_var + old_avg*old_avg)
@@ -176,6 +225,39 @@ static void stat_double_push_one(
 	}
 }
 
+static int stat_double_merge(
+	mdcs_counter_stat_double_value_t* v,
+	const mdcs_counter_stat_double_value_t* other)
+{
+	if(other->count == 0) return MDCS_SUCCESS;
+	if(v->count == 0) {
+		*v = *other;
+		return MDCS_SUCCESS;
+	}
+	double n1 = v->count;
+	double n2 = other->count;
+	double n  = n1 + n2;
+	double delta = other->avg - v->avg;
+	v->var = (n1*v->var + n2*other->var + delta*delta*n1*n2/n)/n;
+	v->avg = v->avg + delta*n2/n;
+	if(other->min < v->min)
+		v->min = other->min;
+	if(other->max > v->max)
+		v->max = other->max;
+	v->last = other->last;
+	v->count += other->count;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t stat_double_fields[] = {
+	{ "count", MDCS_FIELD_SIZE_T, offsetof(mdcs_counter_stat_double_value_t, count), 1 },
+	{ "min",   MDCS_FIELD_DOUBLE,  offsetof(mdcs_counter_stat_double_value_t, min),   1 },
+	{ "max",   MDCS_FIELD_DOUBLE,  offsetof(mdcs_counter_stat_double_value_t, max),   1 },
+	{ "avg",   MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_stat_double_value_t, avg), 1 },
+	{ "var",   MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_stat_double_value_t, var), 1 },
+	{ "last",  MDCS_FIELD_DOUBLE,  offsetof(mdcs_counter_stat_double_value_t, last),  1 }
+};
+
 struct mdcs_counter_type_s MDCS_COUNTER_STAT_DOUBLE_S = {
     .counter_item_size  = sizeof(mdcs_counter_stat_double_item_t),
    	.counter_value_size = sizeof(mdcs_counter_stat_double_value_t), 
@@ -185,6 +267,16 @@ struct mdcs_counter_type_s MDCS_COUNTER_STAT_DOUBLE_S = {
     .get_value_f        = (mdcs_get_value_f)stat_double_get_value,
     .push_one_f         = (mdcs_push_one_f)stat_double_push_one,
     .push_multi_f       = (mdcs_push_multi_f)NULL,
+    .merge_f            = (mdcs_merge_f)stat_double_merge,
+    .counter_data_size  = sizeof(mdcs_counter_stat_double_internal),
+    .double_items       = 1,
+    .schema             = {
+        .type_name  = "stat_double",
+        .item_size  = sizeof(mdcs_counter_stat_double_item_t),
+        .value_size = sizeof(mdcs_counter_stat_double_value_t),
+        .num_fields = sizeof(stat_double_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = stat_double_fields
+    },
     .refcount           = -1
 };
 
@@ -236,7 +328,7 @@ static void stat_int64_push_one(
 		double old_avg = internal->avg;
 		double k = internal->count - 1;
 		double p = k/(k+1);
-		internal->avg = p*old_avg + (x/k);
+		internal->avg = p*old_avg + x/(k+1);
 		double new_avg = internal->avg;
 		double old_var = internal->var;
 		internal->var = p*(old_var + old_avg*old_avg)
@@ -244,6 +336,39 @@ static void stat_int64_push_one(
 	}
 }
 
+static int stat_int64_merge(
+	mdcs_counter_stat_int64_value_t* v,
+	const mdcs_counter_stat_int64_value_t* other)
+{
+	if(other->count == 0) return MDCS_SUCCESS;
+	if(v->count == 0) {
+		*v = *other;
+		return MDCS_SUCCESS;
+	}
+	double n1 = v->count;
+	double n2 = other->count;
+	double n  = n1 + n2;
+	double delta = other->avg - v->avg;
+	v->var = (n1*v->var + n2*other->var + delta*delta*n1*n2/n)/n;
+	v->avg = v->avg + delta*n2/n;
+	if(other->min < v->min)
+		v->min = other->min;
+	if(other->max > v->max)
+		v->max = other->max;
+	v->last = other->last;
+	v->count += other->count;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t stat_int64_fields[] = {
+	{ "count", MDCS_FIELD_SIZE_T, offsetof(mdcs_counter_stat_int64_value_t, count), 1 },
+	{ "min",   MDCS_FIELD_INT64,  offsetof(mdcs_counter_stat_int64_value_t, min),   1 },
+	{ "max",   MDCS_FIELD_INT64,  offsetof(mdcs_counter_stat_int64_value_t, max),   1 },
+	{ "avg",   MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_stat_int64_value_t, avg), 1 },
+	{ "var",   MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_stat_int64_value_t, var), 1 },
+	{ "last",  MDCS_FIELD_INT64,  offsetof(mdcs_counter_stat_int64_value_t, last),  1 }
+};
+
 struct mdcs_counter_type_s MDCS_COUNTER_STAT_INT64_S = {
     .counter_item_size  = sizeof(mdcs_counter_stat_int64_item_t),
    	.counter_value_size = sizeof(mdcs_counter_stat_int64_value_t),
@@ -253,14 +378,1852 @@ struct mdcs_counter_type_s MDCS_COUNTER_STAT_INT64_S = {
     .get_value_f        = (mdcs_get_value_f)stat_int64_get_value,
     .push_one_f         = (mdcs_push_one_f)stat_int64_push_one,
     .push_multi_f       = (mdcs_push_multi_f)NULL,
+    .merge_f            = (mdcs_merge_f)stat_int64_merge,
+    .counter_data_size  = sizeof(mdcs_counter_stat_int64_internal),
+    .schema             = {
+        .type_name  = "stat_int64",
+        .item_size  = sizeof(mdcs_counter_stat_int64_item_t),
+        .value_size = sizeof(mdcs_counter_stat_int64_value_t),
+        .num_fields = sizeof(stat_int64_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = stat_int64_fields
+    },
     .refcount           = -1
 };
 
 ////////////////////////////////////////////////////////////////////////////
-// Variables exposed to users
+// Rate counter, tracks exponentially-decayed rates of pushed amounts
 ////////////////////////////////////////////////////////////////////////////
-mdcs_counter_type_t MDCS_COUNTER_LAST_DOUBLE = &MDCS_COUNTER_LAST_DOUBLE_S;
-mdcs_counter_type_t MDCS_COUNTER_LAST_INT64  = &MDCS_COUNTER_LAST_INT64_S;
-mdcs_counter_type_t MDCS_COUNTER_STAT_DOUBLE = &MDCS_COUNTER_STAT_DOUBLE_S;
-mdcs_counter_type_t MDCS_COUNTER_STAT_INT64  = &MDCS_COUNTER_STAT_INT64_S;
+typedef struct {
+	size_t  num_windows;
+	double* windows;
+} rate_args_t;
+
+/* the internal data is a flat block: the header is followed by the
+ * time constant of each window, then by the rate of each window */
+typedef struct {
+	uint64_t total;
+	double   last;        // time at which the rates were last decayed
+	size_t   num_windows;
+	double   data[];
+} mdcs_counter_rate_internal;
+
+#define RATE_DATA_SIZE(n) (sizeof(mdcs_counter_rate_internal) + 2*(n)*sizeof(double))
+
+static const double rate_default_windows[] = { 1.0, 5.0, 15.0 };
+
+static const rate_args_t rate_default_args = {
+	.num_windows = 3,
+	.windows = (double*)rate_default_windows
+};
+
+static void rate_reset(
+	mdcs_counter_rate_internal* internal)
+{
+	size_t i;
+	double* rates = internal->data + internal->num_windows;
+	internal->total = 0;
+	internal->last = mdcs_time_now();
+	for(i=0; i < internal->num_windows; i++)
+		rates[i] = 0.0;
+}
+
+static void* rate_create(const rate_args_t* args)
+{
+	mdcs_counter_rate_internal* internal =
+		(mdcs_counter_rate_internal*)malloc(RATE_DATA_SIZE(args->num_windows));
+	if(internal == NULL) return NULL;
+	internal->num_windows = args->num_windows;
+	memcpy(internal->data, args->windows, args->num_windows*sizeof(double));
+	rate_reset(internal);
+	return internal;
+}
+
+static void rate_destroy(void* internal)
+{
+	free(internal);
+}
+
+/**
+ * Decays the rates up to the provided time, then adds an amount
+ * as an impulse: a constant stream of amounts converges to its rate.
+ */
+static void rate_update(
+	mdcs_counter_rate_internal* internal,
+	double now, uint64_t amount)
+{
+	size_t i;
+	size_t n = internal->num_windows;
+	double* windows = internal->data;
+	double* rates = internal->data + n;
+	double dt = now - internal->last;
+	if(dt > 0) {
+		for(i=0; i < n; i++)
+			rates[i] *= exp(-dt/windows[i]);
+		internal->last = now;
+	}
+	for(i=0; i < n; i++)
+		rates[i] += amount/windows[i];
+	internal->total += amount;
+}
+
+static void rate_get_value(
+	mdcs_counter_rate_internal* internal,
+	void* v)
+{
+	// the rates are decayed to the current time without being modified
+	size_t i;
+	size_t n = internal->num_windows;
+	double* windows = internal->data;
+	double* rates = internal->data + n;
+	double dt = mdcs_time_now() - internal->last;
+	if(dt < 0) dt = 0;
+	double r[n];
+	for(i=0; i < n; i++)
+		r[i] = rates[i]*exp(-dt/windows[i]);
+	memcpy(v, &internal->total, sizeof(uint64_t));
+	memcpy((char*)v + sizeof(uint64_t), r, n*sizeof(double));
+}
+
+static void rate_push_one(
+	mdcs_counter_rate_internal* internal,
+	mdcs_counter_rate_item_t* item)
+{
+	rate_update(internal, mdcs_time_now(), *item);
+}
+
+static void rate_push_multi(
+	mdcs_counter_rate_internal* internal,
+	mdcs_counter_rate_item_t* items, size_t count)
+{
+	// a batch is accounted as a single impulse, with a single clock read
+	size_t i;
+	uint64_t sum = 0;
+	for(i=0; i < count; i++)
+		sum += items[i];
+	rate_update(internal, mdcs_time_now(), sum);
+}
+
+static int rate_merge(
+	mdcs_counter_rate_value_t* v,
+	const mdcs_counter_rate_value_t* other)
+{
+	v->total += other->total;
+	v->rate[0] += other->rate[0];
+	v->rate[1] += other->rate[1];
+	v->rate[2] += other->rate[2];
+	return MDCS_SUCCESS;
+}
+
+/* merge function of rate types with custom windows, which
+ * cannot know the number of windows from the value alone */
+static int rate_merge_args(
+	const rate_args_t* args, void* v, const void* other)
+{
+	size_t n = args->num_windows;
+	size_t i;
+	uint64_t t1, t2;
+	double r1, r2;
+	memcpy(&t1, v, sizeof(uint64_t));
+	memcpy(&t2, other, sizeof(uint64_t));
+	t1 += t2;
+	memcpy(v, &t1, sizeof(uint64_t));
+	for(i=0; i < n; i++) {
+		size_t off = sizeof(uint64_t) + i*sizeof(double);
+		memcpy(&r1, (char*)v + off, sizeof(double));
+		memcpy(&r2, (const char*)other + off, sizeof(double));
+		r1 += r2;
+		memcpy((char*)v + off, &r1, sizeof(double));
+	}
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t rate_fields[] = {
+	{ "total", MDCS_FIELD_UINT64, offsetof(mdcs_counter_rate_value_t, total), 1 },
+	{ "rate",  MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_rate_value_t, rate),  3 }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_RATE_S = {
+    .counter_item_size  = sizeof(mdcs_counter_rate_item_t),
+    .counter_value_size = sizeof(mdcs_counter_rate_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)rate_destroy,
+    .reset_f            = (mdcs_reset_f)rate_reset,
+    .get_value_f        = (mdcs_get_value_f)rate_get_value,
+    .push_one_f         = (mdcs_push_one_f)rate_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)rate_push_multi,
+    .merge_f            = (mdcs_merge_f)rate_merge,
+    .counter_data_size  = RATE_DATA_SIZE(3),
+    .create_args_f      = (mdcs_create_args_f)rate_create,
+    .args               = (void*)&rate_default_args,
+    .schema             = {
+        .type_name  = "rate",
+        .item_size  = sizeof(mdcs_counter_rate_item_t),
+        .value_size = sizeof(mdcs_counter_rate_value_t),
+        .num_fields = sizeof(rate_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = rate_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_rate_create(const double* windows, size_t num_windows,
+		mdcs_counter_type_t* type)
+{
+	size_t i;
+
+	if(num_windows == 0) {
+		MDCS_PRINT_ERROR("A rate counter needs at least one window");
+		return MDCS_ERROR;
+	}
+	for(i=0; i < num_windows; i++) {
+		if(!(windows[i] > 0)) {
+			MDCS_PRINT_ERROR("Rate counter windows must be positive");
+			return MDCS_ERROR;
+		}
+	}
+
+	// the windows are allocated right after the arguments
+	rate_args_t* args = (rate_args_t*)malloc(sizeof(rate_args_t) + num_windows*sizeof(double));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for rate counter type");
+		return MDCS_ERROR;
+	}
+	args->num_windows = num_windows;
+	args->windows = (double*)(args + 1);
+	memcpy(args->windows, windows, num_windows*sizeof(double));
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(sizeof(mdcs_counter_rate_item_t),
+			MDCS_COUNTER_RATE_VALUE_SIZE(num_windows),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)rate_destroy,
+			(mdcs_reset_f)rate_reset,
+			(mdcs_push_one_f)rate_push_one,
+			(mdcs_push_multi_f)rate_push_multi,
+			(mdcs_get_value_f)rate_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)rate_create;
+	newtype->merge_args_f      = (mdcs_merge_args_f)rate_merge_args;
+	newtype->args              = args;
+	newtype->counter_data_size = RATE_DATA_SIZE(num_windows);
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Window counter, tracks statistics of double values over a sliding window
+////////////////////////////////////////////////////////////////////////////
+typedef struct {
+	double window;
+	size_t num_buckets;
+} window_args_t;
+
+/* statistics of the values pushed during one sub-interval of the
+ * window; epoch is the index of the sub-interval since the clock's
+ * origin, buckets whose epoch is out of the window are ignored */
+typedef struct {
+	int64_t epoch;
+	size_t  count;
+	double  mean;
+	double  m2;
+	double  min;
+	double  max;
+} window_bucket_t;
+
+typedef struct {
+	double width;          // duration of a bucket, in seconds
+	size_t num_buckets;    // number of buckets in the ring
+	double last;           // last pushed value
+	window_bucket_t buckets[];
+} mdcs_counter_window_double_internal;
+
+#define WINDOW_DATA_SIZE(n) (sizeof(mdcs_counter_window_double_internal) + (n)*sizeof(window_bucket_t))
+
+static const window_args_t window_default_args = {
+	.window = 60.0,
+	.num_buckets = 12
+};
+
+static void window_double_reset(
+	mdcs_counter_window_double_internal* internal)
+{
+	size_t i;
+	internal->last = 0.0;
+	for(i=0; i < internal->num_buckets; i++) {
+		internal->buckets[i].epoch = INT64_MIN;
+		internal->buckets[i].count = 0;
+	}
+}
+
+static void* window_double_create(const window_args_t* args)
+{
+	mdcs_counter_window_double_internal* internal =
+		(mdcs_counter_window_double_internal*)malloc(WINDOW_DATA_SIZE(args->num_buckets));
+	if(internal == NULL) return NULL;
+	internal->width = args->window/args->num_buckets;
+	internal->num_buckets = args->num_buckets;
+	window_double_reset(internal);
+	return internal;
+}
+
+static void window_double_destroy(void* internal)
+{
+	free(internal);
+}
+
+/**
+ * Returns the bucket for the current sub-interval, recycling
+ * the slot of the ring if it holds an expired sub-interval.
+ */
+static window_bucket_t* window_double_current(
+	mdcs_counter_window_double_internal* internal, double now)
+{
+	int64_t epoch = (int64_t)(now/internal->width);
+	window_bucket_t* b = &internal->buckets[epoch % internal->num_buckets];
+	if(b->epoch != epoch) {
+		b->epoch = epoch;
+		b->count = 0;
+	}
+	return b;
+}
+
+static void window_bucket_add(window_bucket_t* b, double x)
+{
+	b->count += 1;
+	if(b->count == 1) {
+		b->mean = x;
+		b->m2 = 0.0;
+		b->min = x;
+		b->max = x;
+		return;
+	}
+	if(x < b->min) b->min = x;
+	if(x > b->max) b->max = x;
+	double delta = x - b->mean;
+	b->mean += delta/b->count;
+	b->m2 += delta*(x - b->mean);
+}
+
+static void window_double_get_value(
+	mdcs_counter_window_double_internal* internal,
+	mdcs_counter_window_double_value_t* v)
+{
+	size_t i;
+	int64_t epoch = (int64_t)(mdcs_time_now()/internal->width);
+	int64_t oldest = epoch - (int64_t)internal->num_buckets;
+	double m2 = 0.0;
+
+	memset(v, 0, sizeof(*v));
+	v->last = internal->last;
+
+	// merge the buckets of the window using the parallel algorithm
+	for(i=0; i < internal->num_buckets; i++) {
+		window_bucket_t* b = &internal->buckets[i];
+		if(b->count == 0 || b->epoch <= oldest || b->epoch > epoch)
+			continue;
+		if(v->count == 0) {
+			v->count = b->count;
+			v->avg = b->mean;
+			v->min = b->min;
+			v->max = b->max;
+			m2 = b->m2;
+			continue;
+		}
+		double n1 = v->count;
+		double n2 = b->count;
+		double n  = n1 + n2;
+		double delta = b->mean - v->avg;
+		m2 += b->m2 + delta*delta*n1*n2/n;
+		v->avg += delta*n2/n;
+		if(b->min < v->min) v->min = b->min;
+		if(b->max > v->max) v->max = b->max;
+		v->count += b->count;
+	}
+	if(v->count != 0)
+		v->var = m2/v->count;
+}
+
+static void window_double_push_one(
+	mdcs_counter_window_double_internal* internal,
+	mdcs_counter_window_double_item_t* item)
+{
+	window_bucket_t* b = window_double_current(internal, mdcs_time_now());
+	window_bucket_add(b, *item);
+	internal->last = *item;
+}
+
+static void window_double_push_multi(
+	mdcs_counter_window_double_internal* internal,
+	mdcs_counter_window_double_item_t* items, size_t count)
+{
+	// all the items of a batch go to the same bucket
+	size_t i;
+	window_bucket_t* b = window_double_current(internal, mdcs_time_now());
+	for(i=0; i < count; i++)
+		window_bucket_add(b, items[i]);
+	internal->last = items[count-1];
+}
+
+struct mdcs_counter_type_s MDCS_COUNTER_WINDOW_DOUBLE_S = {
+    .counter_item_size  = sizeof(mdcs_counter_window_double_item_t),
+    .counter_value_size = sizeof(mdcs_counter_window_double_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)window_double_destroy,
+    .reset_f            = (mdcs_reset_f)window_double_reset,
+    .get_value_f        = (mdcs_get_value_f)window_double_get_value,
+    .push_one_f         = (mdcs_push_one_f)window_double_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)window_double_push_multi,
+    .merge_f            = (mdcs_merge_f)stat_double_merge,
+    .counter_data_size  = WINDOW_DATA_SIZE(12),
+    .create_args_f      = (mdcs_create_args_f)window_double_create,
+    .args               = (void*)&window_default_args,
+    .double_items       = 1,
+    .schema             = {
+        .type_name  = "window_double",
+        .item_size  = sizeof(mdcs_counter_window_double_item_t),
+        .value_size = sizeof(mdcs_counter_window_double_value_t),
+        .num_fields = sizeof(stat_double_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = stat_double_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_window_create(double window, size_t num_buckets,
+		mdcs_counter_type_t* type)
+{
+	if(!(window > 0) || num_buckets == 0) {
+		MDCS_PRINT_ERROR("Invalid window counter parameters");
+		return MDCS_ERROR;
+	}
+
+	window_args_t* args = (window_args_t*)malloc(sizeof(window_args_t));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for window counter type");
+		return MDCS_ERROR;
+	}
+	args->window = window;
+	args->num_buckets = num_buckets;
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(sizeof(mdcs_counter_window_double_item_t),
+			sizeof(mdcs_counter_window_double_value_t),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)window_double_destroy,
+			(mdcs_reset_f)window_double_reset,
+			(mdcs_push_one_f)window_double_push_one,
+			(mdcs_push_multi_f)window_double_push_multi,
+			(mdcs_get_value_f)window_double_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)window_double_create;
+	newtype->merge_f           = (mdcs_merge_f)stat_double_merge;
+	newtype->args              = args;
+	newtype->counter_data_size = WINDOW_DATA_SIZE(num_buckets);
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// HyperLogLog counter, estimates the number of distinct pushed keys
+////////////////////////////////////////////////////////////////////////////
+typedef struct {
+	uint32_t precision;
+} hll_args_t;
+
+/* the internal data has the same layout as the value: the estimate
+ * and precision are followed by 2^precision registers, each holding
+ * the maximum rank observed among the keys that map to it */
+typedef struct {
+	double   estimate;
+	uint32_t precision;
+	uint32_t reserved;
+	uint8_t  registers[];
+} mdcs_counter_hll_internal;
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+
+/* keys are hashed by blocks in push_multi, so that the
+ * hashing loop has no dependency and can be vectorized */
+#define HLL_HASH_BLOCK 64
+
+static const hll_args_t hll_default_args = {
+	.precision = MDCS_COUNTER_HLL_PRECISION
+};
+
+static void* hll_create(const hll_args_t* args)
+{
+	mdcs_counter_hll_internal* internal =
+		(mdcs_counter_hll_internal*)malloc(MDCS_COUNTER_HLL_VALUE_SIZE(args->precision));
+	if(internal == NULL) return NULL;
+	internal->precision = args->precision;
+	internal->reserved = 0;
+	internal->estimate = 0.0;
+	memset(internal->registers, 0, (size_t)1 << args->precision);
+	return internal;
+}
+
+static void hll_destroy(void* internal)
+{
+	free(internal);
+}
+
+static void hll_reset(
+	mdcs_counter_hll_internal* internal)
+{
+	internal->estimate = 0.0;
+	memset(internal->registers, 0, (size_t)1 << internal->precision);
+}
+
+static inline void hll_add_hash(
+	mdcs_counter_hll_internal* internal, uint64_t h)
+{
+	uint32_t p = internal->precision;
+	size_t idx = h >> (64 - p);
+	uint64_t w = h << p;
+	// rank of the first set bit in the remaining 64-p bits
+	uint8_t rank = w ? (uint8_t)(__builtin_clzll(w) + 1) : (uint8_t)(64 - p + 1);
+	if(rank > internal->registers[idx])
+		internal->registers[idx] = rank;
+}
+
+/**
+ * Computes the estimated cardinality from the registers, using linear
+ * counting when the estimate is small and some registers are empty.
+ */
+static double hll_estimate(const uint8_t* registers, uint32_t precision)
+{
+	size_t i;
+	size_t m = (size_t)1 << precision;
+	size_t zeros = 0;
+	double sum = 0.0;
+	for(i=0; i < m; i++) {
+		sum += ldexp(1.0, -registers[i]);
+		zeros += (registers[i] == 0);
+	}
+	double alpha;
+	switch(m) {
+	case 16: alpha = 0.673; break;
+	case 32: alpha = 0.697; break;
+	case 64: alpha = 0.709; break;
+	default: alpha = 0.7213/(1.0 + 1.079/m);
+	}
+	double e = alpha*m*m/sum;
+	if(e <= 2.5*m && zeros != 0)
+		e = m*log((double)m/zeros);
+	return e;
+}
+
+static void hll_get_value(
+	mdcs_counter_hll_internal* internal,
+	void* v)
+{
+	internal->estimate = hll_estimate(internal->registers, internal->precision);
+	memcpy(v, internal, MDCS_COUNTER_HLL_VALUE_SIZE(internal->precision));
+}
+
+static void hll_push_one(
+	mdcs_counter_hll_internal* internal,
+	mdcs_counter_hll_item_t* item)
+{
+	hll_add_hash(internal, mdcs_hash_mix64(*item));
+}
+
+static void hll_push_multi(
+	mdcs_counter_hll_internal* internal,
+	mdcs_counter_hll_item_t* items, size_t count)
+{
+	uint64_t hashes[HLL_HASH_BLOCK];
+	size_t i, j;
+	for(i=0; i < count; i += HLL_HASH_BLOCK) {
+		size_t n = count - i < HLL_HASH_BLOCK ? count - i : HLL_HASH_BLOCK;
+		for(j=0; j < n; j++)
+			hashes[j] = mdcs_hash_mix64(items[i+j]);
+		for(j=0; j < n; j++)
+			hll_add_hash(internal, hashes[j]);
+	}
+}
+
+static int hll_merge(
+	void* v, const void* other)
+{
+	// the precision is read from the values, so the same function
+	// works for all precisions, values of different precisions
+	// cannot be merged
+	mdcs_counter_hll_internal* a = (mdcs_counter_hll_internal*)v;
+	const mdcs_counter_hll_internal* b = (const mdcs_counter_hll_internal*)other;
+	if(a->precision != b->precision) {
+		MDCS_PRINT_ERROR("Cannot merge HyperLogLog values of different precisions");
+		return MDCS_ERROR;
+	}
+	size_t i;
+	size_t m = (size_t)1 << a->precision;
+	for(i=0; i < m; i++)
+		if(b->registers[i] > a->registers[i])
+			a->registers[i] = b->registers[i];
+	a->estimate = hll_estimate(a->registers, a->precision);
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t hll_fields[] = {
+	{ "estimate",  MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_hll_value_t, estimate),  1 },
+	{ "precision", MDCS_FIELD_UINT32, offsetof(mdcs_counter_hll_value_t, precision), 1 },
+	{ "registers", MDCS_FIELD_UINT8,  offsetof(mdcs_counter_hll_value_t, registers),
+		(size_t)1 << MDCS_COUNTER_HLL_PRECISION }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_HLL_S = {
+    .counter_item_size  = sizeof(mdcs_counter_hll_item_t),
+    .counter_value_size = sizeof(mdcs_counter_hll_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)hll_destroy,
+    .reset_f            = (mdcs_reset_f)hll_reset,
+    .get_value_f        = (mdcs_get_value_f)hll_get_value,
+    .push_one_f         = (mdcs_push_one_f)hll_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)hll_push_multi,
+    .merge_f            = (mdcs_merge_f)hll_merge,
+    .counter_data_size  = sizeof(mdcs_counter_hll_value_t),
+    .create_args_f      = (mdcs_create_args_f)hll_create,
+    .args               = (void*)&hll_default_args,
+    .schema             = {
+        .type_name  = "hll",
+        .item_size  = sizeof(mdcs_counter_hll_item_t),
+        .value_size = sizeof(mdcs_counter_hll_value_t),
+        .num_fields = sizeof(hll_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = hll_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_hll_create(unsigned precision, mdcs_counter_type_t* type)
+{
+	if(precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION) {
+		MDCS_PRINT_ERROR("HyperLogLog precision must be between 4 and 18");
+		return MDCS_ERROR;
+	}
+
+	hll_args_t* args = (hll_args_t*)malloc(sizeof(hll_args_t));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for HyperLogLog counter type");
+		return MDCS_ERROR;
+	}
+	args->precision = precision;
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(sizeof(mdcs_counter_hll_item_t),
+			MDCS_COUNTER_HLL_VALUE_SIZE(precision),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)hll_destroy,
+			(mdcs_reset_f)hll_reset,
+			(mdcs_push_one_f)hll_push_one,
+			(mdcs_push_multi_f)hll_push_multi,
+			(mdcs_get_value_f)hll_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)hll_create;
+	newtype->merge_f           = (mdcs_merge_f)hll_merge;
+	newtype->args              = args;
+	newtype->counter_data_size = MDCS_COUNTER_HLL_VALUE_SIZE(precision);
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Top-k counter, tracks heavy hitters with a count-min sketch
+////////////////////////////////////////////////////////////////////////////
+typedef struct {
+	uint32_t depth;
+	uint32_t width;
+	uint32_t k;
+} topk_args_t;
+
+/* the internal data starts with the same layout as the value (header,
+ * entries, sketch), the entries being kept as a min-heap on their count.
+ * It is followed by an open-addressing index from keys to heap positions,
+ * so that finding whether a key is in the heap does not depend on k */
+typedef struct {
+	uint32_t depth;
+	uint32_t width;
+	uint32_t k;
+	uint32_t num_entries;
+} mdcs_counter_topk_internal;
+
+#define TOPK_INDEX_EMPTY (-1)
+
+static size_t topk_index_size(uint32_t k)
+{
+	size_t s = 2;
+	while(s < 2*(size_t)k) s *= 2;
+	return s;
+}
+
+#define TOPK_DATA_SIZE(d,w,k) \
+	(MDCS_COUNTER_TOPK_VALUE_SIZE(d,w,k) + topk_index_size(k)*sizeof(int32_t))
+
+static inline mdcs_counter_topk_entry_t* topk_entries(const void* base)
+{
+	return (mdcs_counter_topk_entry_t*)((char*)base + sizeof(mdcs_counter_topk_internal));
+}
+
+static inline uint64_t* topk_sketch(const void* base)
+{
+	const mdcs_counter_topk_internal* h = (const mdcs_counter_topk_internal*)base;
+	return (uint64_t*)(topk_entries(base) + h->k);
+}
+
+static inline int32_t* topk_index(const mdcs_counter_topk_internal* internal)
+{
+	return (int32_t*)(topk_sketch(internal) + (size_t)internal->depth*internal->width);
+}
+
+static const topk_args_t topk_default_args = {
+	.depth = MDCS_COUNTER_TOPK_DEPTH,
+	.width = MDCS_COUNTER_TOPK_WIDTH,
+	.k     = MDCS_COUNTER_TOPK_K
+};
+
+static void topk_reset(
+	mdcs_counter_topk_internal* internal)
+{
+	size_t i;
+	size_t s = topk_index_size(internal->k);
+	int32_t* index = topk_index(internal);
+	internal->num_entries = 0;
+	memset(topk_sketch(internal), 0,
+		(size_t)internal->depth*internal->width*sizeof(uint64_t));
+	for(i=0; i < s; i++)
+		index[i] = TOPK_INDEX_EMPTY;
+}
+
+static void* topk_create(const topk_args_t* args)
+{
+	mdcs_counter_topk_internal* internal =
+		(mdcs_counter_topk_internal*)malloc(TOPK_DATA_SIZE(args->depth, args->width, args->k));
+	if(internal == NULL) return NULL;
+	internal->depth = args->depth;
+	internal->width = args->width;
+	internal->k = args->k;
+	topk_reset(internal);
+	return internal;
+}
+
+static void topk_destroy(void* internal)
+{
+	free(internal);
+}
+
+/**
+ * Returns the column of a key's hash in a row of the sketch. Each row
+ * rehashes the key's hash with a different seed, so that two keys that
+ * collide in a row are unlikely to collide in the others.
+ */
+static inline size_t topk_column(uint64_t h, uint32_t row, uint32_t width)
+{
+	return mdcs_hash_mix64(h ^ ((row + 1)*0x9e3779b97f4a7c15ULL)) % width;
+}
+
+static uint64_t topk_estimate(const void* base, uint64_t h)
+{
+	const mdcs_counter_topk_internal* hd = (const mdcs_counter_topk_internal*)base;
+	const uint64_t* sketch = topk_sketch(base);
+	uint64_t est = UINT64_MAX;
+	uint32_t r;
+	for(r=0; r < hd->depth; r++) {
+		uint64_t c = sketch[(size_t)r*hd->width + topk_column(h, r, hd->width)];
+		if(c < est) est = c;
+	}
+	return est;
+}
+
+/**
+ * Returns the slot of the index holding the key, or the
+ * empty slot where it would be inserted.
+ */
+static size_t topk_index_slot(mdcs_counter_topk_internal* internal, uint64_t key, uint64_t h)
+{
+	int32_t* index = topk_index(internal);
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	size_t mask = topk_index_size(internal->k) - 1;
+	size_t s = h & mask;
+	while(index[s] != TOPK_INDEX_EMPTY && entries[index[s]].key != key)
+		s = (s + 1) & mask;
+	return s;
+}
+
+/**
+ * Removes a slot from the index, shifting back the following
+ * entries of the probe sequence so that no tombstone is needed.
+ */
+static void topk_index_remove(mdcs_counter_topk_internal* internal, size_t i)
+{
+	int32_t* index = topk_index(internal);
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	size_t mask = topk_index_size(internal->k) - 1;
+	size_t j = i;
+	while(1) {
+		j = (j + 1) & mask;
+		if(index[j] == TOPK_INDEX_EMPTY) break;
+		size_t home = mdcs_hash_mix64(entries[index[j]].key) & mask;
+		// the entry at j can move to i if its home is not in (i, j]
+		if(((j - home) & mask) >= ((j - i) & mask)) {
+			index[i] = index[j];
+			i = j;
+		}
+	}
+	index[i] = TOPK_INDEX_EMPTY;
+}
+
+static void topk_heap_swap(mdcs_counter_topk_internal* internal, size_t a, size_t b)
+{
+	int32_t* index = topk_index(internal);
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	size_t sa = topk_index_slot(internal, entries[a].key, mdcs_hash_mix64(entries[a].key));
+	size_t sb = topk_index_slot(internal, entries[b].key, mdcs_hash_mix64(entries[b].key));
+	mdcs_counter_topk_entry_t tmp = entries[a];
+	entries[a] = entries[b];
+	entries[b] = tmp;
+	index[sa] = (int32_t)b;
+	index[sb] = (int32_t)a;
+}
+
+static void topk_sift_down(mdcs_counter_topk_internal* internal, size_t i)
+{
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	size_t n = internal->num_entries;
+	while(1) {
+		size_t l = 2*i + 1, r = l + 1, m = i;
+		if(l < n && entries[l].count < entries[m].count) m = l;
+		if(r < n && entries[r].count < entries[m].count) m = r;
+		if(m == i) return;
+		topk_heap_swap(internal, i, m);
+		i = m;
+	}
+}
+
+static void topk_sift_up(mdcs_counter_topk_internal* internal, size_t i)
+{
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	while(i > 0) {
+		size_t p = (i - 1)/2;
+		if(entries[p].count <= entries[i].count) return;
+		topk_heap_swap(internal, i, p);
+		i = p;
+	}
+}
+
+static void topk_push_one(
+	mdcs_counter_topk_internal* internal,
+	mdcs_counter_topk_item_t* item)
+{
+	uint64_t h = mdcs_hash_mix64(item->key);
+	uint64_t* sketch = topk_sketch(internal);
+	int32_t* index = topk_index(internal);
+	mdcs_counter_topk_entry_t* entries = topk_entries(internal);
+	uint64_t est = UINT64_MAX;
+	uint32_t r;
+
+	for(r=0; r < internal->depth; r++) {
+		uint64_t* c = &sketch[(size_t)r*internal->width + topk_column(h, r, internal->width)];
+		*c += item->weight;
+		if(*c < est) est = *c;
+	}
+
+	size_t s = topk_index_slot(internal, item->key, h);
+	if(index[s] != TOPK_INDEX_EMPTY) {
+		// already a heavy hitter, its count can only increase
+		size_t pos = index[s];
+		entries[pos].count = est;
+		topk_sift_down(internal, pos);
+	} else if(internal->num_entries < internal->k) {
+		size_t pos = internal->num_entries;
+		entries[pos].key = item->key;
+		entries[pos].count = est;
+		index[s] = (int32_t)pos;
+		internal->num_entries += 1;
+		topk_sift_up(internal, pos);
+	} else if(est > entries[0].count) {
+		// replace the smallest heavy hitter
+		topk_index_remove(internal,
+			topk_index_slot(internal, entries[0].key, mdcs_hash_mix64(entries[0].key)));
+		entries[0].key = item->key;
+		entries[0].count = est;
+		index[topk_index_slot(internal, item->key, h)] = 0;
+		topk_sift_down(internal, 0);
+	}
+}
+
+static void topk_push_multi(
+	mdcs_counter_topk_internal* internal,
+	mdcs_counter_topk_item_t* items, size_t count)
+{
+	size_t i;
+	for(i=0; i < count; i++)
+		topk_push_one(internal, items + i);
+}
+
+static int topk_entry_cmp(const void* a, const void* b)
+{
+	const mdcs_counter_topk_entry_t* x = (const mdcs_counter_topk_entry_t*)a;
+	const mdcs_counter_topk_entry_t* y = (const mdcs_counter_topk_entry_t*)b;
+	if(x->count != y->count) return x->count < y->count ? 1 : -1;
+	return x->key < y->key ? -1 : (x->key > y->key);
+}
+
+static void topk_get_value(
+	mdcs_counter_topk_internal* internal,
+	void* v)
+{
+	// the value is the internal data without the index, with the
+	// entries re-estimated from the sketch and sorted by count
+	size_t i;
+	mdcs_counter_topk_entry_t* entries = topk_entries(v);
+	memcpy(v, internal, MDCS_COUNTER_TOPK_VALUE_SIZE(internal->depth,
+			internal->width, internal->k));
+	for(i=0; i < internal->num_entries; i++)
+		entries[i].count = topk_estimate(internal, mdcs_hash_mix64(entries[i].key));
+	memset(entries + internal->num_entries, 0,
+		(internal->k - internal->num_entries)*sizeof(mdcs_counter_topk_entry_t));
+	qsort(entries, internal->num_entries, sizeof(mdcs_counter_topk_entry_t), topk_entry_cmp);
+}
+
+static int topk_merge(
+	void* v, const void* other)
+{
+	// the dimensions are read from the values, values of different
+	// dimensions cannot be merged
+	mdcs_counter_topk_internal* a = (mdcs_counter_topk_internal*)v;
+	const mdcs_counter_topk_internal* b = (const mdcs_counter_topk_internal*)other;
+	if(a->depth != b->depth || a->width != b->width || a->k != b->k) {
+		MDCS_PRINT_ERROR("Cannot merge top-k values of different dimensions");
+		return MDCS_ERROR;
+	}
+
+	// candidates are the heavy hitters of both values, allocated
+	// before anything is modified so that a failure leaves v intact
+	// (one more entry so that an empty merge does not allocate 0 bytes)
+	mdcs_counter_topk_entry_t* candidates =
+		(mdcs_counter_topk_entry_t*)malloc((a->num_entries + b->num_entries + 1)*sizeof(*candidates));
+	if(candidates == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory to merge top-k values");
+		return MDCS_ERROR;
+	}
+
+	size_t i, j;
+	uint64_t* sa = topk_sketch(a);
+	const uint64_t* sb = topk_sketch(b);
+	size_t n = (size_t)a->depth*a->width;
+	for(i=0; i < n; i++)
+		sa[i] += sb[i];
+
+	// candidates are re-estimated from the merged sketch
+	mdcs_counter_topk_entry_t* ea = topk_entries(a);
+	const mdcs_counter_topk_entry_t* eb = topk_entries(b);
+	size_t num = a->num_entries;
+	memcpy(candidates, ea, num*sizeof(*candidates));
+	for(i=0; i < b->num_entries; i++) {
+		for(j=0; j < a->num_entries; j++)
+			if(ea[j].key == eb[i].key) break;
+		if(j == a->num_entries)
+			candidates[num++] = eb[i];
+	}
+	for(i=0; i < num; i++)
+		candidates[i].count = topk_estimate(a, mdcs_hash_mix64(candidates[i].key));
+	qsort(candidates, num, sizeof(*candidates), topk_entry_cmp);
+	if(num > a->k) num = a->k;
+	memcpy(ea, candidates, num*sizeof(*candidates));
+	memset(ea + num, 0, (a->k - num)*sizeof(*candidates));
+	a->num_entries = num;
+	free(candidates);
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t topk_fields[] = {
+	{ "depth",       MDCS_FIELD_UINT32, offsetof(mdcs_counter_topk_value_t, depth),       1 },
+	{ "width",       MDCS_FIELD_UINT32, offsetof(mdcs_counter_topk_value_t, width),       1 },
+	{ "k",           MDCS_FIELD_UINT32, offsetof(mdcs_counter_topk_value_t, k),           1 },
+	{ "num_entries", MDCS_FIELD_UINT32, offsetof(mdcs_counter_topk_value_t, num_entries), 1 },
+	{ "entries",     MDCS_FIELD_UINT64, offsetof(mdcs_counter_topk_value_t, entries),
+		2*MDCS_COUNTER_TOPK_K },
+	{ "sketch",      MDCS_FIELD_UINT64, offsetof(mdcs_counter_topk_value_t, sketch),
+		MDCS_COUNTER_TOPK_DEPTH*MDCS_COUNTER_TOPK_WIDTH }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_TOPK_S = {
+    .counter_item_size  = sizeof(mdcs_counter_topk_item_t),
+    .counter_value_size = sizeof(mdcs_counter_topk_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)topk_destroy,
+    .reset_f            = (mdcs_reset_f)topk_reset,
+    .get_value_f        = (mdcs_get_value_f)topk_get_value,
+    .push_one_f         = (mdcs_push_one_f)topk_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)topk_push_multi,
+    .merge_f            = (mdcs_merge_f)topk_merge,
+    .counter_data_size  = MDCS_COUNTER_TOPK_VALUE_SIZE(MDCS_COUNTER_TOPK_DEPTH,
+                              MDCS_COUNTER_TOPK_WIDTH, MDCS_COUNTER_TOPK_K)
+                          + 2*MDCS_COUNTER_TOPK_K*sizeof(int32_t), // k is a power of 2
+    .create_args_f      = (mdcs_create_args_f)topk_create,
+    .args               = (void*)&topk_default_args,
+    .schema             = {
+        .type_name  = "topk",
+        .item_size  = sizeof(mdcs_counter_topk_item_t),
+        .value_size = sizeof(mdcs_counter_topk_value_t),
+        .num_fields = sizeof(topk_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = topk_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_topk_create(unsigned depth, unsigned width, unsigned k,
+		mdcs_counter_type_t* type)
+{
+	if(depth == 0 || width == 0 || k == 0 || k > INT32_MAX/2) {
+		MDCS_PRINT_ERROR("Invalid top-k counter parameters");
+		return MDCS_ERROR;
+	}
+
+	topk_args_t* args = (topk_args_t*)malloc(sizeof(topk_args_t));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for top-k counter type");
+		return MDCS_ERROR;
+	}
+	args->depth = depth;
+	args->width = width;
+	args->k = k;
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(sizeof(mdcs_counter_topk_item_t),
+			MDCS_COUNTER_TOPK_VALUE_SIZE(depth, width, k),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)topk_destroy,
+			(mdcs_reset_f)topk_reset,
+			(mdcs_push_one_f)topk_push_one,
+			(mdcs_push_multi_f)topk_push_multi,
+			(mdcs_get_value_f)topk_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)topk_create;
+	newtype->merge_f           = (mdcs_merge_f)topk_merge;
+	newtype->args              = args;
+	newtype->counter_data_size = TOPK_DATA_SIZE(depth, width, k);
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Reservoir counter, keeps a uniform sample of the pushed items
+////////////////////////////////////////////////////////////////////////////
+typedef struct {
+	uint32_t item_size;
+	uint32_t capacity;
+} reservoir_args_t;
+
+/* the samples are stored after the header; skip is the number of
+ * items to ignore before the next replacement (Algorithm L), and
+ * w is the running parameter of the skip distribution */
+typedef struct {
+	uint64_t seen;
+	uint32_t capacity;
+	uint32_t num_samples;
+	uint32_t item_size;
+	uint32_t reserved;
+	uint64_t skip;
+	uint64_t rng;
+	double   w;
+	char     samples[];
+} mdcs_counter_reservoir_internal;
+
+#define RESERVOIR_DATA_SIZE(s,k) (sizeof(mdcs_counter_reservoir_internal) + (size_t)(s)*(k))
+#define RESERVOIR_HEADER_SIZE    (sizeof(uint64_t) + 4*sizeof(uint32_t))
+
+static const reservoir_args_t reservoir_default_args = {
+	.item_size = sizeof(double),
+	.capacity  = MDCS_COUNTER_RESERVOIR_SIZE
+};
+
+/**
+ * Returns a uniform random number in (0,1] using xorshift64*.
+ * The generator is seeded on first use from the address of the
+ * counter, so that copies of the same data get different streams.
+ */
+static double reservoir_random(mdcs_counter_reservoir_internal* internal)
+{
+	if(internal->rng == 0)
+		internal->rng = mdcs_hash_mix64((uintptr_t)internal
+			^ (uint64_t)(mdcs_time_now()*1e9)) | 1;
+	uint64_t x = internal->rng;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	internal->rng = x;
+	x *= 0x2545f4914f6cdd1dULL;
+	return ((x >> 11) + 1)*(1.0/9007199254740992.0);
+}
+
+/**
+ * Draws the number of items to skip before the next replacement.
+ */
+static void reservoir_next_skip(mdcs_counter_reservoir_internal* internal)
+{
+	internal->w *= exp(log(reservoir_random(internal))/internal->capacity);
+	double s = floor(log(reservoir_random(internal))/log1p(-internal->w));
+	internal->skip = s < (double)UINT64_MAX ? (uint64_t)s : UINT64_MAX;
+}
+
+static void reservoir_reset(
+	mdcs_counter_reservoir_internal* internal)
+{
+	internal->seen = 0;
+	internal->num_samples = 0;
+	internal->skip = 0;
+	internal->w = 1.0;
+}
+
+static void* reservoir_create(const reservoir_args_t* args)
+{
+	mdcs_counter_reservoir_internal* internal = (mdcs_counter_reservoir_internal*)
+		malloc(RESERVOIR_DATA_SIZE(args->item_size, args->capacity));
+	if(internal == NULL) return NULL;
+	internal->capacity = args->capacity;
+	internal->item_size = args->item_size;
+	internal->reserved = 0;
+	internal->rng = 0;
+	reservoir_reset(internal);
+	return internal;
+}
+
+static void reservoir_destroy(void* internal)
+{
+	free(internal);
+}
+
+static void reservoir_get_value(
+	mdcs_counter_reservoir_internal* internal,
+	void* v)
+{
+	size_t size = (size_t)internal->item_size*internal->capacity;
+	memcpy(v, internal, RESERVOIR_HEADER_SIZE);
+	memcpy((char*)v + RESERVOIR_HEADER_SIZE, internal->samples, size);
+}
+
+static void reservoir_push_multi(
+	mdcs_counter_reservoir_internal* internal,
+	const char* items, size_t count)
+{
+	size_t s = internal->item_size;
+	size_t i = 0;
+
+	// fill the reservoir first
+	while(internal->num_samples < internal->capacity && i < count) {
+		memcpy(internal->samples + internal->num_samples*s, items + i*s, s);
+		internal->num_samples += 1;
+		internal->seen += 1;
+		i += 1;
+		if(internal->num_samples == internal->capacity)
+			reservoir_next_skip(internal);
+	}
+
+	// then jump directly from one replaced item to the next
+	while(i < count) {
+		size_t remaining = count - i;
+		if(internal->skip >= remaining) {
+			internal->skip -= remaining;
+			internal->seen += remaining;
+			return;
+		}
+		i += internal->skip;
+		internal->seen += internal->skip + 1;
+		size_t slot = (size_t)(reservoir_random(internal)*internal->capacity);
+		if(slot == internal->capacity) slot -= 1;
+		memcpy(internal->samples + slot*s, items + i*s, s);
+		i += 1;
+		reservoir_next_skip(internal);
+	}
+}
+
+static void reservoir_push_one(
+	mdcs_counter_reservoir_internal* internal,
+	const void* item)
+{
+	// most pushes only decrement the skip counter
+	if(internal->num_samples == internal->capacity && internal->skip > 0) {
+		internal->skip -= 1;
+		internal->seen += 1;
+		return;
+	}
+	reservoir_push_multi(internal, (const char*)item, 1);
+}
+
+static const mdcs_counter_field_t reservoir_double_fields[] = {
+	{ "seen",        MDCS_FIELD_UINT64, offsetof(mdcs_counter_reservoir_double_value_t, seen),        1 },
+	{ "capacity",    MDCS_FIELD_UINT32, offsetof(mdcs_counter_reservoir_double_value_t, capacity),    1 },
+	{ "num_samples", MDCS_FIELD_UINT32, offsetof(mdcs_counter_reservoir_double_value_t, num_samples), 1 },
+	{ "item_size",   MDCS_FIELD_UINT32, offsetof(mdcs_counter_reservoir_double_value_t, item_size),   1 },
+	{ "samples",     MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_reservoir_double_value_t, samples),
+		MDCS_COUNTER_RESERVOIR_SIZE }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_RESERVOIR_DOUBLE_S = {
+    .counter_item_size  = sizeof(mdcs_counter_reservoir_double_item_t),
+    .counter_value_size = sizeof(mdcs_counter_reservoir_double_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)reservoir_destroy,
+    .reset_f            = (mdcs_reset_f)reservoir_reset,
+    .get_value_f        = (mdcs_get_value_f)reservoir_get_value,
+    .push_one_f         = (mdcs_push_one_f)reservoir_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)reservoir_push_multi,
+    .merge_f            = (mdcs_merge_f)NULL,
+    .counter_data_size  = RESERVOIR_DATA_SIZE(sizeof(double), MDCS_COUNTER_RESERVOIR_SIZE),
+    .create_args_f      = (mdcs_create_args_f)reservoir_create,
+    .args               = (void*)&reservoir_default_args,
+    .double_items       = 1,
+    .schema             = {
+        .type_name  = "reservoir_double",
+        .item_size  = sizeof(mdcs_counter_reservoir_double_item_t),
+        .value_size = sizeof(mdcs_counter_reservoir_double_value_t),
+        .num_fields = sizeof(reservoir_double_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = reservoir_double_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_reservoir_create(size_t item_size, size_t capacity,
+		mdcs_counter_type_t* type)
+{
+	if(item_size == 0 || item_size > UINT32_MAX
+	|| capacity == 0 || capacity > UINT32_MAX) {
+		MDCS_PRINT_ERROR("Invalid reservoir counter parameters");
+		return MDCS_ERROR;
+	}
+
+	reservoir_args_t* args = (reservoir_args_t*)malloc(sizeof(reservoir_args_t));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for reservoir counter type");
+		return MDCS_ERROR;
+	}
+	args->item_size = item_size;
+	args->capacity = capacity;
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(item_size,
+			MDCS_COUNTER_RESERVOIR_VALUE_SIZE(item_size, capacity),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)reservoir_destroy,
+			(mdcs_reset_f)reservoir_reset,
+			(mdcs_push_one_f)reservoir_push_one,
+			(mdcs_push_multi_f)reservoir_push_multi,
+			(mdcs_get_value_f)reservoir_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)reservoir_create;
+	newtype->args              = args;
+	newtype->counter_data_size = RESERVOIR_DATA_SIZE(item_size, capacity);
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Covariance counter, tracks joint statistics of (x, y) pairs
+////////////////////////////////////////////////////////////////////////////
+typedef struct {
+	size_t count;
+	double mean_x;
+	double mean_y;
+	double m2_x;   // sum of squared deviations of x
+	double m2_y;   // sum of squared deviations of y
+	double c_xy;   // sum of products of the deviations of x and y
+} mdcs_counter_covariance_internal;
+
+static void* covariance_create()
+{
+	return malloc(sizeof(mdcs_counter_covariance_internal));
+}
+
+static void covariance_destroy(void* internal)
+{
+	free(internal);
+}
+
+static void covariance_reset(
+	mdcs_counter_covariance_internal* internal)
+{
+	memset(internal, 0, sizeof(mdcs_counter_covariance_internal));
+}
+
+/**
+ * Merges the statistics of b into a (parallel algorithm).
+ */
+static void covariance_combine(
+	mdcs_counter_covariance_internal* a,
+	const mdcs_counter_covariance_internal* b)
+{
+	if(b->count == 0) return;
+	if(a->count == 0) {
+		*a = *b;
+		return;
+	}
+	double n1 = a->count;
+	double n2 = b->count;
+	double n  = n1 + n2;
+	double dx = b->mean_x - a->mean_x;
+	double dy = b->mean_y - a->mean_y;
+	a->m2_x += b->m2_x + dx*dx*n1*n2/n;
+	a->m2_y += b->m2_y + dy*dy*n1*n2/n;
+	a->c_xy += b->c_xy + dx*dy*n1*n2/n;
+	a->mean_x += dx*n2/n;
+	a->mean_y += dy*n2/n;
+	a->count += b->count;
+}
+
+static void covariance_get_value(
+	mdcs_counter_covariance_internal* internal,
+	mdcs_counter_covariance_value_t* v)
+{
+	double n = internal->count;
+	memset(v, 0, sizeof(*v));
+	v->count = internal->count;
+	if(internal->count == 0) return;
+	v->mean_x = internal->mean_x;
+	v->mean_y = internal->mean_y;
+	v->var_x  = internal->m2_x/n;
+	v->var_y  = internal->m2_y/n;
+	v->cov    = internal->c_xy/n;
+	if(internal->m2_x > 0)
+		v->slope = internal->c_xy/internal->m2_x;
+	if(internal->m2_x > 0 && internal->m2_y > 0)
+		v->correlation = internal->c_xy/sqrt(internal->m2_x*internal->m2_y);
+}
+
+static void covariance_push_one(
+	mdcs_counter_covariance_internal* internal,
+	mdcs_counter_covariance_item_t* item)
+{
+	internal->count += 1;
+	double n  = internal->count;
+	double dx = item->x - internal->mean_x;
+	double dy = item->y - internal->mean_y;
+	internal->mean_x += dx/n;
+	internal->mean_y += dy/n;
+	internal->m2_x += dx*(item->x - internal->mean_x);
+	internal->m2_y += dy*(item->y - internal->mean_y);
+	internal->c_xy += dx*(item->y - internal->mean_y);
+}
+
+static void covariance_push_multi(
+	mdcs_counter_covariance_internal* internal,
+	mdcs_counter_covariance_item_t* items, size_t count)
+{
+	// the statistics of the batch are computed with two passes
+	// free of loop-carried dependencies other than the sums, so
+	// that they can be vectorized, then merged into the counter
+	size_t i;
+	double sx = 0.0, sy = 0.0;
+	for(i=0; i < count; i++) {
+		sx += items[i].x;
+		sy += items[i].y;
+	}
+	mdcs_counter_covariance_internal batch = {
+		.count = count,
+		.mean_x = sx/count,
+		.mean_y = sy/count,
+		.m2_x = 0.0,
+		.m2_y = 0.0,
+		.c_xy = 0.0
+	};
+	double m2x = 0.0, m2y = 0.0, cxy = 0.0;
+	for(i=0; i < count; i++) {
+		double dx = items[i].x - batch.mean_x;
+		double dy = items[i].y - batch.mean_y;
+		m2x += dx*dx;
+		m2y += dy*dy;
+		cxy += dx*dy;
+	}
+	batch.m2_x = m2x;
+	batch.m2_y = m2y;
+	batch.c_xy = cxy;
+	covariance_combine(internal, &batch);
+}
+
+static int covariance_merge(
+	mdcs_counter_covariance_value_t* v,
+	const mdcs_counter_covariance_value_t* other)
+{
+	mdcs_counter_covariance_internal a = {
+		.count = v->count, .mean_x = v->mean_x, .mean_y = v->mean_y,
+		.m2_x = v->var_x*v->count, .m2_y = v->var_y*v->count, .c_xy = v->cov*v->count
+	};
+	mdcs_counter_covariance_internal b = {
+		.count = other->count, .mean_x = other->mean_x, .mean_y = other->mean_y,
+		.m2_x = other->var_x*other->count, .m2_y = other->var_y*other->count,
+		.c_xy = other->cov*other->count
+	};
+	covariance_combine(&a, &b);
+	covariance_get_value(&a, v);
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t covariance_fields[] = {
+	{ "count",       MDCS_FIELD_SIZE_T, offsetof(mdcs_counter_covariance_value_t, count),       1 },
+	{ "mean_x",      MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, mean_x),      1 },
+	{ "mean_y",      MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, mean_y),      1 },
+	{ "var_x",       MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, var_x),       1 },
+	{ "var_y",       MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, var_y),       1 },
+	{ "cov",         MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, cov),         1 },
+	{ "slope",       MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, slope),       1 },
+	{ "correlation", MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_covariance_value_t, correlation), 1 }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_COVARIANCE_S = {
+    .counter_item_size  = sizeof(mdcs_counter_covariance_item_t),
+    .counter_value_size = sizeof(mdcs_counter_covariance_value_t),
+    .create_f           = (mdcs_create_f)covariance_create,
+    .destroy_f          = (mdcs_destroy_f)covariance_destroy,
+    .reset_f            = (mdcs_reset_f)covariance_reset,
+    .get_value_f        = (mdcs_get_value_f)covariance_get_value,
+    .push_one_f         = (mdcs_push_one_f)covariance_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)covariance_push_multi,
+    .merge_f            = (mdcs_merge_f)covariance_merge,
+    .counter_data_size  = sizeof(mdcs_counter_covariance_internal),
+    .schema             = {
+        .type_name  = "covariance",
+        .item_size  = sizeof(mdcs_counter_covariance_item_t),
+        .value_size = sizeof(mdcs_counter_covariance_value_t),
+        .num_fields = sizeof(covariance_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = covariance_fields
+    },
+    .refcount           = -1
+};
+
+////////////////////////////////////////////////////////////////////////////
+// Atomic counter, lock-free tally of increments
+////////////////////////////////////////////////////////////////////////////
+
+/* increments are spread over cache-line-sized slots indexed by the rank
+ * of the calling execution stream, so that increments from different
+ * ESs do not contend; a read sums the slots. The number of slots is
+ * stored in a header of the same size as a slot, so that the slots
+ * stay aligned on cache lines. */
+#define ATOMIC_SLOT_SIZE 64
+#define ATOMIC_MAX_SLOTS 4096
+
+typedef struct {
+	uint64_t value;
+	char     padding[ATOMIC_SLOT_SIZE - sizeof(uint64_t)];
+} atomic_slot_t;
+
+typedef struct {
+	uint64_t      num_slots;
+	char          padding[ATOMIC_SLOT_SIZE - sizeof(uint64_t)];
+	atomic_slot_t slots[];
+} mdcs_counter_atomic_internal;
+
+/* size of the internal data of an atomic counter with n slots */
+#define ATOMIC_INTERNAL_SIZE(n) (sizeof(mdcs_counter_atomic_internal) + (n)*sizeof(atomic_slot_t))
+
+typedef struct {
+	size_t num_slots;
+} atomic_args_t;
+
+static const atomic_args_t atomic_default_args = {
+	.num_slots = MDCS_COUNTER_ATOMIC_SLOTS
+};
+
+static void atomic_reset(
+	mdcs_counter_atomic_internal* internal)
+{
+	size_t i;
+	for(i=0; i < internal->num_slots; i++)
+		__atomic_store_n(&internal->slots[i].value, 0, __ATOMIC_RELAXED);
+}
+
+static void* atomic_create(const atomic_args_t* args)
+{
+	void* p = NULL;
+	if(posix_memalign(&p, ATOMIC_SLOT_SIZE, ATOMIC_INTERNAL_SIZE(args->num_slots)) != 0)
+		return NULL;
+	mdcs_counter_atomic_internal* internal = (mdcs_counter_atomic_internal*)p;
+	internal->num_slots = args->num_slots;
+	atomic_reset(internal);
+	return internal;
+}
+
+static void atomic_destroy(void* internal)
+{
+	free(internal);
+}
+
+static inline void atomic_add(
+	mdcs_counter_atomic_internal* internal, uint64_t amount)
+{
+	// callers outside of an Argobots ES all use the first slot
+	int rank = 0;
+	if(ABT_xstream_self_rank(&rank) != ABT_SUCCESS) rank = 0;
+	__atomic_fetch_add(&internal->slots[(unsigned)rank % internal->num_slots].value,
+			amount, __ATOMIC_RELAXED);
+}
+
+static void atomic_get_value(
+	mdcs_counter_atomic_internal* internal,
+	mdcs_counter_atomic_value_t* v)
+{
+	size_t i;
+	uint64_t sum = 0;
+	for(i=0; i < internal->num_slots; i++)
+		sum += __atomic_load_n(&internal->slots[i].value, __ATOMIC_RELAXED);
+	*v = sum;
+}
+
+static void atomic_push_one(
+	mdcs_counter_atomic_internal* internal,
+	mdcs_counter_atomic_item_t* item)
+{
+	atomic_add(internal, *item);
+}
+
+static void atomic_push_multi(
+	mdcs_counter_atomic_internal* internal,
+	mdcs_counter_atomic_item_t* items, size_t count)
+{
+	size_t i;
+	uint64_t sum = 0;
+	for(i=0; i < count; i++)
+		sum += items[i];
+	atomic_add(internal, sum);
+}
+
+static int atomic_merge(
+	mdcs_counter_atomic_value_t* v,
+	const mdcs_counter_atomic_value_t* other)
+{
+	*v += *other;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t atomic_fields[] = {
+	{ "value", MDCS_FIELD_UINT64, 0, 1 }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_ATOMIC_S = {
+    .counter_item_size  = sizeof(mdcs_counter_atomic_item_t),
+    .counter_value_size = sizeof(mdcs_counter_atomic_value_t),
+    .create_f           = (mdcs_create_f)NULL,
+    .destroy_f          = (mdcs_destroy_f)atomic_destroy,
+    .reset_f            = (mdcs_reset_f)atomic_reset,
+    .get_value_f        = (mdcs_get_value_f)atomic_get_value,
+    .push_one_f         = (mdcs_push_one_f)atomic_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)atomic_push_multi,
+    .merge_f            = (mdcs_merge_f)atomic_merge,
+    .counter_data_size  = ATOMIC_INTERNAL_SIZE(MDCS_COUNTER_ATOMIC_SLOTS),
+    .create_args_f      = (mdcs_create_args_f)atomic_create,
+    .args               = (void*)&atomic_default_args,
+    .lock_free          = 1,
+    .schema             = {
+        .type_name  = "atomic",
+        .item_size  = sizeof(mdcs_counter_atomic_item_t),
+        .value_size = sizeof(mdcs_counter_atomic_value_t),
+        .num_fields = sizeof(atomic_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = atomic_fields
+    },
+    .refcount           = -1
+};
+
+int mdcs_counter_type_atomic_create(size_t num_slots, mdcs_counter_type_t* type)
+{
+	if(num_slots == 0 || num_slots > ATOMIC_MAX_SLOTS) {
+		MDCS_PRINT_ERROR("Number of slots of an atomic counter must be between 1 and 4096");
+		return MDCS_ERROR;
+	}
+
+	atomic_args_t* args = (atomic_args_t*)malloc(sizeof(atomic_args_t));
+	if(args == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for atomic counter type");
+		return MDCS_ERROR;
+	}
+	args->num_slots = num_slots;
+
+	mdcs_counter_type_t newtype = MDCS_COUNTER_TYPE_NULL;
+	int ret = mdcs_counter_type_create(sizeof(mdcs_counter_atomic_item_t),
+			sizeof(mdcs_counter_atomic_value_t),
+			(mdcs_create_f)NULL,
+			(mdcs_destroy_f)atomic_destroy,
+			(mdcs_reset_f)atomic_reset,
+			(mdcs_push_one_f)atomic_push_one,
+			(mdcs_push_multi_f)atomic_push_multi,
+			(mdcs_get_value_f)atomic_get_value,
+			&newtype);
+	if(ret != MDCS_SUCCESS) {
+		free(args);
+		return ret;
+	}
+
+	newtype->create_args_f     = (mdcs_create_args_f)atomic_create;
+	newtype->merge_f           = (mdcs_merge_f)atomic_merge;
+	newtype->args              = args;
+	newtype->counter_data_size = ATOMIC_INTERNAL_SIZE(num_slots);
+	newtype->lock_free         = 1;
+
+	*type = newtype;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_atomic_add(mdcs_counter_t counter, uint64_t amount)
+{
+	if(counter == MDCS_COUNTER_NULL || counter->num_slots != 0
+	|| counter->t->push_one_f != (mdcs_push_one_f)atomic_push_one) {
+		MDCS_PRINT_ERROR("Counter is not a scalar atomic counter");
+		return MDCS_ERROR;
+	}
+	atomic_add((mdcs_counter_atomic_internal*)(counter->counter_internal_data), amount);
+	return MDCS_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Histogram counter, counts durations in exponential buckets
+////////////////////////////////////////////////////////////////////////////
+typedef mdcs_counter_histogram_value_t mdcs_counter_histogram_internal;
+
+static void* histogram_create()
+{
+	return malloc(sizeof(mdcs_counter_histogram_internal));
+}
+
+static void histogram_destroy(void* internal)
+{
+	free(internal);
+}
+
+static void histogram_reset(
+	mdcs_counter_histogram_internal* internal)
+{
+	memset(internal, 0, sizeof(mdcs_counter_histogram_internal));
+}
+
+/**
+ * Returns the bucket of a duration in seconds. Bucket i > 0 holds
+ * durations in (2^(i-1), 2^i] microseconds, which is read from
+ * the exponent of the duration in microseconds.
+ */
+static inline size_t histogram_bucket(double seconds)
+{
+	double us = seconds*1e6;
+	if(!(us > 1.0)) return 0;
+	int e;
+	double m = frexp(us, &e); // us = m*2^e with m in [0.5, 1)
+	size_t b = (m == 0.5) ? (size_t)(e - 1) : (size_t)e;
+	return b < MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS ? b : MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS - 1;
+}
+
+static void histogram_get_value(
+	mdcs_counter_histogram_internal* internal,
+	mdcs_counter_histogram_value_t* v)
+{
+	memcpy(v, internal, sizeof(mdcs_counter_histogram_value_t));
+}
+
+static void histogram_push_one(
+	mdcs_counter_histogram_internal* internal,
+	mdcs_counter_histogram_item_t* item)
+{
+	internal->count += 1;
+	internal->sum += *item;
+	internal->buckets[histogram_bucket(*item)] += 1;
+}
+
+static void histogram_push_multi(
+	mdcs_counter_histogram_internal* internal,
+	mdcs_counter_histogram_item_t* items, size_t count)
+{
+	size_t i;
+	double sum = 0.0;
+	for(i=0; i < count; i++) {
+		sum += items[i];
+		internal->buckets[histogram_bucket(items[i])] += 1;
+	}
+	internal->count += count;
+	internal->sum += sum;
+}
+
+static int histogram_merge(
+	mdcs_counter_histogram_value_t* v,
+	const mdcs_counter_histogram_value_t* other)
+{
+	size_t i;
+	v->count += other->count;
+	v->sum += other->sum;
+	for(i=0; i < MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS; i++)
+		v->buckets[i] += other->buckets[i];
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t histogram_fields[] = {
+	{ "count",   MDCS_FIELD_UINT64, offsetof(mdcs_counter_histogram_value_t, count),   1 },
+	{ "sum",     MDCS_FIELD_DOUBLE, offsetof(mdcs_counter_histogram_value_t, sum),     1 },
+	{ "buckets", MDCS_FIELD_UINT64, offsetof(mdcs_counter_histogram_value_t, buckets),
+		MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_HISTOGRAM_S = {
+    .counter_item_size  = sizeof(mdcs_counter_histogram_item_t),
+    .counter_value_size = sizeof(mdcs_counter_histogram_value_t),
+    .create_f           = (mdcs_create_f)histogram_create,
+    .destroy_f          = (mdcs_destroy_f)histogram_destroy,
+    .reset_f            = (mdcs_reset_f)histogram_reset,
+    .get_value_f        = (mdcs_get_value_f)histogram_get_value,
+    .push_one_f         = (mdcs_push_one_f)histogram_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)histogram_push_multi,
+    .merge_f            = (mdcs_merge_f)histogram_merge,
+    .counter_data_size  = sizeof(mdcs_counter_histogram_internal),
+    .double_items       = 1,
+    .schema             = {
+        .type_name  = "histogram",
+        .item_size  = sizeof(mdcs_counter_histogram_item_t),
+        .value_size = sizeof(mdcs_counter_histogram_value_t),
+        .num_fields = sizeof(histogram_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = histogram_fields
+    },
+    .refcount           = -1
+};
+
+////////////////////////////////////////////////////////////////////////////
+// Gauge counter, tracks a level that goes up and down
+////////////////////////////////////////////////////////////////////////////
+typedef mdcs_counter_gauge_value_t mdcs_counter_gauge_internal;
+
+static void* gauge_create()
+{
+	return calloc(1, sizeof(mdcs_counter_gauge_internal));
+}
+
+static void gauge_destroy(void* internal)
+{
+	free(internal);
+}
+
+static void gauge_reset(
+	mdcs_counter_gauge_internal* internal)
+{
+	internal->min = internal->current;
+	internal->max = internal->current;
+}
+
+static void gauge_get_value(
+	mdcs_counter_gauge_internal* internal,
+	mdcs_counter_gauge_value_t* v)
+{
+	*v = *internal;
+}
+
+static void gauge_push_one(
+	mdcs_counter_gauge_internal* internal,
+	mdcs_counter_gauge_item_t* item)
+{
+	internal->current += *item;
+	if(internal->current < internal->min) internal->min = internal->current;
+	if(internal->current > internal->max) internal->max = internal->current;
+}
+
+static void gauge_push_multi(
+	mdcs_counter_gauge_internal* internal,
+	mdcs_counter_gauge_item_t* items, size_t count)
+{
+	size_t i;
+	for(i=0; i < count; i++)
+		gauge_push_one(internal, items + i);
+}
+
+static int gauge_merge(
+	mdcs_counter_gauge_value_t* v,
+	const mdcs_counter_gauge_value_t* other)
+{
+	// levels of different gauges add up, their extremes give bounds
+	v->current += other->current;
+	v->min += other->min;
+	v->max += other->max;
+	return MDCS_SUCCESS;
+}
+
+static const mdcs_counter_field_t gauge_fields[] = {
+	{ "current", MDCS_FIELD_INT64, offsetof(mdcs_counter_gauge_value_t, current), 1 },
+	{ "min",     MDCS_FIELD_INT64, offsetof(mdcs_counter_gauge_value_t, min),     1 },
+	{ "max",     MDCS_FIELD_INT64, offsetof(mdcs_counter_gauge_value_t, max),     1 }
+};
+
+struct mdcs_counter_type_s MDCS_COUNTER_GAUGE_S = {
+    .counter_item_size  = sizeof(mdcs_counter_gauge_item_t),
+    .counter_value_size = sizeof(mdcs_counter_gauge_value_t),
+    .create_f           = (mdcs_create_f)gauge_create,
+    .destroy_f          = (mdcs_destroy_f)gauge_destroy,
+    .reset_f            = (mdcs_reset_f)gauge_reset,
+    .get_value_f        = (mdcs_get_value_f)gauge_get_value,
+    .push_one_f         = (mdcs_push_one_f)gauge_push_one,
+    .push_multi_f       = (mdcs_push_multi_f)gauge_push_multi,
+    .merge_f            = (mdcs_merge_f)gauge_merge,
+    .counter_data_size  = sizeof(mdcs_counter_gauge_internal),
+    .schema             = {
+        .type_name  = "gauge",
+        .item_size  = sizeof(mdcs_counter_gauge_item_t),
+        .value_size = sizeof(mdcs_counter_gauge_value_t),
+        .num_fields = sizeof(gauge_fields)/sizeof(mdcs_counter_field_t),
+        .fields     = gauge_fields
+    },
+    .refcount           = -1
+};
+
+////////////////////////////////////////////////////////////////////////////
+// Variables exposed to users
+////////////////////////////////////////////////////////////////////////////
+mdcs_counter_type_t MDCS_COUNTER_LAST_DOUBLE = &MDCS_COUNTER_LAST_DOUBLE_S;
+mdcs_counter_type_t MDCS_COUNTER_LAST_INT64  = &MDCS_COUNTER_LAST_INT64_S;
+mdcs_counter_type_t MDCS_COUNTER_STAT_DOUBLE = &MDCS_COUNTER_STAT_DOUBLE_S;
+mdcs_counter_type_t MDCS_COUNTER_STAT_INT64  = &MDCS_COUNTER_STAT_INT64_S;
+mdcs_counter_type_t MDCS_COUNTER_RATE        = &MDCS_COUNTER_RATE_S;
+mdcs_counter_type_t MDCS_COUNTER_WINDOW_DOUBLE = &MDCS_COUNTER_WINDOW_DOUBLE_S;
+mdcs_counter_type_t MDCS_COUNTER_HLL         = &MDCS_COUNTER_HLL_S;
+mdcs_counter_type_t MDCS_COUNTER_TOPK        = &MDCS_COUNTER_TOPK_S;
+mdcs_counter_type_t MDCS_COUNTER_RESERVOIR_DOUBLE = &MDCS_COUNTER_RESERVOIR_DOUBLE_S;
+mdcs_counter_type_t MDCS_COUNTER_COVARIANCE  = &MDCS_COUNTER_COVARIANCE_S;
+mdcs_counter_type_t MDCS_COUNTER_ATOMIC      = &MDCS_COUNTER_ATOMIC_S;
+mdcs_counter_type_t MDCS_COUNTER_HISTOGRAM   = &MDCS_COUNTER_HISTOGRAM_S;
+mdcs_counter_type_t MDCS_COUNTER_GAUGE       = &MDCS_COUNTER_GAUGE_S;
+
+struct mdcs_counter_type_s* const mdcs_builtin_counter_types[] = {
+	&MDCS_COUNTER_LAST_DOUBLE_S,
+	&MDCS_COUNTER_LAST_INT64_S,
+	&MDCS_COUNTER_STAT_DOUBLE_S,
+	&MDCS_COUNTER_STAT_INT64_S,
+	&MDCS_COUNTER_RATE_S,
+	&MDCS_COUNTER_WINDOW_DOUBLE_S,
+	&MDCS_COUNTER_HLL_S,
+	&MDCS_COUNTER_TOPK_S,
+	&MDCS_COUNTER_RESERVOIR_DOUBLE_S,
+	&MDCS_COUNTER_COVARIANCE_S,
+	&MDCS_COUNTER_ATOMIC_S,
+	&MDCS_COUNTER_HISTOGRAM_S,
+	&MDCS_COUNTER_GAUGE_S,
+	NULL
+};
 
@@ -0,0 +1,838 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-counter-family.h"
+#include "mdcs-exporter.h"
+#include "mdcs-time.h"
+#include "mdcs-error.h"
+
+/* period at which the exporter checks for connections, in ms */
+#define MDCS_EXPORTER_POLL_MS 100
+/* time given to a client to send its request and receive the response, in s */
+#define MDCS_EXPORTER_CLIENT_TIMEOUT 1.0
+/* maximum size of an HTTP request */
+#define MDCS_EXPORTER_MAX_REQUEST 4096
+/* initial capacity of the output buffer */
+#define MDCS_EXPORTER_INITIAL_CAPACITY 65536
+
+extern mdcs_t g_mdcs;
+
+/*
+ * Values rendered under the same metric name: the single value of a
+ * scalar counter, the slots of a vector counter, or the members of a
+ * family. Values are labelled by slot and by the labels of the member.
+ */
+typedef struct {
+	const char*           name;       // name of the metric
+	mdcs_counter_type_t   t;          // type of the values
+	size_t                num_values; // number of values
+	size_t                num_slots;  // number of slots, 0 if not a vector
+	mdcs_counter_family_t family;     // family of the values, NULL if none
+} series_t;
+
+////////////////////////////////////////////////////////////////////////////
+// Output buffer
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Makes room for n more bytes in the output buffer.
+ */
+static int exporter_reserve(mdcs_exporter_t e, size_t n)
+{
+	if(e->overflow) return -1;
+	if(e->size + n <= e->capacity) return 0;
+	size_t newcap = e->capacity ? 2*e->capacity : MDCS_EXPORTER_INITIAL_CAPACITY;
+	while(newcap < e->size + n) newcap *= 2;
+	char* b = (char*)realloc(e->buf, newcap);
+	if(b == NULL) {
+		e->overflow = 1;
+		return -1;
+	}
+	e->buf = b;
+	e->capacity = newcap;
+	return 0;
+}
+
+static void exporter_printf(mdcs_exporter_t e, const char* fmt, ...)
+{
+	va_list ap;
+	for(;;) {
+		if(e->overflow) return;
+		size_t avail = e->capacity - e->size;
+		va_start(ap, fmt);
+		int n = vsnprintf(e->buf + e->size, avail, fmt, ap);
+		va_end(ap);
+		if(n < 0) {
+			e->overflow = 1;
+			return;
+		}
+		if((size_t)n < avail) {
+			e->size += n;
+			return;
+		}
+		exporter_reserve(e, n + 1);
+	}
+}
+
+/**
+ * Appends a metric name made of an MDCS name and a suffix, replacing
+ * the characters OpenMetrics does not allow in names by '_'.
+ */
+static void exporter_name(mdcs_exporter_t e, const char* name, const char* suffix)
+{
+	size_t i;
+	size_t len = strlen(name);
+	size_t slen = strlen(suffix);
+	if(exporter_reserve(e, len + slen) != 0) return;
+	char* p = e->buf + e->size;
+	for(i=0; i < len + slen; i++) {
+		char c = i < len ? name[i] : suffix[i - len];
+		int ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+			|| c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+		p[i] = ok ? c : '_';
+	}
+	e->size += len + slen;
+}
+
+static void exporter_type(mdcs_exporter_t e, const char* name,
+		const char* suffix, const char* type)
+{
+	exporter_printf(e, "# TYPE ");
+	exporter_name(e, name, suffix);
+	exporter_printf(e, " %s\n", type);
+}
+
+/**
+ * Appends a label name, replacing the characters OpenMetrics does
+ * not allow in label names by '_'.
+ */
+static void exporter_label_name(mdcs_exporter_t e, const char* name)
+{
+	size_t i;
+	size_t len = strlen(name);
+	if(exporter_reserve(e, len) != 0) return;
+	char* p = e->buf + e->size;
+	for(i=0; i < len; i++) {
+		char c = name[i];
+		int ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+			|| c == '_' || (i > 0 && c >= '0' && c <= '9');
+		p[i] = ok ? c : '_';
+	}
+	e->size += len;
+}
+
+/**
+ * Appends a label value, escaping backslashes, quotes and newlines.
+ */
+static void exporter_label_value(mdcs_exporter_t e, const char* value)
+{
+	size_t len = strlen(value);
+	// every character needs at most two bytes
+	if(exporter_reserve(e, 2*len) != 0) return;
+	char* p = e->buf + e->size;
+	for(; *value != '\0'; value++) {
+		if(*value == '\\' || *value == '"') {
+			*p++ = '\\';
+			*p++ = *value;
+		} else if(*value == '\n') {
+			*p++ = '\\';
+			*p++ = 'n';
+		} else {
+			*p++ = *value;
+		}
+	}
+	e->size = p - e->buf;
+}
+
+/**
+ * Appends a sample of the i-th value of a series. The labels of the
+ * family member and the "slot" label of vector counters are added,
+ * followed by the key="val" label if key is not NULL.
+ */
+static void exporter_sample(mdcs_exporter_t e, const series_t* s, const char* suffix,
+		size_t i, const char* key, const char* val, const char* value)
+{
+	size_t l;
+	const char* sep = "{";
+	exporter_name(e, s->name, suffix);
+	if(s->family != NULL) {
+		mdcs_family_member_t m = s->family->members[i];
+		for(l=0; l < s->family->num_labels; l++) {
+			const mdcs_label_t* label = &s->family->labels[l];
+			exporter_printf(e, "%s", sep);
+			exporter_label_name(e, label->name);
+			exporter_printf(e, "=\"");
+			exporter_label_value(e, label->values[m->labels[l]]->str);
+			exporter_printf(e, "\"");
+			sep = ",";
+		}
+	}
+	if(s->num_slots != 0) {
+		exporter_printf(e, "%sslot=\"%zu\"", sep, i);
+		sep = ",";
+	}
+	if(key != NULL) {
+		exporter_printf(e, "%s%s=\"%s\"", sep, key, val);
+		sep = ",";
+	}
+	exporter_printf(e, "%s %s\n", sep[0] == ',' ? "}" : "", value);
+}
+
+/* buffers used to format sample values */
+typedef char number_t[32];
+
+static const char* fmt_double(number_t out, double v)
+{
+	if(isnan(v)) return "NaN";
+	if(isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+	snprintf(out, sizeof(number_t), "%.17g", v);
+	return out;
+}
+
+static const char* fmt_int64(number_t out, int64_t v)
+{
+	snprintf(out, sizeof(number_t), "%" PRId64, v);
+	return out;
+}
+
+static const char* fmt_uint64(number_t out, uint64_t v)
+{
+	snprintf(out, sizeof(number_t), "%" PRIu64, v);
+	return out;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Rendering of the counters
+////////////////////////////////////////////////////////////////////////////
+
+/* pointer to the i-th value of a series */
+static const void* value_at(const series_t* s, const void* values, size_t i)
+{
+	return (const char*)values + i*s->t->counter_value_size;
+}
+
+static void render_last_double(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const double* v = value_at(s, values, i);
+		exporter_sample(e, s, "", i, NULL, NULL, fmt_double(n, *v));
+	}
+}
+
+static void render_last_int64(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const int64_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "", i, NULL, NULL, fmt_int64(n, *v));
+	}
+}
+
+/**
+ * Statistics are rendered as a summary (count and sum) along
+ * with gauges for their minimum and maximum.
+ */
+static void render_stat_double(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "summary");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_double_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_count", i, NULL, NULL, fmt_uint64(n, v->count));
+		exporter_sample(e, s, "_sum", i, NULL, NULL, fmt_double(n, v->avg*v->count));
+	}
+	exporter_type(e, s->name, "_min", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_double_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_min", i, NULL, NULL, fmt_double(n, v->min));
+	}
+	exporter_type(e, s->name, "_max", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_double_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_max", i, NULL, NULL, fmt_double(n, v->max));
+	}
+}
+
+/**
+ * Sliding windows forget old values, so their count and sum go down
+ * and cannot be rendered as a summary: all their fields are gauges.
+ */
+static void render_window_double(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	static const char* suffixes[4] = { "_count", "_avg", "_min", "_max" };
+	number_t n;
+	size_t i, f;
+	for(f=0; f < 4; f++) {
+		exporter_type(e, s->name, suffixes[f], "gauge");
+		for(i=0; i < s->num_values; i++) {
+			const mdcs_counter_window_double_value_t* v = value_at(s, values, i);
+			const char* value;
+			switch(f) {
+			case 0:  value = fmt_uint64(n, v->count); break;
+			case 1:  value = fmt_double(n, v->avg); break;
+			case 2:  value = fmt_double(n, v->min); break;
+			default: value = fmt_double(n, v->max); break;
+			}
+			exporter_sample(e, s, suffixes[f], i, NULL, NULL, value);
+		}
+	}
+}
+
+static void render_stat_int64(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "summary");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_int64_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_count", i, NULL, NULL, fmt_uint64(n, v->count));
+		exporter_sample(e, s, "_sum", i, NULL, NULL, fmt_double(n, v->avg*v->count));
+	}
+	exporter_type(e, s->name, "_min", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_int64_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_min", i, NULL, NULL, fmt_int64(n, v->min));
+	}
+	exporter_type(e, s->name, "_max", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_stat_int64_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_max", i, NULL, NULL, fmt_int64(n, v->max));
+	}
+}
+
+static void render_rate(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	static const char* windows[3] = { "1s", "5s", "15s" };
+	number_t n;
+	size_t i, w;
+	exporter_type(e, s->name, "", "counter");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_rate_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_total", i, NULL, NULL, fmt_uint64(n, v->total));
+	}
+	exporter_type(e, s->name, "_rate", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_rate_value_t* v = value_at(s, values, i);
+		for(w=0; w < 3; w++)
+			exporter_sample(e, s, "_rate", i, "window", windows[w],
+					fmt_double(n, v->rate[w]));
+	}
+}
+
+static void render_atomic(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "counter");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_atomic_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "_total", i, NULL, NULL, fmt_uint64(n, *v));
+	}
+}
+
+static void render_gauge(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n;
+	size_t i;
+	exporter_type(e, s->name, "", "gauge");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_gauge_value_t* v = value_at(s, values, i);
+		exporter_sample(e, s, "", i, NULL, NULL, fmt_int64(n, v->current));
+	}
+}
+
+/**
+ * Histograms are rendered with cumulative buckets whose upper bounds,
+ * in seconds, are those of the power-of-two microsecond buckets.
+ * The last bucket is unbounded.
+ */
+static void render_histogram(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	number_t n, le;
+	size_t i, b;
+	exporter_type(e, s->name, "", "histogram");
+	for(i=0; i < s->num_values; i++) {
+		const mdcs_counter_histogram_value_t* v = value_at(s, values, i);
+		uint64_t cumulated = 0;
+		for(b=0; b < MDCS_COUNTER_HISTOGRAM_NUM_BUCKETS - 1; b++) {
+			cumulated += v->buckets[b];
+			snprintf(le, sizeof(le), "%.10g", ldexp(1e-6, (int)b));
+			exporter_sample(e, s, "_bucket", i, "le", le, fmt_uint64(n, cumulated));
+		}
+		exporter_sample(e, s, "_bucket", i, "le", "+Inf", fmt_uint64(n, v->count));
+		exporter_sample(e, s, "_count", i, NULL, NULL, fmt_uint64(n, v->count));
+		exporter_sample(e, s, "_sum", i, NULL, NULL, fmt_double(n, v->sum));
+	}
+}
+
+static const char* fmt_field(number_t out, const char* p, mdcs_field_type_t type)
+{
+	switch(type) {
+	case MDCS_FIELD_INT8:   return fmt_int64(out, *(const int8_t*)p);
+	case MDCS_FIELD_UINT8:  return fmt_uint64(out, *(const uint8_t*)p);
+	case MDCS_FIELD_INT32:  return fmt_int64(out, *(const int32_t*)p);
+	case MDCS_FIELD_UINT32: return fmt_uint64(out, *(const uint32_t*)p);
+	case MDCS_FIELD_INT64:  return fmt_int64(out, *(const int64_t*)p);
+	case MDCS_FIELD_UINT64: return fmt_uint64(out, *(const uint64_t*)p);
+	case MDCS_FIELD_FLOAT:  return fmt_double(out, *(const float*)p);
+	case MDCS_FIELD_DOUBLE: return fmt_double(out, *(const double*)p);
+	}
+	return "NaN";
+}
+
+/**
+ * Other types are rendered from their schema, with a gauge per field
+ * named after the field. Elements of array fields are labelled by index.
+ */
+static void render_schema(mdcs_exporter_t e, const series_t* s, const void* values)
+{
+	const mdcs_counter_schema_t* schema = &s->t->schema;
+	number_t n, index;
+	char suffix[128];
+	size_t i, f, j;
+
+	for(f=0; f < schema->num_fields; f++) {
+		const mdcs_counter_field_t* field = &schema->fields[f];
+		size_t fsize = mdcs_field_type_size(field->type);
+		snprintf(suffix, sizeof(suffix), "_%s", field->name);
+		exporter_type(e, s->name, suffix, "gauge");
+		for(i=0; i < s->num_values; i++) {
+			const char* v = (const char*)value_at(s, values, i) + field->offset;
+			if(field->count == 1) {
+				exporter_sample(e, s, suffix, i, NULL, NULL,
+						fmt_field(n, v, field->type));
+				continue;
+			}
+			for(j=0; j < field->count; j++) {
+				snprintf(index, sizeof(index), "%zu", j);
+				exporter_sample(e, s, suffix, i, "index", index,
+						fmt_field(n, v + j*fsize, field->type));
+			}
+		}
+	}
+}
+
+/**
+ * Makes room for n bytes in the value buffer.
+ */
+static int exporter_reserve_value(mdcs_exporter_t e, size_t n)
+{
+	if(n <= e->value_capacity) return 0;
+	void* v = realloc(e->value, n);
+	if(v == NULL) {
+		e->overflow = 1;
+		return -1;
+	}
+	e->value = v;
+	e->value_capacity = n;
+	return 0;
+}
+
+static void render_series(mdcs_exporter_t e, const series_t* s)
+{
+	mdcs_counter_type_t t = s->t;
+
+	if(t == MDCS_COUNTER_LAST_DOUBLE)
+		render_last_double(e, s, e->value);
+	else if(t == MDCS_COUNTER_LAST_INT64)
+		render_last_int64(e, s, e->value);
+	else if(t == MDCS_COUNTER_STAT_DOUBLE)
+		render_stat_double(e, s, e->value);
+	else if(t == MDCS_COUNTER_WINDOW_DOUBLE)
+		render_window_double(e, s, e->value);
+	else if(t == MDCS_COUNTER_STAT_INT64)
+		render_stat_int64(e, s, e->value);
+	else if(t == MDCS_COUNTER_RATE)
+		render_rate(e, s, e->value);
+	else if(t == MDCS_COUNTER_ATOMIC)
+		render_atomic(e, s, e->value);
+	else if(t == MDCS_COUNTER_GAUGE)
+		render_gauge(e, s, e->value);
+	else if(t == MDCS_COUNTER_HISTOGRAM)
+		render_histogram(e, s, e->value);
+	else
+		render_schema(e, s, e->value);
+}
+
+static void render_counter(mdcs_exporter_t e, mdcs_counter_t c)
+{
+	series_t s = {
+		.name = c->name,
+		.t = c->t,
+		.num_values = c->num_slots ? c->num_slots : 1,
+		.num_slots = c->num_slots,
+		.family = NULL
+	};
+
+	if(exporter_reserve_value(e, s.num_values * c->t->counter_value_size) != 0)
+		return;
+
+	if(mdcs_counter_value(c, e->value) != MDCS_SUCCESS)
+		return;
+
+	render_series(e, &s);
+}
+
+/**
+ * Families are rendered as a single metric whose samples
+ * carry the labels of each member.
+ */
+static void render_family(mdcs_exporter_t e, mdcs_counter_family_t f)
+{
+	size_t i;
+	series_t s = {
+		.name = f->name,
+		.t = f->t,
+		.num_values = f->num_members,
+		.num_slots = 0,
+		.family = f
+	};
+
+	if(f->num_members == 0) return;
+
+	if(exporter_reserve_value(e, s.num_values * f->t->counter_value_size) != 0)
+		return;
+
+	for(i=0; i < f->num_members; i++) {
+		void* v = (char*)e->value + i*f->t->counter_value_size;
+		if(mdcs_counter_value(f->members[i]->counter, v) != MDCS_SUCCESS)
+			return;
+	}
+
+	render_series(e, &s);
+}
+
+/**
+ * Renders all the named counters and all the families into the output buffer.
+ */
+static void exporter_render(mdcs_exporter_t e)
+{
+	mdcs_counter_t current_counter, tmp;
+	mdcs_counter_family_t current_family, tmpf;
+
+	e->size = 0;
+	e->overflow = 0;
+	if(exporter_reserve(e, 1) != 0) return;
+
+	HASH_ITER(hh, g_mdcs->counter_hash, current_counter, tmp) {
+		if(current_counter->name != NULL)
+			render_counter(e, current_counter);
+	}
+
+	HASH_ITER(hh, g_mdcs->family_hash, current_family, tmpf) {
+		render_family(e, current_family);
+	}
+
+	exporter_printf(e, "# EOF\n");
+}
+
+////////////////////////////////////////////////////////////////////////////
+// HTTP server
+////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Waits until a client socket is ready for the given events. The socket
+ * is polled without blocking, yielding to the other ULTs of the pool in
+ * between. Returns 0 once the socket is ready, -1 if the deadline passes
+ * or the exporter is stopped first.
+ */
+static int exporter_wait(mdcs_exporter_t e, int fd, short events, double deadline)
+{
+	for(;;) {
+		struct pollfd p = { .fd = fd, .events = events, .revents = 0 };
+		int n = poll(&p, 1, 0);
+		if(n > 0) return 0;
+		if(n < 0 && errno != EINTR) return -1;
+		if(!__atomic_load_n(&e->running, __ATOMIC_ACQUIRE)
+		|| mdcs_time_now() > deadline) return -1;
+		ABT_thread_yield();
+	}
+}
+
+static int send_all(mdcs_exporter_t e, int fd, const char* data, size_t size, double deadline)
+{
+	while(size > 0) {
+		ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if(exporter_wait(e, fd, POLLOUT, deadline) != 0) return -1;
+			continue;
+		}
+		if(n <= 0) return -1;
+		data += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static void exporter_respond(mdcs_exporter_t e, int fd, const char* status, double deadline)
+{
+	char header[256];
+	int len = snprintf(header, sizeof(header),
+			"HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+	send_all(e, fd, header, len, deadline);
+}
+
+/**
+ * Reads a request from a client and responds with the counters.
+ * The client's socket is non-blocking.
+ */
+static void exporter_serve(mdcs_exporter_t e, int fd)
+{
+	char request[MDCS_EXPORTER_MAX_REQUEST];
+	size_t len = 0;
+	double deadline = mdcs_time_now() + MDCS_EXPORTER_CLIENT_TIMEOUT;
+
+	// read until the end of the headers
+	request[0] = '\0';
+	while(strstr(request, "\r\n\r\n") == NULL && strstr(request, "\n\n") == NULL) {
+		if(len == sizeof(request) - 1) {
+			exporter_respond(e, fd, "431 Request Header Fields Too Large", deadline);
+			return;
+		}
+		ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if(exporter_wait(e, fd, POLLIN, deadline) != 0) return;
+			continue;
+		}
+		if(n <= 0) return;
+		len += n;
+		request[len] = '\0';
+	}
+
+	if(strncmp(request, "GET ", 4) != 0) {
+		exporter_respond(e, fd, "405 Method Not Allowed", deadline);
+		return;
+	}
+
+	exporter_render(e);
+	if(e->overflow) {
+		MDCS_PRINT_ERROR("Could not allocate memory to render counters");
+		exporter_respond(e, fd, "500 Internal Server Error", deadline);
+		return;
+	}
+
+	char header[256];
+	int hlen = snprintf(header, sizeof(header),
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+			"Content-Length: %zu\r\n"
+			"Connection: close\r\n\r\n", e->size);
+	if(send_all(e, fd, header, hlen, deadline) == 0)
+		send_all(e, fd, e->buf, e->size, deadline);
+}
+
+/**
+ * Exporter ULT, running in Margo's handler pool so that rendering
+ * interleaves with the RPC handlers instead of running concurrently
+ * with them. The listening socket is non-blocking: when no client is
+ * waiting, the ULT sleeps, letting the other ULTs of the pool run.
+ */
+static void exporter_ult(void* arg)
+{
+	mdcs_exporter_t e = (mdcs_exporter_t)arg;
+
+	while(__atomic_load_n(&e->running, __ATOMIC_ACQUIRE)) {
+		int fd = accept(e->fd, NULL, NULL);
+		if(fd < 0) {
+			margo_thread_sleep(g_mdcs->mid, MDCS_EXPORTER_POLL_MS);
+			continue;
+		}
+		if(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0)
+			exporter_serve(e, fd);
+		close(fd);
+	}
+}
+
+/**
+ * Creates the listening socket for the provided address.
+ */
+static int exporter_listen(mdcs_exporter_t e, const char* address)
+{
+	if(strncmp(address, "unix:", 5) == 0) {
+		struct sockaddr_un sa;
+		const char* path = address + 5;
+		if(*path == '\0' || strlen(path) >= sizeof(sa.sun_path)) {
+			MDCS_PRINT_ERROR("Invalid Unix socket path for the exporter");
+			return MDCS_ERROR;
+		}
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		strcpy(sa.sun_path, path);
+		e->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(e->fd < 0 || bind(e->fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+			MDCS_PRINT_ERROR("Could not bind the exporter's Unix socket");
+			return MDCS_ERROR;
+		}
+		e->unix_path = strdup(path);
+		if(e->unix_path == NULL) {
+			unlink(path);
+			return MDCS_ERROR;
+		}
+	} else {
+		struct sockaddr_in sa;
+		char* end = NULL;
+		long port = strtol(address, &end, 10);
+		if(*address == '\0' || *end != '\0' || port <= 0 || port > 65535) {
+			MDCS_PRINT_ERROR("Invalid port for the exporter");
+			return MDCS_ERROR;
+		}
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons((uint16_t)port);
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		int one = 1;
+		e->fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(e->fd < 0) {
+			MDCS_PRINT_ERROR("Could not create the exporter's socket");
+			return MDCS_ERROR;
+		}
+		setsockopt(e->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if(bind(e->fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+			MDCS_PRINT_ERROR("Could not bind the exporter's port");
+			return MDCS_ERROR;
+		}
+	}
+
+	if(listen(e->fd, 16) != 0) {
+		MDCS_PRINT_ERROR("Could not listen on the exporter's socket");
+		return MDCS_ERROR;
+	}
+
+	if(fcntl(e->fd, F_SETFL, fcntl(e->fd, F_GETFL) | O_NONBLOCK) != 0) {
+		MDCS_PRINT_ERROR("Could not make the exporter's socket non-blocking");
+		return MDCS_ERROR;
+	}
+
+	return MDCS_SUCCESS;
+}
+
+static void exporter_free(mdcs_exporter_t e)
+{
+	__atomic_store_n(&e->running, 0, __ATOMIC_RELEASE);
+	if(e->thread != ABT_THREAD_NULL) {
+		ABT_thread_join(e->thread);
+		ABT_thread_free(&e->thread);
+	}
+	if(e->fd >= 0) close(e->fd);
+	if(e->unix_path) {
+		unlink(e->unix_path);
+		free(e->unix_path);
+	}
+	free(e->buf);
+	free(e->value);
+	free(e);
+}
+
+int mdcs_exporter_start(const char* address)
+{
+	ABT_pool pool = ABT_POOL_NULL;
+
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(g_mdcs->mid == MARGO_INSTANCE_NULL) {
+		MDCS_PRINT_ERROR("Exporter requires a Margo instance");
+		return MDCS_ERROR;
+	}
+
+	if(address == NULL) {
+		MDCS_PRINT_ERROR("No address provided for the exporter");
+		return MDCS_ERROR;
+	}
+
+	if(g_mdcs->exporter != NULL) {
+		MDCS_PRINT_ERROR("Exporter is already running");
+		return MDCS_ERROR;
+	}
+
+	mdcs_exporter_t e = (mdcs_exporter_t)calloc(1, sizeof(*e));
+	if(e == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for the exporter");
+		return MDCS_ERROR;
+	}
+	e->fd = -1;
+	e->thread = ABT_THREAD_NULL;
+
+	if(exporter_listen(e, address) != MDCS_SUCCESS)
+		goto error;
+
+	if(exporter_reserve(e, MDCS_EXPORTER_INITIAL_CAPACITY) != 0) {
+		MDCS_PRINT_ERROR("Could not allocate the exporter's buffer");
+		goto error;
+	}
+
+	e->running = 1;
+
+	margo_get_handler_pool(g_mdcs->mid, &pool);
+	if(pool == ABT_POOL_NULL)
+		margo_get_progress_pool(g_mdcs->mid, &pool);
+
+	if(ABT_thread_create(pool, exporter_ult, e,
+			ABT_THREAD_ATTR_NULL, &e->thread) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create the exporter ULT");
+		e->thread = ABT_THREAD_NULL;
+		goto error;
+	}
+
+	g_mdcs->exporter = e;
+	return MDCS_SUCCESS;
+
+error:
+	exporter_free(e);
+	return MDCS_ERROR;
+}
+
+int mdcs_exporter_stop()
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(g_mdcs->exporter == NULL) {
+		MDCS_PRINT_ERROR("Exporter is not running");
+		return MDCS_ERROR;
+	}
+
+	exporter_free(g_mdcs->exporter);
+	g_mdcs->exporter = NULL;
+
+	return MDCS_SUCCESS;
+}
+
+void mdcs_exporter_finalize()
+{
+	if(g_mdcs->exporter == NULL) return;
+	exporter_free(g_mdcs->exporter);
+	g_mdcs->exporter = NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_EXPORTER_H
+#define __MDCS_EXPORTER_H
+
+#include <abt.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * State of the OpenMetrics exporter. The output and value buffers
+ * are kept from one scrape to the next, and only grow when the
+ * registry does, so that scrapes do not allocate memory.
+ */
+typedef struct mdcs_exporter_s {
+	int         fd;             // listening socket
+	char*       unix_path;      // path of the Unix socket, NULL for TCP
+	int         running;        // whether the exporter ULT should run
+	ABT_thread  thread;         // exporter ULT
+	char*       buf;            // output buffer
+	size_t      size;           // size of the rendered output
+	size_t      capacity;       // capacity of the output buffer
+	void*       value;          // buffer receiving the value of a counter
+	size_t      value_capacity; // capacity of the value buffer
+	int         overflow;       // set if a buffer could not grow
+}* mdcs_exporter_t;
+
+/**
+ * Stops the exporter if it is running.
+ */
+void mdcs_exporter_finalize();
+
+#endif
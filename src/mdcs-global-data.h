@@ -6,13 +6,38 @@
 #ifndef __MDCS_GLOBAL_DATA_H
 #define __MDCS_GLOBAL_DATA_H
 
+#include <abt.h>
 #include <mdcs/mdcs.h>
+#include "mdcs-name-trie.h"
+#include "mdcs-counter-schema.h"
+#include "mdcs-rpc-monitor.h"
+#include "mdcs-abt-sampler.h"
+#include "mdcs-margo-stats.h"
+#include "mdcs-self-stats.h"
+#include "mdcs-exporter.h"
 
 typedef struct mdcs_data_s {
     mdcs_counter_t counter_hash;
+	mdcs_counter_family_t family_hash;
+	mdcs_trie_node_t counter_trie;
+	mdcs_counter_type_t type_hash;
+	mdcs_schema_entry_t schema_cache;
+	mdcs_rpc_monitor_t rpc_monitors;
+	mdcs_abt_sampler_t abt_sampler;
+	mdcs_margo_stats_t margo_stats;
+	mdcs_self_stats_t self_stats;
+	mdcs_exporter_t exporter;
 	margo_instance_id mid;
+	ABT_mutex watch_mutex;
+	uint64_t watch_parked;
+	int watch_closed;
 	hg_id_t rpc_fetch_id;
 	hg_id_t rpc_reset_id;
+	hg_id_t rpc_push_id;
+	hg_id_t rpc_aggregate_id;
+	hg_id_t rpc_list_id;
+	hg_id_t rpc_schema_id;
+	hg_id_t rpc_watch_id;
 }* mdcs_t;
 
 #define MDCS_NULL ((mdcs_t)NULL)
@@ -10,4 +10,18 @@
 
 uint64_t mdcs_hash_string(const char *string);
 
+/**
+ * Mixes the bits of a 64-bit key (finalizer of MurmurHash3), so that
+ * keys that differ in a few bits give uncorrelated hashes.
+ */
+static inline uint64_t mdcs_hash_mix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
 #endif
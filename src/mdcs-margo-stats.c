@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-margo.h>
+#include <mdcs/mdcs-timer.h>
+#include "mdcs-global-data.h"
+#include "mdcs-margo-stats.h"
+#include "mdcs-error.h"
+
+extern mdcs_t g_mdcs;
+
+int mdcs_margo_stats_init()
+{
+	mdcs_margo_stats_t s = (mdcs_margo_stats_t)calloc(1, sizeof(*s));
+	if(s == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for Margo counters");
+		return MDCS_ERROR;
+	}
+
+	if(ABT_mutex_create(&s->mutex) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create Margo counters mutex");
+		free(s);
+		return MDCS_ERROR;
+	}
+
+	if(mdcs_counter_register("margo:bulk_pull:count", MDCS_COUNTER_ATOMIC, 0, &s->pull.count) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:bulk_pull:bytes", MDCS_COUNTER_ATOMIC, 0, &s->pull.bytes) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:bulk_pull:time", MDCS_COUNTER_HISTOGRAM, 0, &s->pull.time) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:bulk_push:count", MDCS_COUNTER_ATOMIC, 0, &s->push.count) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:bulk_push:bytes", MDCS_COUNTER_ATOMIC, 0, &s->push.bytes) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:bulk_push:time", MDCS_COUNTER_HISTOGRAM, 0, &s->push.time) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:forward:count", MDCS_COUNTER_ATOMIC, 0, &s->forwards) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:forward:time", MDCS_COUNTER_HISTOGRAM, 0, &s->forward_time) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:handles", MDCS_COUNTER_GAUGE, 0, &s->handles) != MDCS_SUCCESS
+	|| mdcs_counter_register("margo:progress_lag", MDCS_COUNTER_HISTOGRAM, 0, &s->progress_lag) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not register Margo counters");
+		ABT_mutex_free(&s->mutex);
+		free(s);
+		return MDCS_ERROR;
+	}
+
+	g_mdcs->margo_stats = s;
+	return MDCS_SUCCESS;
+}
+
+void mdcs_margo_stats_finalize()
+{
+	mdcs_margo_stats_t s = g_mdcs->margo_stats;
+	if(s == NULL) return;
+	ABT_mutex_free(&s->mutex);
+	free(s);
+	g_mdcs->margo_stats = NULL;
+}
+
+void mdcs_margo_stats_time(mdcs_counter_t histogram, double seconds)
+{
+	ABT_mutex_lock(g_mdcs->margo_stats->mutex);
+	mdcs_counter_push(histogram, &seconds);
+	ABT_mutex_unlock(g_mdcs->margo_stats->mutex);
+}
+
+/**
+ * Pushes a change of the number of live handles.
+ */
+static void margo_stats_handles(int64_t delta)
+{
+	ABT_mutex_lock(g_mdcs->margo_stats->mutex);
+	mdcs_counter_push(g_mdcs->margo_stats->handles, &delta);
+	ABT_mutex_unlock(g_mdcs->margo_stats->mutex);
+}
+
+hg_return_t mdcs_margo_create(margo_instance_id mid, hg_addr_t addr,
+		hg_id_t id, hg_handle_t* handle)
+{
+	hg_return_t ret = margo_create(mid, addr, id, handle);
+	if(ret == HG_SUCCESS && g_mdcs != NULL)
+		margo_stats_handles(1);
+	return ret;
+}
+
+hg_return_t mdcs_margo_destroy(hg_handle_t handle)
+{
+	if(handle != HG_HANDLE_NULL && g_mdcs != NULL)
+		margo_stats_handles(-1);
+	return margo_destroy(handle);
+}
+
+hg_return_t mdcs_margo_forward(hg_handle_t handle, void* in)
+{
+	if(g_mdcs == NULL) return margo_forward(handle, in);
+
+	mdcs_timer_t t = mdcs_timer_start();
+	hg_return_t ret = margo_forward(handle, in);
+	double elapsed = mdcs_timer_elapsed(t);
+
+	mdcs_counter_atomic_add(g_mdcs->margo_stats->forwards, 1);
+	mdcs_margo_stats_time(g_mdcs->margo_stats->forward_time, elapsed);
+	return ret;
+}
+
+hg_return_t mdcs_margo_bulk_transfer(margo_instance_id mid, hg_bulk_op_t op,
+		hg_addr_t origin_addr, hg_bulk_t origin_handle, size_t origin_offset,
+		hg_bulk_t local_handle, size_t local_offset, size_t size)
+{
+	if(g_mdcs == NULL)
+		return margo_bulk_transfer(mid, op, origin_addr, origin_handle,
+				origin_offset, local_handle, local_offset, size);
+
+	mdcs_timer_t t = mdcs_timer_start();
+	hg_return_t ret = margo_bulk_transfer(mid, op, origin_addr, origin_handle,
+			origin_offset, local_handle, local_offset, size);
+	double elapsed = mdcs_timer_elapsed(t);
+
+	mdcs_bulk_stats_t* b = (op == HG_BULK_PULL) ? &g_mdcs->margo_stats->pull
+	                                            : &g_mdcs->margo_stats->push;
+	if(ret == HG_SUCCESS) {
+		mdcs_counter_atomic_add(b->count, 1);
+		mdcs_counter_atomic_add(b->bytes, size);
+		mdcs_margo_stats_time(b->time, elapsed);
+	}
+	return ret;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_MARGO_STATS_H
+#define __MDCS_MARGO_STATS_H
+
+#include <abt.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * Counters of the bulk transfers in one direction.
+ */
+typedef struct {
+	mdcs_counter_t count; // number of transfers
+	mdcs_counter_t bytes; // number of bytes transferred
+	mdcs_counter_t time;  // duration of the transfers
+} mdcs_bulk_stats_t;
+
+/*
+ * Counters maintained by the Margo wrappers. Counts are atomic
+ * counters, the other counters are protected by the mutex.
+ */
+typedef struct mdcs_margo_stats_s {
+	ABT_mutex         mutex;        // protects the histograms and the gauge
+	mdcs_bulk_stats_t pull;         // transfers pulling remote data
+	mdcs_bulk_stats_t push;         // transfers pushing local data
+	mdcs_counter_t    forwards;     // number of forwarded RPCs
+	mdcs_counter_t    forward_time; // round-trip time of forwarded RPCs
+	mdcs_counter_t    handles;      // handles created and not yet destroyed
+	mdcs_counter_t    progress_lag; // delay of the progress pool probe's wake-ups
+}* mdcs_margo_stats_t;
+
+/**
+ * Registers the counters of the Margo wrappers.
+ */
+int mdcs_margo_stats_init();
+
+/**
+ * Frees the state of the Margo wrappers (the counters
+ * themselves are freed along with the other counters).
+ */
+void mdcs_margo_stats_finalize();
+
+/**
+ * Pushes a duration into one of the histograms of the Margo wrappers.
+ */
+void mdcs_margo_stats_time(mdcs_counter_t histogram, double seconds);
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include "mdcs-name-trie.h"
+
+typedef struct {
+	const char* start_after;   // names up to this one are skipped
+	size_t start_after_len;    // length of start_after
+	char* path;                // name corresponding to the current node
+	size_t path_len;           // length of the current name
+	size_t path_cap;           // capacity of the path buffer
+	mdcs_trie_visit_f fn;      // function to call on each counter
+	void* uarg;                // argument for fn
+} walk_context_t;
+
+static mdcs_trie_node_t node_create(const char* label, size_t len)
+{
+	mdcs_trie_node_t node = (mdcs_trie_node_t)calloc(1, sizeof(*node));
+	if(node == NULL) return NULL;
+	node->label = (char*)malloc(len+1);
+	if(node->label == NULL) {
+		free(node);
+		return NULL;
+	}
+	memcpy(node->label, label, len);
+	node->label[len] = '\0';
+	node->label_len = len;
+	return node;
+}
+
+/**
+ * Returns the index of the first child whose edge starts with a
+ * character greater or equal to c.
+ */
+static size_t child_lower_bound(mdcs_trie_node_t node, unsigned char c)
+{
+	size_t lo = 0, hi = node->num_children;
+	while(lo < hi) {
+		size_t mid = (lo + hi)/2;
+		if((unsigned char)(node->children[mid]->label[0]) < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int child_insert(mdcs_trie_node_t node, size_t idx, mdcs_trie_node_t child)
+{
+	if(node->num_children == node->max_children) {
+		size_t newcap = node->max_children ? 2*node->max_children : 2;
+		mdcs_trie_node_t* c = (mdcs_trie_node_t*)realloc(node->children,
+				newcap*sizeof(mdcs_trie_node_t));
+		if(c == NULL) return MDCS_ERROR;
+		node->children = c;
+		node->max_children = newcap;
+	}
+	memmove(node->children + idx + 1, node->children + idx,
+			(node->num_children - idx)*sizeof(mdcs_trie_node_t));
+	node->children[idx] = child;
+	node->num_children += 1;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_name_trie_insert(mdcs_trie_node_t* root, const char* name, mdcs_counter_t counter)
+{
+	if(*root == NULL) {
+		*root = node_create("", 0);
+		if(*root == NULL) return MDCS_ERROR;
+	}
+
+	mdcs_trie_node_t node = *root;
+	const char* p = name;
+
+	while(*p != '\0') {
+		size_t idx = child_lower_bound(node, (unsigned char)*p);
+
+		if(idx == node->num_children || node->children[idx]->label[0] != *p) {
+			mdcs_trie_node_t leaf = node_create(p, strlen(p));
+			if(leaf == NULL) return MDCS_ERROR;
+			leaf->counter = counter;
+			if(child_insert(node, idx, leaf) != MDCS_SUCCESS) {
+				mdcs_name_trie_free(leaf);
+				return MDCS_ERROR;
+			}
+			return MDCS_SUCCESS;
+		}
+
+		mdcs_trie_node_t child = node->children[idx];
+		size_t common = 0;
+		while(common < child->label_len && p[common] == child->label[common])
+			common += 1;
+
+		if(common < child->label_len) {
+			// split the edge: the common part goes to a new intermediate node
+			mdcs_trie_node_t mid = node_create(child->label, common);
+			if(mid == NULL) return MDCS_ERROR;
+			if(child_insert(mid, 0, child) != MDCS_SUCCESS) {
+				mdcs_name_trie_free(mid);
+				return MDCS_ERROR;
+			}
+			memmove(child->label, child->label + common, child->label_len - common + 1);
+			child->label_len -= common;
+			node->children[idx] = mid;
+			child = mid;
+		}
+
+		node = child;
+		p += common;
+	}
+
+	if(node->counter != NULL) return MDCS_ERROR;
+	node->counter = counter;
+	return MDCS_SUCCESS;
+}
+
+void mdcs_name_trie_remove(mdcs_trie_node_t root, const char* name)
+{
+	mdcs_trie_node_t node = root;
+	const char* p = name;
+
+	if(node == NULL) return;
+
+	while(*p != '\0') {
+		size_t idx = child_lower_bound(node, (unsigned char)*p);
+		if(idx == node->num_children) return;
+		mdcs_trie_node_t child = node->children[idx];
+		if(strncmp(child->label, p, child->label_len) != 0) return;
+		node = child;
+		p += child->label_len;
+	}
+
+	node->counter = NULL;
+}
+
+static int path_push(walk_context_t* ctx, const char* label, size_t len)
+{
+	if(ctx->path_len + len + 1 > ctx->path_cap) {
+		size_t newcap = ctx->path_cap ? ctx->path_cap : 64;
+		while(newcap < ctx->path_len + len + 1) newcap *= 2;
+		char* p = (char*)realloc(ctx->path, newcap);
+		if(p == NULL) return MDCS_ERROR;
+		ctx->path = p;
+		ctx->path_cap = newcap;
+	}
+	memcpy(ctx->path + ctx->path_len, label, len);
+	ctx->path_len += len;
+	ctx->path[ctx->path_len] = '\0';
+	return MDCS_SUCCESS;
+}
+
+/**
+ * Visits the subtree rooted at node, whose name is ctx->path.
+ * If after is set, all the names in the subtree are known to be
+ * greater than start_after. Returns non-zero to stop the traversal.
+ */
+static int visit(walk_context_t* ctx, mdcs_trie_node_t node, int after)
+{
+	int visit_self = after;
+	int children_after = after;
+
+	if(!after) {
+		size_t n = ctx->path_len < ctx->start_after_len ? ctx->path_len : ctx->start_after_len;
+		int c = memcmp(ctx->path, ctx->start_after, n);
+		if(c < 0) {
+			return 0; // the whole subtree comes before start_after
+		} else if(c > 0 || ctx->path_len > ctx->start_after_len) {
+			visit_self = children_after = 1;
+		} else if(ctx->path_len == ctx->start_after_len) {
+			children_after = 1; // only this node is not after start_after
+		}
+		// else the path is a strict prefix of start_after, children must be checked
+	}
+
+	if(visit_self && node->counter != NULL) {
+		if(ctx->fn(node->counter, ctx->uarg)) return 1;
+	}
+
+	size_t i;
+	size_t len = ctx->path_len;
+	for(i=0; i < node->num_children; i++) {
+		mdcs_trie_node_t child = node->children[i];
+		if(path_push(ctx, child->label, child->label_len) != MDCS_SUCCESS) return -1;
+		int r = visit(ctx, child, children_after);
+		ctx->path_len = len;
+		ctx->path[len] = '\0';
+		if(r) return r;
+	}
+	return 0;
+}
+
+int mdcs_name_trie_walk(mdcs_trie_node_t root, const char* prefix,
+		const char* start_after, mdcs_trie_visit_f fn, void* uarg)
+{
+	if(root == NULL) return MDCS_SUCCESS;
+
+	walk_context_t ctx = {
+		.start_after = start_after ? start_after : "",
+		.start_after_len = start_after ? strlen(start_after) : 0,
+		.path = NULL,
+		.path_len = 0,
+		.path_cap = 0,
+		.fn = fn,
+		.uarg = uarg
+	};
+	int ret = MDCS_SUCCESS;
+
+	if(path_push(&ctx, "", 0) != MDCS_SUCCESS) return MDCS_ERROR;
+
+	// descend to the node whose subtree holds all the names
+	// starting with the prefix (the prefix may end inside an edge)
+	mdcs_trie_node_t node = root;
+	const char* p = prefix ? prefix : "";
+	while(*p != '\0') {
+		size_t idx = child_lower_bound(node, (unsigned char)*p);
+		if(idx == node->num_children || node->children[idx]->label[0] != *p)
+			goto finish;
+		mdcs_trie_node_t child = node->children[idx];
+		size_t remaining = strlen(p);
+		size_t n = remaining < child->label_len ? remaining : child->label_len;
+		if(memcmp(child->label, p, n) != 0)
+			goto finish;
+		if(path_push(&ctx, child->label, child->label_len) != MDCS_SUCCESS) {
+			ret = MDCS_ERROR;
+			goto finish;
+		}
+		node = child;
+		p += n;
+	}
+
+	if(visit(&ctx, node, ctx.start_after_len == 0) < 0)
+		ret = MDCS_ERROR;
+
+finish:
+	free(ctx.path);
+	return ret;
+}
+
+void mdcs_name_trie_free(mdcs_trie_node_t root)
+{
+	if(root == NULL) return;
+	size_t i;
+	for(i=0; i < root->num_children; i++)
+		mdcs_name_trie_free(root->children[i]);
+	free(root->children);
+	free(root->label);
+	free(root);
+}
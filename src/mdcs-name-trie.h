@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_NAME_TRIE_H
+#define __MDCS_NAME_TRIE_H
+
+#include <stdlib.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * Radix trie indexing counters by name. Each edge carries a string
+ * of one or more characters, and the children of a node are kept
+ * sorted by the first character of their edge, so that a depth-first
+ * traversal visits names in lexicographic order.
+ */
+typedef struct mdcs_trie_node_s {
+	char*  label;                        // characters on the edge from the parent
+	size_t label_len;                    // number of characters on the edge
+	mdcs_counter_t counter;              // counter whose name ends here, if any
+	struct mdcs_trie_node_s** children;  // children sorted by first character
+	size_t num_children;                 // number of children
+	size_t max_children;                 // capacity of the children array
+}* mdcs_trie_node_t;
+
+/**
+ * Function called on each counter visited by mdcs_name_trie_walk.
+ * Returning a non-zero value stops the traversal.
+ */
+typedef int (*mdcs_trie_visit_f)(mdcs_counter_t counter, void* uarg);
+
+/**
+ * Inserts a counter in the trie under the provided name. The root
+ * is created if *root is NULL.
+ */
+int mdcs_name_trie_insert(mdcs_trie_node_t* root, const char* name, mdcs_counter_t counter);
+
+/**
+ * Removes the counter indexed under the provided name, if any. The
+ * nodes along the name are kept and reused by later insertions.
+ */
+void mdcs_name_trie_remove(mdcs_trie_node_t root, const char* name);
+
+/**
+ * Visits, in lexicographic order, the counters whose name starts
+ * with prefix and is strictly greater than start_after (which can
+ * be NULL or empty to start from the beginning). Subtrees that only
+ * contain names before start_after are skipped without being visited.
+ */
+int mdcs_name_trie_walk(mdcs_trie_node_t root, const char* prefix,
+		const char* start_after, mdcs_trie_visit_f fn, void* uarg);
+
+/**
+ * Frees the trie (but not the counters it points to).
+ */
+void mdcs_name_trie_free(mdcs_trie_node_t root);
+
+#endif
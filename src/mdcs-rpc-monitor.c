@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-margo.h>
+#include <mdcs/mdcs-timer.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter.h"
+#include "mdcs-rpc-monitor.h"
+#include "mdcs-error.h"
+
+/* maximum length of the names of the counters of an RPC */
+#define MDCS_RPC_MONITOR_NAME_MAX 256
+
+extern mdcs_t g_mdcs;
+
+/**
+ * Records the end of a call in the counters of its RPC.
+ * The call is returned to the free list if it is not NULL.
+ */
+static void rpc_monitor_end(mdcs_rpc_monitor_t m, mdcs_rpc_call_t* call,
+		double queue_time, double handler_time)
+{
+	int64_t decrement = -1;
+
+	ABT_mutex_lock(m->mutex);
+	mdcs_counter_push(m->inflight, &decrement);
+	if(call != NULL) {
+		mdcs_counter_push(m->queue_time, &queue_time);
+		mdcs_counter_push(m->handler_time, &handler_time);
+		call->next = m->free_calls;
+		m->free_calls = call;
+	}
+	ABT_mutex_unlock(m->mutex);
+
+	// last access to the monitor, which may be freed past this point
+	__atomic_sub_fetch(&m->running, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * ULT running the handler of a timed call.
+ */
+static void rpc_monitor_ult(void* arg)
+{
+	mdcs_rpc_call_t* call = (mdcs_rpc_call_t*)arg;
+	mdcs_rpc_monitor_t m = call->monitor;
+	double spt = mdcs_timer_source.seconds_per_tick;
+
+	uint64_t start = mdcs_timer_ticks();
+	m->handler(call->handle);
+	uint64_t end = mdcs_timer_ticks();
+
+	rpc_monitor_end(m, call, (double)(start - call->arrival)*spt,
+			(double)(end - start)*spt);
+}
+
+/**
+ * ULT running the handler of a call that could not be timed
+ * because all the preallocated calls were in use. Its call
+ * was allocated by the dispatcher.
+ */
+static void rpc_monitor_untimed_ult(void* arg)
+{
+	mdcs_rpc_call_t* call = (mdcs_rpc_call_t*)arg;
+	mdcs_rpc_monitor_t m = call->monitor;
+	hg_handle_t handle = call->handle;
+	free(call);
+
+	m->handler(handle);
+
+	rpc_monitor_end(m, NULL, 0.0, 0.0);
+}
+
+/**
+ * Completes a call that cannot be handled. An empty response makes
+ * the caller's request fail instead of waiting forever.
+ */
+static hg_return_t rpc_monitor_reject(hg_handle_t handle, hg_return_t ret)
+{
+	margo_respond(handle, NULL);
+	margo_destroy(handle);
+	return ret;
+}
+
+/**
+ * Mercury callback of all the instrumented RPCs. It looks up the
+ * monitor of the RPC and starts a ULT running the RPC's handler.
+ */
+static hg_return_t rpc_monitor_dispatch(hg_handle_t handle)
+{
+	uint64_t arrival = mdcs_timer_ticks();
+	int64_t increment = 1;
+	int ret;
+
+	margo_instance_id mid = margo_hg_handle_get_instance(handle);
+	if(mid == MARGO_INSTANCE_NULL) return rpc_monitor_reject(handle, HG_OTHER_ERROR);
+
+	const struct hg_info* info = margo_get_info(handle);
+	if(info == NULL) return rpc_monitor_reject(handle, HG_OTHER_ERROR);
+
+	mdcs_rpc_monitor_t m = (mdcs_rpc_monitor_t)margo_registered_data(mid, info->id);
+	if(m == NULL) return rpc_monitor_reject(handle, HG_OTHER_ERROR);
+
+	// the monitor is not freed while it has calls running
+	__atomic_add_fetch(&m->running, 1, __ATOMIC_ACQUIRE);
+
+	mdcs_counter_atomic_add(m->calls, 1);
+
+	ABT_mutex_lock(m->mutex);
+	mdcs_counter_push(m->inflight, &increment);
+	mdcs_rpc_call_t* call = m->free_calls;
+	if(call != NULL) m->free_calls = call->next;
+	ABT_mutex_unlock(m->mutex);
+
+	if(call != NULL) {
+		call->handle = handle;
+		call->arrival = arrival;
+		ret = ABT_thread_create(m->pool, rpc_monitor_ult, call,
+				ABT_THREAD_ATTR_NULL, NULL);
+		if(ret != ABT_SUCCESS) {
+			ABT_mutex_lock(m->mutex);
+			call->next = m->free_calls;
+			m->free_calls = call;
+			ABT_mutex_unlock(m->mutex);
+		}
+	} else {
+		call = (mdcs_rpc_call_t*)malloc(sizeof(*call));
+		if(call == NULL) {
+			MDCS_PRINT_ERROR("Could not allocate memory for RPC call");
+			rpc_monitor_end(m, NULL, 0.0, 0.0);
+			return rpc_monitor_reject(handle, HG_NOMEM_ERROR);
+		}
+		call->monitor = m;
+		call->handle = handle;
+		ret = ABT_thread_create(m->pool, rpc_monitor_untimed_ult, call,
+				ABT_THREAD_ATTR_NULL, NULL);
+		if(ret != ABT_SUCCESS) free(call);
+	}
+
+	if(ret != ABT_SUCCESS) {
+		rpc_monitor_end(m, NULL, 0.0, 0.0);
+		return rpc_monitor_reject(handle, HG_NOMEM_ERROR);
+	}
+
+	return HG_SUCCESS;
+}
+
+/**
+ * Registers a counter named "rpc:<rpc_name>:<suffix>".
+ */
+static int rpc_monitor_counter(const char* rpc_name, const char* suffix,
+		mdcs_counter_type_t type, mdcs_counter_t* counter)
+{
+	char name[MDCS_RPC_MONITOR_NAME_MAX];
+	int n = snprintf(name, sizeof(name), "rpc:%s:%s", rpc_name, suffix);
+	if(n < 0 || (size_t)n >= sizeof(name)) {
+		MDCS_PRINT_ERROR("RPC name is too long");
+		return MDCS_ERROR;
+	}
+	return mdcs_counter_register(name, type, 0, counter);
+}
+
+hg_id_t mdcs_rpc_register(margo_instance_id mid, const char* name,
+		hg_proc_cb_t in_proc, hg_proc_cb_t out_proc, hg_rpc_cb_t handler,
+		uint16_t provider_id, ABT_pool pool)
+{
+	char rpc_name[MDCS_RPC_MONITOR_NAME_MAX];
+	size_t i;
+	int ret;
+
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return 0;
+	}
+
+	if(provider_id == MARGO_DEFAULT_PROVIDER_ID)
+		ret = snprintf(rpc_name, sizeof(rpc_name), "%s", name);
+	else
+		ret = snprintf(rpc_name, sizeof(rpc_name), "%s@%u", name, (unsigned)provider_id);
+	if(ret < 0 || (size_t)ret >= sizeof(rpc_name)) {
+		MDCS_PRINT_ERROR("RPC name is too long");
+		return 0;
+	}
+
+	mdcs_rpc_monitor_t m = (mdcs_rpc_monitor_t)calloc(1, sizeof(*m));
+	if(m == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for RPC monitor");
+		return 0;
+	}
+	m->mutex = ABT_MUTEX_NULL;
+
+	if(ABT_mutex_create(&m->mutex) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create RPC monitor mutex");
+		m->mutex = ABT_MUTEX_NULL;
+		goto error;
+	}
+
+	if(rpc_monitor_counter(rpc_name, "calls", MDCS_COUNTER_ATOMIC, &m->calls) != MDCS_SUCCESS
+	|| rpc_monitor_counter(rpc_name, "inflight", MDCS_COUNTER_GAUGE, &m->inflight) != MDCS_SUCCESS
+	|| rpc_monitor_counter(rpc_name, "queue_time", MDCS_COUNTER_HISTOGRAM, &m->queue_time) != MDCS_SUCCESS
+	|| rpc_monitor_counter(rpc_name, "handler_time", MDCS_COUNTER_HISTOGRAM, &m->handler_time) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not register RPC counters");
+		goto error;
+	}
+
+	if(pool == ABT_POOL_NULL)
+		margo_get_handler_pool(mid, &pool);
+
+	for(i=0; i < MDCS_RPC_MONITOR_MAX_CALLS; i++) {
+		m->call_storage[i].monitor = m;
+		m->call_storage[i].next = (i+1 < MDCS_RPC_MONITOR_MAX_CALLS) ? &m->call_storage[i+1] : NULL;
+	}
+	m->free_calls = &m->call_storage[0];
+	m->mid = mid;
+	m->handler = handler;
+	m->pool = pool;
+
+	m->id = margo_register_name_provider(mid, name, in_proc, out_proc,
+			rpc_monitor_dispatch, provider_id, pool);
+	if(m->id == 0) {
+		MDCS_PRINT_ERROR("Could not register RPC");
+		goto error;
+	}
+
+	if(margo_register_data(mid, m->id, m, NULL) != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not attach monitor to RPC");
+		margo_deregister(mid, m->id);
+		goto error;
+	}
+
+	m->next = g_mdcs->rpc_monitors;
+	g_mdcs->rpc_monitors = m;
+
+	return m->id;
+
+error:
+	mdcs_counter_unregister(m->calls);
+	mdcs_counter_unregister(m->inflight);
+	mdcs_counter_unregister(m->queue_time);
+	mdcs_counter_unregister(m->handler_time);
+	if(m->mutex != ABT_MUTEX_NULL) ABT_mutex_free(&m->mutex);
+	free(m);
+	return 0;
+}
+
+/**
+ * Waits until the progress loop of a Margo instance has gone through
+ * a full iteration. Timers are fired by the progress loop in between
+ * the Mercury callbacks it triggers, so once two sleeps in a row have
+ * completed, any callback that was running when the first one started
+ * has returned.
+ */
+static void rpc_monitor_wait_progress(margo_instance_id mid)
+{
+	margo_thread_sleep(mid, 1.0);
+	margo_thread_sleep(mid, 1.0);
+}
+
+void mdcs_rpc_monitors_finalize()
+{
+	mdcs_rpc_monitor_t m, prev;
+
+	// no call of the instrumented RPCs is dispatched past this point
+	for(m = g_mdcs->rpc_monitors; m != NULL; m = m->next)
+		margo_deregister(m->mid, m->id);
+
+	// a dispatch that looked up its monitor before the deregistration
+	// may not have counted itself in m->running yet: let it return
+	for(m = g_mdcs->rpc_monitors; m != NULL; m = m->next) {
+		for(prev = g_mdcs->rpc_monitors; prev != m && prev->mid != m->mid; prev = prev->next);
+		if(prev == m) rpc_monitor_wait_progress(m->mid);
+	}
+
+	m = g_mdcs->rpc_monitors;
+	while(m != NULL) {
+		mdcs_rpc_monitor_t next = m->next;
+		// wait for the handlers still running to release the monitor
+		while(__atomic_load_n(&m->running, __ATOMIC_ACQUIRE) != 0)
+			ABT_thread_yield();
+		ABT_mutex_free(&m->mutex);
+		free(m);
+		m = next;
+	}
+	g_mdcs->rpc_monitors = NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_RPC_MONITOR_H
+#define __MDCS_RPC_MONITOR_H
+
+#include <stdint.h>
+#include <margo.h>
+#include <mdcs/mdcs.h>
+
+/* number of calls of a given RPC that can be timed concurrently,
+ * additional calls are only counted */
+#define MDCS_RPC_MONITOR_MAX_CALLS 64
+
+struct mdcs_rpc_monitor_s;
+
+/*
+ * Call of an instrumented RPC, from its arrival to the end of its handler.
+ */
+typedef struct mdcs_rpc_call_s {
+	struct mdcs_rpc_monitor_s* monitor; // monitor of the RPC
+	hg_handle_t                handle;  // handle of the call
+	uint64_t                   arrival; // timestamp of the arrival of the call
+	struct mdcs_rpc_call_s*    next;    // next free call
+} mdcs_rpc_call_t;
+
+/*
+ * Instrumentation of an RPC registered with mdcs_rpc_register.
+ * The calls are preallocated with the monitor and kept in a free list.
+ */
+typedef struct mdcs_rpc_monitor_s {
+	hg_id_t          id;           // id of the RPC
+	margo_instance_id mid;         // Margo instance the RPC is registered with
+	hg_rpc_cb_t      handler;      // function handling the RPC
+	ABT_pool         pool;         // pool in which to run the handler
+	ABT_mutex        mutex;        // protects the free list and the counters
+	mdcs_counter_t   calls;        // number of calls
+	mdcs_counter_t   inflight;     // number of calls being handled
+	mdcs_counter_t   queue_time;   // time between arrival and start of the handler
+	mdcs_counter_t   handler_time; // duration of the handler
+	mdcs_rpc_call_t* free_calls;   // calls available for timing
+	uint64_t         running;      // number of calls dispatched and not yet ended
+	struct mdcs_rpc_monitor_s* next; // next monitor
+	mdcs_rpc_call_t  call_storage[MDCS_RPC_MONITOR_MAX_CALLS];
+}* mdcs_rpc_monitor_t;
+
+/**
+ * Deregisters the instrumented RPCs, waits for the dispatches and
+ * the handlers that are still running, and frees all the RPC monitors.
+ * The Margo instances of the RPCs must still be running.
+ */
+void mdcs_rpc_monitors_finalize();
+
+#endif
@@ -6,22 +6,177 @@
 #ifndef __MDCS_RPC_TYPES_H
 #define __MDCS_RPC_TYPES_H
 
+#include <stdlib.h>
 #include <mercury.h>
 #include <mercury_bulk.h>
 #include <mercury_types.h>
 #include <mercury_proc_string.h>
 #include <mercury_macros.h>
 
+/*
+ * Variable-size byte buffer sent inline with an RPC. When decoded,
+ * the data is allocated and released again by margo_free_input
+ * or margo_free_output.
+ */
+typedef struct {
+	uint64_t size;
+	void*    data;
+} mdcs_raw_t;
+
+static inline hg_return_t hg_proc_mdcs_raw_t(hg_proc_t proc, void* arg)
+{
+	hg_return_t ret;
+	mdcs_raw_t* raw = (mdcs_raw_t*)arg;
+
+	ret = hg_proc_hg_uint64_t(proc, &raw->size);
+	if(ret != HG_SUCCESS || raw->size == 0)
+		return ret;
+
+	switch(hg_proc_get_op(proc)) {
+	case HG_DECODE:
+		raw->data = malloc(raw->size);
+		if(raw->data == NULL)
+			return HG_NOMEM_ERROR;
+		ret = hg_proc_raw(proc, raw->data, raw->size);
+		break;
+	case HG_ENCODE:
+		ret = hg_proc_raw(proc, raw->data, raw->size);
+		break;
+	case HG_FREE:
+		free(raw->data);
+		raw->data = NULL;
+		break;
+	}
+	return ret;
+}
+
+/*
+ * num_slots set to 0 fetches the whole counter (all the slots
+ * starting from first_slot in the case of a vector counter).
+ * max_exemplars set to 0 does not request any exemplar.
+ */
 MERCURY_GEN_PROC(fetch_counter_in_t,
     ((uint64_t)(counter_id))\
 	((uint64_t)(size))\
+	((uint64_t)(first_slot))\
+	((uint64_t)(num_slots))\
+	((uint64_t)(max_exemplars))\
     ((hg_bulk_t)(bulk_handle)))
 
-MERCURY_GEN_PROC(fetch_counter_out_t, ((int32_t)(ret)))
+/*
+ * The value size and type id of the counter are returned even if the
+ * fetch fails, so that a client can recover from a size mismatch.
+ * Exemplars are packed as an array of mdcs_exemplar_t, largest first.
+ */
+MERCURY_GEN_PROC(fetch_counter_out_t,
+	((int32_t)(ret))\
+	((uint64_t)(value_size))\
+	((uint64_t)(type_id))\
+	((mdcs_raw_t)(exemplars)))
 
 MERCURY_GEN_PROC(reset_counter_in_t,
 	((uint64_t)(counter_id)))
 
 MERCURY_GEN_PROC(reset_counter_out_t, ((int32_t)(ret)))
 
+MERCURY_GEN_PROC(push_counter_in_t,
+	((uint64_t)(counter_id))\
+	((uint64_t)(item_size))\
+	((uint64_t)(num_items))\
+	((mdcs_raw_t)(items))\
+	((hg_bulk_t)(bulk_handle)))
+
+MERCURY_GEN_PROC(push_counter_out_t, ((int32_t)(ret)))
+
+/*
+ * The selector of an aggregation is packed as one entry per label:
+ * a byte set to 0 for "any value", or set to 1 and followed by the
+ * null-terminated label value.
+ */
+MERCURY_GEN_PROC(aggregate_family_in_t,
+	((uint64_t)(family_id))\
+	((uint64_t)(size))\
+	((mdcs_raw_t)(selector))\
+	((hg_bulk_t)(bulk_handle)))
+
+MERCURY_GEN_PROC(aggregate_family_out_t, ((int32_t)(ret)))
+
+/*
+ * The entries of a counter listing are packed one after the other,
+ * each entry being an mdcs_list_entry_t followed by the null-terminated
+ * name of the counter (entries are therefore not aligned).
+ */
+typedef struct {
+	uint64_t id;
+	uint64_t type_id;
+	uint64_t item_size;
+	uint64_t value_size;
+	uint64_t num_slots;
+} mdcs_list_entry_t;
+
+MERCURY_GEN_PROC(list_counters_in_t,
+	((hg_string_t)(pattern))\
+	((hg_string_t)(start_after))\
+	((uint64_t)(max_entries)))
+
+MERCURY_GEN_PROC(list_counters_out_t,
+	((int32_t)(ret))\
+	((uint64_t)(num_entries))\
+	((uint32_t)(more))\
+	((mdcs_raw_t)(entries)))
+
+/*
+ * A schema is packed as an mdcs_schema_header_t followed by the
+ * null-terminated type name, then, for each field, an
+ * mdcs_schema_field_entry_t followed by the null-terminated field name.
+ */
+typedef struct {
+	uint64_t type_id;
+	uint64_t item_size;
+	uint64_t value_size;
+	uint64_t num_fields;
+} mdcs_schema_header_t;
+
+typedef struct {
+	uint64_t offset;
+	uint64_t count;
+	uint32_t type;
+	uint32_t reserved;
+} mdcs_schema_field_entry_t;
+
+MERCURY_GEN_PROC(get_type_schema_in_t,
+	((uint64_t)(type_id)))
+
+MERCURY_GEN_PROC(get_type_schema_out_t,
+	((int32_t)(ret))\
+	((mdcs_raw_t)(schema)))
+
+/*
+ * Doubles are sent in the host's representation.
+ */
+typedef double mdcs_double_t;
+
+static inline hg_return_t hg_proc_mdcs_double_t(hg_proc_t proc, void* arg)
+{
+	return hg_proc_raw(proc, arg, sizeof(mdcs_double_t));
+}
+
+/*
+ * The predicate of a watch is sent field by field. The value of
+ * the counter is returned inline along with the outcome of the watch.
+ */
+MERCURY_GEN_PROC(watch_counter_in_t,
+	((uint64_t)(counter_id))\
+	((uint32_t)(op))\
+	((uint32_t)(field_type))\
+	((uint64_t)(field_offset))\
+	((mdcs_double_t)(threshold))\
+	((mdcs_double_t)(timeout))\
+	((uint64_t)(size)))
+
+MERCURY_GEN_PROC(watch_counter_out_t,
+	((int32_t)(ret))\
+	((uint32_t)(fired))\
+	((mdcs_raw_t)(value)))
+
 #endif
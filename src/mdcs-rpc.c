@@ -3,18 +3,33 @@
  *
  * See COPYRIGHT in top-level directory.
  */
+#include <string.h>
+#include <fnmatch.h>
 #include <mdcs/mdcs.h>
+#include <mdcs/mdcs-margo.h>
+#include <mdcs/mdcs-timer.h>
 #include "mdcs-rpc.h"
 #include "mdcs-rpc-types.h"
 #include "mdcs-global-data.h"
 #include "mdcs-error.h"
 #include "mdcs-counter-type.h"
 #include "mdcs-counter.h"
+#include "mdcs-counter-family.h"
+#include "mdcs-name-trie.h"
+#include "mdcs-counter-schema.h"
+#include "mdcs-counter-watch.h"
+#include "mdcs-self-stats.h"
+
+/* maximum number of entries returned by a single listing */
+#define MDCS_LIST_MAX_ENTRIES 1024
+/* maximum size, in bytes, of a batch of items pushed by a client */
+#define MDCS_PUSH_MAX_SIZE (64*1024*1024)
 
 extern mdcs_t g_mdcs;
 
 hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 {
+	mdcs_timer_t timer = mdcs_timer_start();
 	hg_return_t result = HG_SUCCESS;
 	int ret = HG_SUCCESS;
 	const struct hg_info* info = NULL;
@@ -22,14 +37,21 @@ hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 	fetch_counter_in_t in = {
 		.counter_id = 0,
 		.size = 0,
+		.first_slot = 0,
+		.num_slots = 0,
+		.max_exemplars = 0,
 		.bulk_handle = HG_BULK_NULL
 	};
 	fetch_counter_out_t out = {
-		.ret = MDCS_SUCCESS
+		.ret = MDCS_SUCCESS,
+		.value_size = 0,
+		.type_id = 0,
+		.exemplars = { 0, NULL }
 	};
 	mdcs_counter_t counter = MDCS_COUNTER_NULL;
 	hg_bulk_t bulk_handle = HG_BULK_NULL;
 	void* buffer = NULL;
+	size_t sent = 0;
 
 	mid = margo_hg_handle_get_instance(handle);
 	if(MARGO_INSTANCE_NULL == mid) {
@@ -59,7 +81,30 @@ hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 
 	} else {
 
-		if(in.size != counter->t->counter_value_size) {
+		size_t first = in.first_slot;
+		size_t count = in.num_slots;
+
+		out.value_size = counter->t->counter_value_size;
+		out.type_id = counter->t->schema.type_id;
+
+		if(counter->num_slots == 0) {
+			if(first != 0 || count > 1) {
+				MDCS_PRINT_ERROR("Slot range requested on a scalar counter");
+				out.ret = MDCS_ERROR;
+				goto respond;
+			}
+			count = 1;
+		} else {
+			if(first >= counter->num_slots
+			|| count > counter->num_slots - first) {
+				MDCS_PRINT_ERROR("Slot range out of bounds");
+				out.ret = MDCS_ERROR;
+				goto respond;
+			}
+			if(count == 0) count = counter->num_slots - first;
+		}
+
+		if(in.size != count * counter->t->counter_value_size) {
 			MDCS_PRINT_ERROR("Incorrect buffer size provided by client");
 			result = HG_OTHER_ERROR;
 			out.ret = MDCS_ERROR;
@@ -73,7 +118,10 @@ hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 			goto cleanup;
 		}
 
-		ret = mdcs_counter_value(counter, buffer);
+		if(counter->num_slots == 0)
+			ret = mdcs_counter_value(counter, buffer);
+		else
+			ret = mdcs_counter_vector_value(counter, first, count, buffer);
 		if(ret != MDCS_SUCCESS) {
 			MDCS_PRINT_ERROR("Could not get counter value");
 			result = HG_OTHER_ERROR;
@@ -88,7 +136,7 @@ hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 			goto cleanup;
 		}
 
-    	ret = margo_bulk_transfer(mid, HG_BULK_PUSH,
+    	ret = mdcs_margo_bulk_transfer(mid, HG_BULK_PUSH,
 				info->addr, in.bulk_handle, 0,
 				bulk_handle, 0, in.size);
 		if(ret != HG_SUCCESS) {
@@ -96,6 +144,20 @@ hg_return_t mdcs_rpc_get_counter(hg_handle_t handle)
 			result = ret;
 			goto cleanup;
 		}
+		sent = in.size;
+
+		if(in.max_exemplars != 0 && counter->exemplars != NULL) {
+			size_t max = counter->exemplars->num_current + counter->exemplars->num_previous;
+			if(max > in.max_exemplars) max = in.max_exemplars;
+			out.exemplars.data = malloc(max*sizeof(mdcs_exemplar_t));
+			if(out.exemplars.data == NULL && max != 0) {
+				MDCS_PRINT_ERROR("Could not allocate exemplars");
+				result = HG_OTHER_ERROR;
+				goto cleanup;
+			}
+			out.exemplars.size = sizeof(mdcs_exemplar_t)
+				* mdcs_exemplars_collect(counter->exemplars, out.exemplars.data, max);
+		}
 	}
 
 respond:
@@ -106,9 +168,12 @@ respond:
 		goto cleanup;
 	}
 
+	mdcs_self_stats_rpc(MDCS_SELF_FETCH, 0, sent + out.exemplars.size);
+
 cleanup:
 
 	free(buffer);
+	free(out.exemplars.data);
 
 	ret = margo_free_input(handle, &in);
 	if(ret != HG_SUCCESS) {
@@ -128,6 +193,8 @@ cleanup:
 		result = ret;
 	}
 
+	mdcs_self_stats_fetch_time(mdcs_timer_elapsed(timer));
+
 	return result;
 }
 DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_get_counter)
@@ -145,6 +212,13 @@ hg_return_t mdcs_rpc_reset_counter(hg_handle_t handle)
 	
 	mdcs_counter_t counter = MDCS_COUNTER_NULL;
 
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
 	ret = mdcs_counter_find_by_id(in.counter_id, &counter);
 
 	if(ret == MDCS_SUCCESS)
@@ -159,6 +233,8 @@ hg_return_t mdcs_rpc_reset_counter(hg_handle_t handle)
 		goto cleanup;
 	}
 
+	mdcs_self_stats_rpc(MDCS_SELF_RESET, 0, 0);
+
 cleanup:
 
 	ret = margo_free_input(handle, &in);
@@ -176,3 +252,591 @@ cleanup:
 	return result;
 }
 DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_reset_counter)
+
+hg_return_t mdcs_rpc_push_counter(hg_handle_t handle)
+{
+	hg_return_t result = HG_SUCCESS;
+	int ret = HG_SUCCESS;
+	const struct hg_info* info = NULL;
+	margo_instance_id mid = MARGO_INSTANCE_NULL;
+	push_counter_in_t in = {
+		.counter_id = 0,
+		.item_size = 0,
+		.num_items = 0,
+		.items = { .size = 0, .data = NULL },
+		.bulk_handle = HG_BULK_NULL
+	};
+	push_counter_out_t out = {
+		.ret = MDCS_SUCCESS
+	};
+	mdcs_counter_t counter = MDCS_COUNTER_NULL;
+	hg_bulk_t bulk_handle = HG_BULK_NULL;
+	hg_size_t size = 0;
+	void* buffer = NULL;
+	const void* items = NULL;
+
+	mid = margo_hg_handle_get_instance(handle);
+	if(MARGO_INSTANCE_NULL == mid) {
+		MDCS_PRINT_ERROR("Could not get a valid Margo instance");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	info = margo_get_info(handle);
+	if(!info) {
+		MDCS_PRINT_ERROR("Could not get info from handle");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
+	ret = mdcs_counter_find_by_id(in.counter_id, &counter);
+	if(ret == MDCS_ERROR) {
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	if(in.item_size != counter->t->counter_item_size) {
+		MDCS_PRINT_ERROR("Incorrect item size provided by client");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	if(in.item_size == 0 || in.num_items > MDCS_PUSH_MAX_SIZE / in.item_size) {
+		MDCS_PRINT_ERROR("Batch of items provided by client is too large");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	size = in.num_items * in.item_size;
+
+	if(in.bulk_handle == HG_BULK_NULL) {
+
+		if(in.items.size != size) {
+			MDCS_PRINT_ERROR("Inline items do not match the announced size");
+			out.ret = MDCS_ERROR;
+			goto respond;
+		}
+		items = in.items.data;
+
+	} else {
+
+		buffer = malloc(size);
+		if(buffer == NULL) {
+			MDCS_PRINT_ERROR("Could not allocate buffer");
+			out.ret = MDCS_ERROR;
+			goto respond;
+		}
+
+		ret = margo_bulk_create(mid, 1, &buffer,
+				&size, HG_BULK_WRITE_ONLY, &bulk_handle);
+		if(ret != HG_SUCCESS) {
+			MDCS_PRINT_ERROR("Could not create bulk handle");
+			bulk_handle = HG_BULK_NULL;
+			out.ret = MDCS_ERROR;
+			goto respond;
+		}
+
+		ret = mdcs_margo_bulk_transfer(mid, HG_BULK_PULL,
+				info->addr, in.bulk_handle, 0,
+				bulk_handle, 0, size);
+		if(ret != HG_SUCCESS) {
+			MDCS_PRINT_ERROR("Could not issue bulk transfer");
+			out.ret = MDCS_ERROR;
+			goto respond;
+		}
+		items = buffer;
+	}
+
+	out.ret = mdcs_counter_push_multi(counter, items, in.num_items);
+
+respond:
+	ret = margo_respond(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not respond to RPC");
+		result = ret;
+		goto cleanup;
+	}
+
+	mdcs_self_stats_rpc(MDCS_SELF_PUSH, out.ret == MDCS_SUCCESS ? size : 0, 0);
+
+cleanup:
+
+	free(buffer);
+
+	ret = margo_free_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free input");
+		result = ret;
+	}
+
+	ret = margo_bulk_free(bulk_handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free bulk handle");
+		result = ret;
+	}
+
+	ret = margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+		result = ret;
+	}
+
+	return result;
+}
+DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_push_counter)
+
+/**
+ * Unpacks an aggregation selector (see aggregate_family_in_t).
+ * The returned strings point into the raw buffer.
+ */
+static int unpack_selector(const mdcs_raw_t* raw, size_t num_labels, const char** values)
+{
+	const char* p = raw->data;
+	const char* end = p + raw->size;
+	size_t i;
+
+	for(i=0; i < num_labels; i++) {
+		if(p >= end) return MDCS_ERROR;
+		if(*p++ == 0) {
+			values[i] = NULL;
+			continue;
+		}
+		const char* eos = memchr(p, '\0', end - p);
+		if(eos == NULL) return MDCS_ERROR;
+		values[i] = p;
+		p = eos + 1;
+	}
+	return p == end ? MDCS_SUCCESS : MDCS_ERROR;
+}
+
+hg_return_t mdcs_rpc_aggregate_family(hg_handle_t handle)
+{
+	hg_return_t result = HG_SUCCESS;
+	int ret = HG_SUCCESS;
+	const struct hg_info* info = NULL;
+	margo_instance_id mid = MARGO_INSTANCE_NULL;
+	aggregate_family_in_t in = {
+		.family_id = 0,
+		.size = 0,
+		.selector = { .size = 0, .data = NULL },
+		.bulk_handle = HG_BULK_NULL
+	};
+	aggregate_family_out_t out = {
+		.ret = MDCS_SUCCESS
+	};
+	mdcs_counter_family_t family = MDCS_COUNTER_FAMILY_NULL;
+	hg_bulk_t bulk_handle = HG_BULK_NULL;
+	const char** selector = NULL;
+	void* buffer = NULL;
+
+	mid = margo_hg_handle_get_instance(handle);
+	if(MARGO_INSTANCE_NULL == mid) {
+		MDCS_PRINT_ERROR("Could not get a valid Margo instance");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	info = margo_get_info(handle);
+	if(!info) {
+		MDCS_PRINT_ERROR("Could not get info from handle");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
+	ret = mdcs_counter_family_find_by_id(in.family_id, &family);
+	if(ret == MDCS_ERROR) {
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	if(in.size != family->t->counter_value_size) {
+		MDCS_PRINT_ERROR("Incorrect buffer size provided by client");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	selector = (const char**)calloc(family->num_labels, sizeof(const char*));
+	buffer = calloc(1, in.size);
+	if(selector == NULL || buffer == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate buffer");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	ret = unpack_selector(&in.selector, family->num_labels, selector);
+	if(ret != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Invalid label selector provided by client");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	ret = mdcs_counter_family_aggregate(family, selector, buffer);
+	if(ret != MDCS_SUCCESS) {
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	ret = margo_bulk_create(mid, 1, &buffer,
+			&in.size, HG_BULK_READ_ONLY, &bulk_handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create bulk handle");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	ret = mdcs_margo_bulk_transfer(mid, HG_BULK_PUSH,
+			info->addr, in.bulk_handle, 0,
+			bulk_handle, 0, in.size);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not issue bulk transfer");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+respond:
+	ret = margo_respond(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not respond to RPC");
+		result = ret;
+		goto cleanup;
+	}
+
+	mdcs_self_stats_rpc(MDCS_SELF_AGGREGATE, 0, out.ret == MDCS_SUCCESS ? in.size : 0);
+
+cleanup:
+
+	free(buffer);
+	free(selector);
+
+	ret = margo_free_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free input");
+		result = ret;
+	}
+
+	ret = margo_bulk_free(bulk_handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free bulk handle");
+		result = ret;
+	}
+
+	ret = margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+		result = ret;
+	}
+
+	return result;
+}
+DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_aggregate_family)
+
+typedef struct {
+	const char* pattern;  // glob pattern, NULL if listing by prefix only
+	size_t max_entries;   // maximum number of entries to return
+	size_t num_entries;   // number of entries packed so far
+	int more;             // set if entries remain after the last one
+	char* buf;            // packed entries
+	size_t size;          // size of the packed entries
+	size_t capacity;      // capacity of buf
+} list_context_t;
+
+static int list_visit(mdcs_counter_t counter, void* uarg)
+{
+	list_context_t* ctx = (list_context_t*)uarg;
+
+	if(ctx->pattern && fnmatch(ctx->pattern, counter->name, 0) != 0)
+		return 0;
+
+	if(ctx->num_entries == ctx->max_entries) {
+		ctx->more = 1;
+		return 1;
+	}
+
+	size_t namelen = strlen(counter->name) + 1;
+	size_t needed = ctx->size + sizeof(mdcs_list_entry_t) + namelen;
+	if(needed > ctx->capacity) {
+		size_t newcap = ctx->capacity ? 2*ctx->capacity : 4096;
+		while(newcap < needed) newcap *= 2;
+		char* b = (char*)realloc(ctx->buf, newcap);
+		if(b == NULL) return -1;
+		ctx->buf = b;
+		ctx->capacity = newcap;
+	}
+
+	mdcs_list_entry_t entry = {
+		.id = counter->id,
+		.type_id = counter->t->schema.type_id,
+		.item_size = counter->t->counter_item_size,
+		.value_size = counter->t->counter_value_size,
+		.num_slots = counter->num_slots
+	};
+	memcpy(ctx->buf + ctx->size, &entry, sizeof(entry));
+	memcpy(ctx->buf + ctx->size + sizeof(entry), counter->name, namelen);
+	ctx->size = needed;
+	ctx->num_entries += 1;
+	return 0;
+}
+
+hg_return_t mdcs_rpc_list_counters(hg_handle_t handle)
+{
+	hg_return_t result = HG_SUCCESS;
+	int ret = HG_SUCCESS;
+	list_counters_in_t in = {
+		.pattern = NULL,
+		.start_after = NULL,
+		.max_entries = 0
+	};
+	list_counters_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.num_entries = 0,
+		.more = 0,
+		.entries = { .size = 0, .data = NULL }
+	};
+	list_context_t ctx = {
+		.pattern = NULL,
+		.max_entries = 0,
+		.num_entries = 0,
+		.more = 0,
+		.buf = NULL,
+		.size = 0,
+		.capacity = 0
+	};
+	char* prefix = NULL;
+
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
+	const char* pattern = in.pattern ? in.pattern : "";
+
+	// the part of the pattern before the first wildcard is a literal
+	// prefix used to restrict the traversal of the name trie
+	size_t prefix_len = strcspn(pattern, "*?[\\");
+	prefix = strndup(pattern, prefix_len);
+	if(prefix == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate prefix");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	ctx.pattern = pattern[prefix_len] != '\0' ? pattern : NULL;
+	ctx.max_entries = in.max_entries;
+	if(ctx.max_entries == 0 || ctx.max_entries > MDCS_LIST_MAX_ENTRIES)
+		ctx.max_entries = MDCS_LIST_MAX_ENTRIES;
+
+	ret = mdcs_name_trie_walk(g_mdcs->counter_trie, prefix,
+			in.start_after, list_visit, &ctx);
+	if(ret != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not list counters");
+		out.ret = MDCS_ERROR;
+	} else {
+		out.num_entries = ctx.num_entries;
+		out.more = ctx.more;
+		out.entries.size = ctx.size;
+		out.entries.data = ctx.buf;
+	}
+
+	ret = margo_respond(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not respond to RPC");
+		result = ret;
+		goto cleanup;
+	}
+
+	mdcs_self_stats_rpc(MDCS_SELF_LIST, 0, out.entries.size);
+
+cleanup:
+
+	free(prefix);
+	free(ctx.buf);
+
+	ret = margo_free_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free input");
+		result = ret;
+	}
+
+	ret = margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+		result = ret;
+	}
+
+	return result;
+}
+DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_list_counters)
+
+hg_return_t mdcs_rpc_get_type_schema(hg_handle_t handle)
+{
+	hg_return_t result = HG_SUCCESS;
+	int ret = HG_SUCCESS;
+	get_type_schema_in_t in = {
+		.type_id = 0
+	};
+	get_type_schema_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.schema = { .size = 0, .data = NULL }
+	};
+	mdcs_counter_type_t type = MDCS_COUNTER_TYPE_NULL;
+	void* buf = NULL;
+	size_t size = 0;
+
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
+	ret = mdcs_counter_type_find_by_id(in.type_id, &type);
+	if(ret != MDCS_SUCCESS) {
+		out.ret = MDCS_ERROR;
+	} else if(mdcs_counter_schema_pack(&type->schema, &buf, &size) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not pack counter type schema");
+		out.ret = MDCS_ERROR;
+	} else {
+		out.schema.size = size;
+		out.schema.data = buf;
+	}
+
+	ret = margo_respond(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not respond to RPC");
+		result = ret;
+		goto cleanup;
+	}
+
+	mdcs_self_stats_rpc(MDCS_SELF_SCHEMA, 0, out.schema.size);
+
+cleanup:
+
+	free(buf);
+
+	ret = margo_free_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free input");
+		result = ret;
+	}
+
+	ret = margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+		result = ret;
+	}
+
+	return result;
+}
+DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_get_type_schema)
+
+hg_return_t mdcs_rpc_watch_counter(hg_handle_t handle)
+{
+	hg_return_t result = HG_SUCCESS;
+	int ret = HG_SUCCESS;
+	watch_counter_in_t in = {
+		.counter_id = 0,
+		.op = 0,
+		.field_type = 0,
+		.field_offset = 0,
+		.threshold = 0.0,
+		.timeout = 0.0,
+		.size = 0
+	};
+	watch_counter_out_t out = {
+		.ret = MDCS_SUCCESS,
+		.fired = 0,
+		.value = { .size = 0, .data = NULL }
+	};
+	mdcs_counter_t counter = MDCS_COUNTER_NULL;
+	void* buffer = NULL;
+	int fired = 0;
+
+	ret = margo_get_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not get input from handle");
+		result = ret;
+		goto cleanup;
+	}
+
+	ret = mdcs_counter_find_by_id(in.counter_id, &counter);
+	if(ret != MDCS_SUCCESS) {
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	if(in.size != counter->t->counter_value_size) {
+		MDCS_PRINT_ERROR("Incorrect buffer size provided by client");
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	buffer = calloc(1, in.size);
+	if(buffer == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate buffer");
+		result = HG_OTHER_ERROR;
+		goto cleanup;
+	}
+
+	mdcs_watch_predicate_t pred = {
+		.op = (mdcs_watch_op_t)in.op,
+		.field_type = (mdcs_field_type_t)in.field_type,
+		.field_offset = in.field_offset,
+		.threshold = in.threshold
+	};
+
+	// the ULT is parked here until the predicate fires or the timeout expires
+	ret = mdcs_counter_watch_wait(counter, &pred, in.timeout, buffer, &fired);
+	if(ret != MDCS_SUCCESS) {
+		out.ret = MDCS_ERROR;
+		goto respond;
+	}
+
+	out.fired = fired;
+	out.value.size = in.size;
+	out.value.data = buffer;
+
+respond:
+	ret = margo_respond(handle, &out);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not respond to RPC");
+		result = ret;
+		goto cleanup;
+	}
+
+	mdcs_self_stats_rpc(MDCS_SELF_WATCH, 0, out.value.size);
+
+cleanup:
+
+	free(buffer);
+
+	ret = margo_free_input(handle, &in);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not free input");
+		result = ret;
+	}
+
+	ret = margo_destroy(handle);
+	if(ret != HG_SUCCESS) {
+		MDCS_PRINT_WARNING("Could not destroy RPC handle");
+		result = ret;
+	}
+
+	return result;
+}
+DEFINE_MARGO_RPC_HANDLER(mdcs_rpc_watch_counter)
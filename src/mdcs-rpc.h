@@ -14,4 +14,19 @@ DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_get_counter);
 hg_return_t mdcs_rpc_reset_counter(hg_handle_t handle);
 DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_reset_counter);
 
+hg_return_t mdcs_rpc_push_counter(hg_handle_t handle);
+DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_push_counter);
+
+hg_return_t mdcs_rpc_aggregate_family(hg_handle_t handle);
+DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_aggregate_family);
+
+hg_return_t mdcs_rpc_list_counters(hg_handle_t handle);
+DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_list_counters);
+
+hg_return_t mdcs_rpc_get_type_schema(hg_handle_t handle);
+DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_get_type_schema);
+
+hg_return_t mdcs_rpc_watch_counter(hg_handle_t handle);
+DECLARE_MARGO_RPC_HANDLER(mdcs_rpc_watch_counter);
+
 #endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <string.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-timer.h>
+#include "mdcs-global-data.h"
+#include "mdcs-counter-type.h"
+#include "mdcs-counter.h"
+#include "mdcs-self-stats.h"
+#include "mdcs-error.h"
+
+extern mdcs_t g_mdcs;
+
+static const char* served_names[MDCS_SELF_NUM_RPCS] = {
+	"mdcs:fetch:served",
+	"mdcs:reset:served",
+	"mdcs:push:served",
+	"mdcs:aggregate:served",
+	"mdcs:list:served",
+	"mdcs:schema:served",
+	"mdcs:watch:served"
+};
+
+/**
+ * Approximates the memory held by a counter from the fields
+ * fixed at its creation (exemplars and watches are not included).
+ */
+static int64_t counter_memory(mdcs_counter_t counter)
+{
+	size_t data = counter->t->counter_data_size;
+	size_t size = sizeof(struct mdcs_counter_s);
+	if(counter->name) size += strlen(counter->name) + 1;
+	if(counter->num_slots == 0)
+		size += data;
+	else if(counter->slot_stride != 0)
+		size += counter->slot_stride * counter->num_slots;
+	else
+		size += (sizeof(void*) + data) * counter->num_slots;
+	size += counter->max_buffer_size * counter->t->counter_item_size;
+	return (int64_t)size;
+}
+
+int mdcs_self_stats_init()
+{
+	size_t i;
+	int ret = MDCS_SUCCESS;
+
+	mdcs_self_stats_t s = (mdcs_self_stats_t)calloc(1, sizeof(*s));
+	if(s == NULL) {
+		MDCS_PRINT_ERROR("Could not allocate memory for MDCS counters");
+		return MDCS_ERROR;
+	}
+
+	if(ABT_mutex_create(&s->mutex) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create MDCS counters mutex");
+		free(s);
+		return MDCS_ERROR;
+	}
+
+	for(i=0; i < MDCS_SELF_NUM_RPCS && ret == MDCS_SUCCESS; i++)
+		ret = mdcs_counter_register(served_names[i], MDCS_COUNTER_ATOMIC, 0, &s->served[i]);
+
+	if(ret != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:fetch:time", MDCS_COUNTER_HISTOGRAM, 0, &s->fetch_time) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:bytes_sent", MDCS_COUNTER_ATOMIC, 0, &s->bytes_sent) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:bytes_received", MDCS_COUNTER_ATOMIC, 0, &s->bytes_received) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:digest:count", MDCS_COUNTER_ATOMIC, 0, &s->digests) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:digest:time_ns", MDCS_COUNTER_ATOMIC, 0, &s->digest_time) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:registry:counters", MDCS_COUNTER_GAUGE, 0, &s->counters) != MDCS_SUCCESS
+	|| mdcs_counter_register("mdcs:registry:bytes", MDCS_COUNTER_GAUGE, 0, &s->memory) != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not register MDCS counters");
+		ABT_mutex_free(&s->mutex);
+		free(s);
+		return MDCS_ERROR;
+	}
+
+	g_mdcs->self_stats = s;
+
+	// account for the counters registered so far, including the ones above
+	mdcs_counter_t current_counter, tmp;
+	HASH_ITER(hh, g_mdcs->counter_hash, current_counter, tmp) {
+		mdcs_self_stats_registry(current_counter, 1);
+	}
+
+	return MDCS_SUCCESS;
+}
+
+void mdcs_self_stats_finalize()
+{
+	mdcs_self_stats_t s = g_mdcs ? g_mdcs->self_stats : NULL;
+	if(s == NULL) return;
+	g_mdcs->self_stats = NULL;
+	ABT_mutex_free(&s->mutex);
+	free(s);
+}
+
+void mdcs_self_stats_rpc(mdcs_self_rpc_t rpc, size_t received, size_t sent)
+{
+	mdcs_self_stats_t s = g_mdcs ? g_mdcs->self_stats : NULL;
+	if(s == NULL) return;
+	mdcs_counter_atomic_add(s->served[rpc], 1);
+	if(received) mdcs_counter_atomic_add(s->bytes_received, received);
+	if(sent)     mdcs_counter_atomic_add(s->bytes_sent, sent);
+}
+
+void mdcs_self_stats_fetch_time(double seconds)
+{
+	mdcs_self_stats_t s = g_mdcs ? g_mdcs->self_stats : NULL;
+	if(s == NULL) return;
+	ABT_mutex_lock(s->mutex);
+	mdcs_counter_push(s->fetch_time, &seconds);
+	ABT_mutex_unlock(s->mutex);
+}
+
+void mdcs_self_stats_digest(uint64_t ticks)
+{
+	mdcs_self_stats_t s = g_mdcs ? g_mdcs->self_stats : NULL;
+	if(s == NULL) return;
+	mdcs_counter_atomic_add(s->digests, 1);
+	mdcs_counter_atomic_add(s->digest_time,
+			(uint64_t)(ticks*mdcs_timer_source.seconds_per_tick*1e9));
+}
+
+void mdcs_self_stats_registry(mdcs_counter_t counter, int64_t delta)
+{
+	mdcs_self_stats_t s = g_mdcs ? g_mdcs->self_stats : NULL;
+	if(s == NULL) return;
+	int64_t bytes = delta*counter_memory(counter);
+	ABT_mutex_lock(s->mutex);
+	mdcs_counter_push(s->counters, &delta);
+	mdcs_counter_push(s->memory, &bytes);
+	ABT_mutex_unlock(s->mutex);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_SELF_STATS_H
+#define __MDCS_SELF_STATS_H
+
+#include <abt.h>
+#include <mdcs/mdcs.h>
+
+/*
+ * RPCs served by MDCS, in the order of their "mdcs:<rpc>:served" counters.
+ */
+typedef enum {
+	MDCS_SELF_FETCH = 0,
+	MDCS_SELF_RESET,
+	MDCS_SELF_PUSH,
+	MDCS_SELF_AGGREGATE,
+	MDCS_SELF_LIST,
+	MDCS_SELF_SCHEMA,
+	MDCS_SELF_WATCH,
+	MDCS_SELF_NUM_RPCS
+} mdcs_self_rpc_t;
+
+/*
+ * Counters tracking the overhead of MDCS itself. Counts are atomic
+ * counters, the other counters are protected by the mutex.
+ */
+typedef struct mdcs_self_stats_s {
+	ABT_mutex      mutex;                     // protects the histogram and the gauges
+	mdcs_counter_t served[MDCS_SELF_NUM_RPCS]; // number of RPCs served, per RPC
+	mdcs_counter_t fetch_time;                // latency of the fetch handler
+	mdcs_counter_t bytes_sent;                // payload bytes sent by the handlers
+	mdcs_counter_t bytes_received;            // payload bytes received by the handlers
+	mdcs_counter_t digests;                   // number of non-empty buffer digests
+	mdcs_counter_t digest_time;               // cumulated digest time, in nanoseconds
+	mdcs_counter_t counters;                  // number of counters in the registry
+	mdcs_counter_t memory;                    // approximate memory held by these counters
+}* mdcs_self_stats_t;
+
+/**
+ * Registers the "mdcs:" counters and accounts for the
+ * counters already present in the registry.
+ */
+int mdcs_self_stats_init();
+
+/**
+ * Stops updating the "mdcs:" counters and frees their state
+ * (the counters themselves are freed along with the other counters).
+ * The functions below do nothing once this is called, even after
+ * MDCS itself is finalized, so that handlers completing late can
+ * still call them.
+ */
+void mdcs_self_stats_finalize();
+
+/**
+ * Counts an RPC served, along with the payload bytes it
+ * received and sent.
+ */
+void mdcs_self_stats_rpc(mdcs_self_rpc_t rpc, size_t received, size_t sent);
+
+/**
+ * Pushes the latency of a fetch handler.
+ */
+void mdcs_self_stats_fetch_time(double seconds);
+
+/**
+ * Counts a digest of a counter's buffer that took the given number of timer ticks.
+ */
+void mdcs_self_stats_digest(uint64_t ticks);
+
+/**
+ * Accounts for a counter entering (delta = 1) or leaving
+ * (delta = -1) the registry.
+ */
+void mdcs_self_stats_registry(mdcs_counter_t counter, int64_t delta);
+
+#endif
@@ -5,6 +5,7 @@
  */
 #include <string.h>
 #include <mdcs/mdcs.h>
+#include <mdcs/mdcs-timer.h>
 #include "mdcs-hash-string.h"
 #include "mdcs-counter-type.h"
 #include "mdcs-global-data.h"
@@ -12,6 +13,10 @@
 #include "mdcs-rpc-types.h"
 #include "mdcs-error.h"
 #include "mdcs-counter.h"
+#include "mdcs-counter-family.h"
+#include "mdcs-counter-schema.h"
+#include "mdcs-timer-calibrate.h"
+#include "mdcs-counter-watch.h"
 
 #define MDCS_PROVIDER_ID 0
 
@@ -31,10 +36,46 @@ int mdcs_init(margo_instance_id mid, int listening, ABT_pool pool)
 	}
 
 	newmdcs->counter_hash = NULL;
+	newmdcs->family_hash = NULL;
+	newmdcs->counter_trie = NULL;
+	newmdcs->type_hash = NULL;
+	newmdcs->schema_cache = NULL;
+	newmdcs->rpc_monitors = NULL;
+	newmdcs->abt_sampler = NULL;
+	newmdcs->margo_stats = NULL;
+	newmdcs->self_stats = NULL;
+	newmdcs->exporter = NULL;
 	newmdcs->mid = mid;
+	newmdcs->watch_parked = 0;
+	newmdcs->watch_closed = 0;
+
+	if(ABT_mutex_create(&newmdcs->watch_mutex) != ABT_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not create watch mutex");
+		free(newmdcs);
+		return MDCS_ERROR;
+	}
 
 	g_mdcs = newmdcs;
 
+	mdcs_counter_types_init();
+
+	if(mdcs_margo_stats_init() != MDCS_SUCCESS) {
+		mdcs_finalize();
+		return MDCS_ERROR;
+	}
+
+	mdcs_timer_calibrate();
+
+	if(mdcs_self_stats_init() != MDCS_SUCCESS) {
+		mdcs_finalize();
+		return MDCS_ERROR;
+	}
+
+	// without a Margo instance, counters can only be used locally
+	if(mid == MARGO_INSTANCE_NULL) {
+		return MDCS_SUCCESS;
+	}
+
 	if(pool == ABT_POOL_NULL) {
 		margo_get_handler_pool(mid, &pool);
 	}
@@ -51,6 +92,36 @@ int mdcs_init(margo_instance_id mid, int listening, ABT_pool pool)
 						mdcs_rpc_reset_counter,
 						MDCS_PROVIDER_ID, pool);
 
+	g_mdcs->rpc_push_id = MARGO_REGISTER_PROVIDER(mid, "mdcs_push_counter",
+						push_counter_in_t,
+						push_counter_out_t,
+						mdcs_rpc_push_counter,
+						MDCS_PROVIDER_ID, pool);
+
+	g_mdcs->rpc_aggregate_id = MARGO_REGISTER_PROVIDER(mid, "mdcs_aggregate_family",
+						aggregate_family_in_t,
+						aggregate_family_out_t,
+						mdcs_rpc_aggregate_family,
+						MDCS_PROVIDER_ID, pool);
+
+	g_mdcs->rpc_list_id = MARGO_REGISTER_PROVIDER(mid, "mdcs_list_counters",
+						list_counters_in_t,
+						list_counters_out_t,
+						mdcs_rpc_list_counters,
+						MDCS_PROVIDER_ID, pool);
+
+	g_mdcs->rpc_schema_id = MARGO_REGISTER_PROVIDER(mid, "mdcs_get_type_schema",
+						get_type_schema_in_t,
+						get_type_schema_out_t,
+						mdcs_rpc_get_type_schema,
+						MDCS_PROVIDER_ID, pool);
+
+	g_mdcs->rpc_watch_id = MARGO_REGISTER_PROVIDER(mid, "mdcs_watch_counter",
+						watch_counter_in_t,
+						watch_counter_out_t,
+						mdcs_rpc_watch_counter,
+						MDCS_PROVIDER_ID, pool);
+
 	return MDCS_SUCCESS;
 }
 
@@ -67,17 +138,39 @@ int mdcs_finalize()
 		return MDCS_ERROR;
 	}
 
+	mdcs_exporter_finalize();
+
+	mdcs_self_stats_finalize();
+
+	mdcs_abt_sampler_finalize();
+
+	mdcs_rpc_monitors_finalize();
+
+	mdcs_margo_stats_finalize();
+
+	mdcs_counter_watch_finalize();
+
+	mdcs_name_trie_free(g_mdcs->counter_trie);
+	g_mdcs->counter_trie = NULL;
+
 	mdcs_counter_t current_counter, tmp;
 
 	HASH_ITER(hh, g_mdcs->counter_hash, current_counter, tmp) {
 		HASH_DEL(g_mdcs->counter_hash, current_counter); 
-		free(current_counter->name);
-		current_counter->t->destroy_f(current_counter->counter_internal_data);
-		mdcs_counter_type_destroy(current_counter->t);
-		if(current_counter->buffer != NULL) free(current_counter->buffer);
-		free(current_counter);
+		mdcs_counter_free(current_counter);
+	}
+
+	mdcs_counter_family_t current_family, tmp_family;
+
+	HASH_ITER(hh, g_mdcs->family_hash, current_family, tmp_family) {
+		HASH_DEL(g_mdcs->family_hash, current_family);
+		mdcs_counter_family_free(current_family);
 	}
 
+	mdcs_counter_types_finalize();
+
+	ABT_mutex_free(&g_mdcs->watch_mutex);
+
 	free(g_mdcs);
 	g_mdcs = MDCS_NULL;
 
@@ -109,6 +202,14 @@ int mdcs_counter_type_create(size_t itemsize, size_t valuesize,
 	newtype->get_value_f        = get_value_fn;
 	newtype->push_one_f         = push_one_fn;
 	newtype->push_multi_f       = push_multi_fn;
+	newtype->merge_f            = NULL;
+	newtype->counter_data_size  = 0;
+	newtype->create_args_f      = NULL;
+	newtype->merge_args_f       = NULL;
+	newtype->lock_free          = 0;
+	newtype->double_items       = 0;
+	newtype->args               = NULL;
+	memset(&newtype->schema, 0, sizeof(newtype->schema));
 	newtype->refcount           = 1;
 
 	*type = newtype;
@@ -123,31 +224,27 @@ int mdcs_counter_type_destroy(mdcs_counter_type_t type)
 	}
 
 	if(type == MDCS_COUNTER_TYPE_NULL) return MDCS_SUCCESS;
-	
+
+	// built-in types have a negative refcount and are never freed
+	if(type->refcount < 0) return MDCS_SUCCESS;
+
 	type->refcount -= 1;
 	if(type->refcount == 0) {
+		// the schema's strings are allocated along with its fields
+		free((void*)type->schema.fields);
+		free(type->args);
 		free(type);
 	}
 	return MDCS_SUCCESS;
 }
 
-int mdcs_counter_register(const char* name,
-        mdcs_counter_type_t type, size_t buffer_size, 
-        mdcs_counter_t* counter) 
+int mdcs_counter_create(const char* name, uint64_t id,
+		mdcs_counter_type_t type, size_t buffer_size,
+		size_t num_slots, mdcs_counter_t* counter)
 {
-	if(g_mdcs == NULL) {
-		MDCS_PRINT_ERROR("MDCS was not initialized");
-		return MDCS_ERROR;
-	}
-
-	mdcs_counter_t c;
-	int ret;
-
-	uint64_t id = mdcs_hash_string(name);
-
-	ret = mdcs_counter_find_by_id(id, &c);
-	if(ret == MDCS_SUCCESS) {
-		MDCS_PRINT_ERROR("Hash collision or a counter with the same name already exists");
+	// lock-free types are pushed into directly
+	if(type->lock_free && buffer_size != 0) {
+		MDCS_PRINT_ERROR("Counters of a lock-free type cannot have a buffer");
 		return MDCS_ERROR;
 	}
 
@@ -157,10 +254,25 @@ int mdcs_counter_register(const char* name,
 		return MDCS_ERROR;
 	}
 
-	newcounter->name = strdup(name);
+	newcounter->name = name ? strdup(name) : NULL;
 	newcounter->id = id;
 	newcounter->t = type;
-	newcounter->counter_internal_data = type->create_f();
+	newcounter->num_slots = num_slots;
+	newcounter->slot_stride = 0;
+	newcounter->exemplars = NULL;
+	newcounter->watches = NULL;
+	if(num_slots == 0) {
+		newcounter->counter_internal_data = mdcs_counter_type_create_data(type);
+	} else {
+		newcounter->counter_internal_data = mdcs_counter_slots_create(type,
+				num_slots, &newcounter->slot_stride);
+	}
+	if(newcounter->counter_internal_data == NULL) {
+		MDCS_PRINT_ERROR("Could not create counter's internal data");
+		free(newcounter->name);
+		free(newcounter);
+		return MDCS_ERROR;
+	}
 	newcounter->buffer = NULL;
 	newcounter->num_buffered = 0;
 	newcounter->max_buffer_size = 0;
@@ -170,26 +282,149 @@ int mdcs_counter_register(const char* name,
 		newcounter->buffer = malloc(buffer_size*(type->counter_item_size));
 		if(newcounter->buffer == NULL) {
 			MDCS_PRINT_ERROR("Could not allocate memory for counter's buffer");
+			if(num_slots == 0)
+				type->destroy_f(newcounter->counter_internal_data);
+			else
+				mdcs_counter_slots_destroy(newcounter);
+			free(newcounter->name);
 			free(newcounter);
 			return MDCS_ERROR;
 		}
 	}
 
-	HASH_ADD(hh, g_mdcs->counter_hash, id, sizeof(uint64_t), newcounter);
+	// the counter holds a reference to its type, built-in types are not counted
+	if(type->refcount > 0) type->refcount += 1;
+
+	mdcs_counter_reset(newcounter);
+
+	mdcs_self_stats_registry(newcounter, 1);
+
+	*counter = newcounter;
+	return MDCS_SUCCESS;
+}
 
-	ret = mdcs_counter_reset(newcounter);
+void mdcs_counter_free(mdcs_counter_t counter)
+{
+	mdcs_self_stats_registry(counter, -1);
+	if(counter->watches != NULL)
+		mdcs_counter_watch_release(counter);
+	free(counter->name);
+	if(counter->num_slots == 0)
+		counter->t->destroy_f(counter->counter_internal_data);
+	else
+		mdcs_counter_slots_destroy(counter);
+	mdcs_counter_type_destroy(counter->t);
+	mdcs_exemplars_free(counter->exemplars);
+	free(counter->buffer);
+	free(counter);
+}
+
+int mdcs_counter_type_set_merge(mdcs_counter_type_t type, mdcs_merge_f merge_fn)
+{
+	if(type == MDCS_COUNTER_TYPE_NULL) {
+		MDCS_PRINT_ERROR("Trying to set the merge function of a NULL type");
+		return MDCS_ERROR;
+	}
+	if(type->refcount < 0) {
+		MDCS_PRINT_ERROR("Cannot modify a built-in counter type");
+		return MDCS_ERROR;
+	}
+	type->merge_f = merge_fn;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_set_data_size(mdcs_counter_type_t type, size_t datasize)
+{
+	if(type == MDCS_COUNTER_TYPE_NULL) {
+		MDCS_PRINT_ERROR("Trying to set the data size of a NULL type");
+		return MDCS_ERROR;
+	}
+	if(type->refcount < 0) {
+		MDCS_PRINT_ERROR("Cannot modify a built-in counter type");
+		return MDCS_ERROR;
+	}
+	type->counter_data_size = datasize;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_set_double_items(mdcs_counter_type_t type)
+{
+	if(type == MDCS_COUNTER_TYPE_NULL) {
+		MDCS_PRINT_ERROR("Trying to modify a NULL type");
+		return MDCS_ERROR;
+	}
+	if(type->refcount < 0) {
+		MDCS_PRINT_ERROR("Cannot modify a built-in counter type");
+		return MDCS_ERROR;
+	}
+	if(type->counter_item_size != sizeof(double)) {
+		MDCS_PRINT_ERROR("Items of this type are not the size of a double");
+		return MDCS_ERROR;
+	}
+	type->double_items = 1;
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_type_merge(mdcs_counter_type_t type, void* value, const void* other)
+{
+	if(type == MDCS_COUNTER_TYPE_NULL || !mdcs_counter_type_can_merge(type)) {
+		MDCS_PRINT_ERROR("Counter type does not support merging values");
+		return MDCS_ERROR;
+	}
+	return mdcs_counter_type_merge_values(type, value, other);
+}
+
+int mdcs_counter_register(const char* name,
+        mdcs_counter_type_t type, size_t buffer_size, 
+        mdcs_counter_t* counter) 
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_t c;
+	int ret;
+
+	uint64_t id = mdcs_hash_string(name);
+
+	mdcs_counter_family_t f;
+
+	ret = mdcs_counter_find_by_id(id, &c);
+	if(ret == MDCS_SUCCESS
+	|| mdcs_counter_family_find_by_id(id, &f) == MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Hash collision or a counter with the same name already exists");
+		return MDCS_ERROR;
+	}
+
+	mdcs_counter_t newcounter = MDCS_COUNTER_NULL;
+	ret = mdcs_counter_create(name, id, type, buffer_size, 0, &newcounter);
 	if(ret != MDCS_SUCCESS) {
-		MDCS_PRINT_WARNING("Could not reset counter");
-		free(newcounter->buffer);
-		free(newcounter);
 		return MDCS_ERROR;
 	}
 
+	ret = mdcs_name_trie_insert(&g_mdcs->counter_trie, name, newcounter);
+	if(ret != MDCS_SUCCESS) {
+		MDCS_PRINT_ERROR("Could not index counter name");
+		mdcs_counter_free(newcounter);
+		return MDCS_ERROR;
+	}
+
+	HASH_ADD(hh, g_mdcs->counter_hash, id, sizeof(uint64_t), newcounter);
+
 	*counter = newcounter;
 
 	return MDCS_SUCCESS;
 }
 
+void mdcs_counter_unregister(mdcs_counter_t counter)
+{
+	if(counter == MDCS_COUNTER_NULL) return;
+	HASH_DEL(g_mdcs->counter_hash, counter);
+	mdcs_name_trie_remove(g_mdcs->counter_trie, counter->name);
+	mdcs_counter_free(counter);
+}
+
 int mdcs_counter_find_by_id(uint64_t id, mdcs_counter_t* counter)
 {
 	if(g_mdcs == NULL) {
@@ -210,6 +445,27 @@ int mdcs_counter_find_by_name(const char* name, mdcs_counter_t* counter)
 	return mdcs_counter_find_by_id(id, counter);
 }
 
+/**
+ * Hands an array of items to the counter's push_multi function,
+ * or to its push_one function one item at a time if the type
+ * does not provide push_multi.
+ */
+static void mdcs_counter_feed(mdcs_counter_t counter, const void* values, size_t num)
+{
+	if(counter->t->push_multi_f != NULL) {
+		counter->t->push_multi_f(counter->counter_internal_data, values, num);
+	} else {
+		size_t i;
+		const char* value = values;
+		for(i=0; i < num; i++) {
+			counter->t->push_one_f(counter->counter_internal_data, value);
+			value += counter->t->counter_item_size;
+		}
+	}
+	if(counter->watches != NULL)
+		mdcs_counter_watch_notify(counter);
+}
+
 int mdcs_counter_push(mdcs_counter_t counter, const void* value)
 {
 	if(g_mdcs == NULL) {
@@ -224,6 +480,11 @@ int mdcs_counter_push(mdcs_counter_t counter, const void* value)
 		return MDCS_ERROR;
 	}
 
+	if(counter->num_slots != 0) {
+		MDCS_PRINT_ERROR("Pushing in a vector counter requires a slot index");
+		return MDCS_ERROR;
+	}
+
 	if((counter->num_buffered == counter->max_buffer_size)
 	&& (counter->max_buffer_size != 0)) {
 		ret = mdcs_counter_digest(counter);
@@ -239,8 +500,43 @@ int mdcs_counter_push(mdcs_counter_t counter, const void* value)
 		counter->num_buffered += 1;
 	} else {
 		counter->t->push_one_f(counter->counter_internal_data, value);
+		if(counter->watches != NULL)
+			mdcs_counter_watch_notify(counter);
+	}
+
+	return MDCS_SUCCESS;
+}
+
+int mdcs_counter_push_multi(mdcs_counter_t counter, const void* values, size_t num)
+{
+	if(g_mdcs == NULL) {
+		MDCS_PRINT_ERROR("MDCS was not initialized");
+		return MDCS_ERROR;
+	}
+
+	if(counter == MDCS_COUNTER_NULL) {
+		MDCS_PRINT_ERROR("Trying to push in a NULL counter");
+		return MDCS_ERROR;
+	}
+
+	if(counter->num_slots != 0) {
+		MDCS_PRINT_ERROR("Pushing in a vector counter requires a slot index");
+		return MDCS_ERROR;
 	}
 
+	if(num == 0) return MDCS_SUCCESS;
+
+	// buffered items were pushed first, they must be digested first
+	if(counter->num_buffered != 0) {
+		int ret = mdcs_counter_digest(counter);
+		if(ret != MDCS_SUCCESS) {
+			MDCS_PRINT_ERROR("Unable to digest buffer");
+			return MDCS_ERROR;
+		}
+	}
+
+	mdcs_counter_feed(counter, values, num);
+
 	return MDCS_SUCCESS;
 }
 
@@ -257,17 +553,10 @@ int mdcs_counter_digest(mdcs_counter_t counter)
 	}
 
 	if(counter->num_buffered != 0) {
-		if(counter->t->push_multi_f != NULL) {
-			counter->t->push_multi_f(counter->counter_internal_data, counter->buffer, counter->num_buffered);
-		} else {
-			unsigned i;
-			char* value = counter->buffer;
-			for(i=0; i < counter->num_buffered; i++) {
-				counter->t->push_one_f(counter->counter_internal_data, value);
-				value += counter->t->counter_item_size;
-			}
-		}
+		uint64_t start = mdcs_timer_ticks();
+		mdcs_counter_feed(counter, counter->buffer, counter->num_buffered);
 		counter->num_buffered = 0;
+		mdcs_self_stats_digest(mdcs_timer_ticks() - start);
 	}
 
 	return MDCS_SUCCESS;
@@ -292,6 +581,9 @@ int mdcs_counter_value(mdcs_counter_t counter, void* value)
 			return MDCS_ERROR;
 		}
 	}
+	if(counter->num_slots != 0)
+		return mdcs_counter_vector_value(counter, 0, counter->num_slots, value);
+
 	counter->t->get_value_f(counter->counter_internal_data, value);
 	
 	return MDCS_SUCCESS;
@@ -309,7 +601,16 @@ int mdcs_counter_reset(mdcs_counter_t counter)
 		return MDCS_ERROR;
 	}
 
-	counter->t->reset_f(counter->counter_internal_data);
+	if(counter->num_slots != 0) {
+		size_t i;
+		for(i=0; i < counter->num_slots; i++)
+			counter->t->reset_f(mdcs_counter_slot_data(counter, i));
+	} else {
+		counter->t->reset_f(counter->counter_internal_data);
+	}
+
+	if(counter->exemplars != NULL)
+		mdcs_exemplars_reset(counter->exemplars);
 
 	return MDCS_SUCCESS;
 }
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_TIME_H
+#define __MDCS_TIME_H
+
+#include <time.h>
+
+/**
+ * Returns the current time in seconds from a monotonic clock.
+ */
+static inline double mdcs_time_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __MDCS_TIMER_CALIBRATE_H
+#define __MDCS_TIMER_CALIBRATE_H
+
+/**
+ * Selects the source of the timestamps used by timers, calibrating
+ * the TSC against the monotonic clock if it can be used.
+ */
+void mdcs_timer_calibrate();
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2017 UChicago Argonne, LLC
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-timer.h>
+#include "mdcs-timer-calibrate.h"
+#include "mdcs-time.h"
+
+#ifdef MDCS_TIMER_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+/* duration over which the TSC is calibrated */
+#define MDCS_TIMER_CALIBRATION_TIME 0.005
+
+mdcs_timer_source_t mdcs_timer_source = {
+	.use_tsc = 0,
+	.seconds_per_tick = 1e-9
+};
+
+#ifdef MDCS_TIMER_HAVE_TSC
+/**
+ * Checks whether the CPU advertises an invariant TSC.
+ */
+static int tsc_is_invariant()
+{
+	unsigned int eax, ebx, ecx, edx;
+	if(__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+		return 0;
+	if(__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+		return 0;
+	return (edx >> 8) & 1;
+}
+#endif
+
+void mdcs_timer_calibrate()
+{
+#ifdef MDCS_TIMER_HAVE_TSC
+	if(!tsc_is_invariant()) return;
+
+	double t0 = mdcs_time_now();
+	uint64_t c0 = __rdtsc();
+	double t1;
+	do {
+		t1 = mdcs_time_now();
+	} while(t1 - t0 < MDCS_TIMER_CALIBRATION_TIME);
+	uint64_t c1 = __rdtsc();
+
+	if(c1 <= c0) return;
+	mdcs_timer_source.seconds_per_tick = (t1 - t0)/(double)(c1 - c0);
+	mdcs_timer_source.use_tsc = 1;
+#endif
+}
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <margo.h>
 #include <mdcs/mdcs.h>
 #include <mdcs/mdcs-counters.h>
@@ -44,19 +45,42 @@ int main(int argc, char** argv)
 		int64_t counter_value;
 		mdcs_remote_counter_fetch(svr_addr, cid1, &counter_value, sizeof(counter_value));
 		mdcs_counter_stat_double_value_t stats;
-		mdcs_remote_counter_fetch(svr_addr, cid2, &stats, sizeof(stats));
+		mdcs_exemplar_t exemplars[3];
+		size_t num_exemplars;
+		mdcs_remote_counter_fetch_exemplars(svr_addr, cid2, &stats, sizeof(stats),
+				exemplars, 3, &num_exemplars);
 		range_tracker_value_t range;
 		mdcs_remote_counter_fetch(svr_addr, cid3, &range, sizeof(range));
 
 		printf("Counter value is %ld\n", counter_value);
 		printf("Stats: count=%ld min=%lf, max=%lf, avg=%lf, var=%lf, last=%lf\n",
 			stats.count, stats.min, stats.max, stats.avg, stats.var, stats.last);
+		int j;
+		for(j=0; j < (int)num_exemplars; j++)
+			printf("Exemplar %lf pushed by request %lu\n", exemplars[j].value, exemplars[j].tag);
 		printf("Range value is %d\n", range);
 
 		margo_free_output(h,&resp);
 		margo_destroy(h);
 	}
 
+	/* List the counters and describe their values */
+	mdcs_counter_info_t* infos;
+	size_t num_infos;
+	int more;
+	mdcs_remote_counter_list(svr_addr, "example:*", NULL, 0, &infos, &num_infos, &more);
+	for(i=0; i < (int)num_infos; i++) {
+		const mdcs_counter_schema_t* schema;
+		if(mdcs_remote_counter_type_schema(svr_addr, infos[i].type_id, &schema) != MDCS_SUCCESS)
+			continue;
+		printf("Counter %s has type %s with fields", infos[i].name, schema->type_name);
+		size_t j;
+		for(j=0; j < schema->num_fields; j++)
+			printf(" %s", schema->fields[j].name);
+		printf("\n");
+	}
+	free(infos);
+
 	/* free the address */
 	margo_addr_free(mid, svr_addr);
 
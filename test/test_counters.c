@@ -0,0 +1,381 @@
+#include <fnmatch.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <margo.h>
+#include <mdcs/mdcs.h>
+#include <mdcs/mdcs-counters.h>
+#include "mdcs-counter.h"
+#include "mdcs-name-trie.h"
+#include "mdcs-global-data.h"
+
+/*
+ * Known-answer tests for the counter algorithms. MDCS is initialized
+ * without a Margo instance, so these tests only exercise counters
+ * locally and do not need a network. Checks do not rely on assert,
+ * since tests are usually built with NDEBUG.
+ */
+
+extern mdcs_t g_mdcs;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if(!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		failures += 1; \
+	} \
+} while(0)
+
+#define CHECK_CLOSE(a, b, tol) CHECK(fabs((double)(a) - (double)(b)) <= (tol))
+
+/* deterministic pseudo-random generator (xorshift64*), so that
+ * results do not depend on the platform's rand() */
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng_next()
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/* shuffles an array of keys (Fisher-Yates) */
+static void shuffle(uint64_t* keys, size_t n)
+{
+	size_t i;
+	for(i=n-1; i > 0; i--) {
+		size_t j = rng_next() % (i+1);
+		uint64_t k = keys[i];
+		keys[i] = keys[j];
+		keys[j] = k;
+	}
+}
+
+/*
+ * Pushes a skewed stream (keys 1 to 5 are pushed 50000, 40000, ...,
+ * 10000 times, shuffled with 50000 keys seen once) and checks that
+ * the heavy hitters come first, in order, with counts that are not
+ * underestimated and are overestimated by at most a few times the
+ * stream length over the width of the sketch.
+ */
+static void test_topk()
+{
+	mdcs_counter_t all, a, b;
+	const size_t total = 200000;
+	const uint64_t slack = 3*total/MDCS_COUNTER_TOPK_WIDTH;
+	size_t i, j, n = 0;
+
+	if(mdcs_counter_register("test:topk:all", MDCS_COUNTER_TOPK, 0, &all) != MDCS_SUCCESS
+	|| mdcs_counter_register("test:topk:a", MDCS_COUNTER_TOPK, 0, &a) != MDCS_SUCCESS
+	|| mdcs_counter_register("test:topk:b", MDCS_COUNTER_TOPK, 0, &b) != MDCS_SUCCESS) {
+		CHECK(0 && "could not register top-k counters");
+		return;
+	}
+
+	uint64_t* keys = malloc(total*sizeof(*keys));
+	for(i=1; i <= 5; i++)
+		for(j=0; j < 10000*(6-i); j++)
+			keys[n++] = i;
+	while(n < total) {
+		keys[n] = 1000000 + n;
+		n++;
+	}
+	shuffle(keys, total);
+
+	for(i=0; i < total; i++) {
+		mdcs_counter_topk_item_t item = { keys[i], 1 };
+		mdcs_counter_push(all, &item);
+		mdcs_counter_push(i % 2 ? a : b, &item);
+	}
+
+	mdcs_counter_topk_value_t* v  = malloc(sizeof(*v));
+	mdcs_counter_topk_value_t* va = malloc(sizeof(*va));
+	mdcs_counter_topk_value_t* vb = malloc(sizeof(*vb));
+	mdcs_counter_value(all, v);
+	mdcs_counter_value(a, va);
+	mdcs_counter_value(b, vb);
+
+	CHECK(v->num_entries == MDCS_COUNTER_TOPK_K);
+	for(i=0; i < 5; i++) {
+		CHECK(v->entries[i].key == i+1);
+		CHECK(v->entries[i].count >= 10000*(5-i));
+		CHECK(v->entries[i].count <= 10000*(5-i) + slack);
+	}
+
+	// merging the halves finds the same heavy hitters, in the same order
+	CHECK(mdcs_counter_type_merge(MDCS_COUNTER_TOPK, va, vb) == MDCS_SUCCESS);
+	for(i=0; i < 5; i++) {
+		CHECK(va->entries[i].key == i+1);
+		CHECK(va->entries[i].count >= 10000*(5-i));
+		CHECK(va->entries[i].count <= 10000*(5-i) + slack);
+	}
+
+	free(keys);
+	free(v);
+	free(va);
+	free(vb);
+}
+
+/*
+ * Counts 1e5 distinct keys and checks that the estimate is within
+ * three standard errors (about 1.6% each at the default precision),
+ * both directly and by merging the values of two overlapping halves,
+ * whose registers must be those of the whole stream.
+ */
+static void test_hll()
+{
+	mdcs_counter_t all, a, b;
+	const uint64_t n = 100000;
+	const double tol = 3*1.04/sqrt((double)(1 << MDCS_COUNTER_HLL_PRECISION))*n;
+	uint64_t i;
+
+	if(mdcs_counter_register("test:hll:all", MDCS_COUNTER_HLL, 0, &all) != MDCS_SUCCESS
+	|| mdcs_counter_register("test:hll:a", MDCS_COUNTER_HLL, 0, &a) != MDCS_SUCCESS
+	|| mdcs_counter_register("test:hll:b", MDCS_COUNTER_HLL, 0, &b) != MDCS_SUCCESS) {
+		CHECK(0 && "could not register HyperLogLog counters");
+		return;
+	}
+
+	for(i=0; i < n; i++) {
+		uint64_t key = rng_next();
+		mdcs_counter_push(all, &key);
+		if(i < 3*n/5) mdcs_counter_push(a, &key);
+		if(i >= 2*n/5) mdcs_counter_push(b, &key);
+	}
+
+	mdcs_counter_hll_value_t* v  = malloc(sizeof(*v));
+	mdcs_counter_hll_value_t* va = malloc(sizeof(*va));
+	mdcs_counter_hll_value_t* vb = malloc(sizeof(*vb));
+	mdcs_counter_value(all, v);
+	mdcs_counter_value(a, va);
+	mdcs_counter_value(b, vb);
+
+	CHECK_CLOSE(v->estimate, n, tol);
+	CHECK(mdcs_counter_type_merge(MDCS_COUNTER_HLL, va, vb) == MDCS_SUCCESS);
+	CHECK(memcmp(va->registers, v->registers, sizeof(v->registers)) == 0);
+	CHECK_CLOSE(va->estimate, n, tol);
+
+	free(v);
+	free(va);
+	free(vb);
+}
+
+/*
+ * Pushes the items of two streams into two counters of the given
+ * type, and their union into a third one, then merges the values of
+ * the first two into value_a and stores the value of the third one
+ * into value_all.
+ */
+static void push_split(const char* name, mdcs_counter_type_t type,
+		const void* items, size_t item_size, size_t num_items,
+		void* value_a, void* value_b, void* value_all)
+{
+	mdcs_counter_t a, b, all;
+	char buf[64];
+	size_t half = num_items/3;
+
+	snprintf(buf, sizeof(buf), "test:merge:%s:a", name);
+	CHECK(mdcs_counter_register(buf, type, 0, &a) == MDCS_SUCCESS);
+	snprintf(buf, sizeof(buf), "test:merge:%s:b", name);
+	CHECK(mdcs_counter_register(buf, type, 0, &b) == MDCS_SUCCESS);
+	snprintf(buf, sizeof(buf), "test:merge:%s:all", name);
+	CHECK(mdcs_counter_register(buf, type, 0, &all) == MDCS_SUCCESS);
+
+	mdcs_counter_push_multi(a, items, half);
+	mdcs_counter_push_multi(b, (const char*)items + half*item_size, num_items - half);
+	mdcs_counter_push_multi(all, items, num_items);
+
+	mdcs_counter_value(a, value_a);
+	mdcs_counter_value(b, value_b);
+	mdcs_counter_value(all, value_all);
+	CHECK(mdcs_counter_type_merge(type, value_a, value_b) == MDCS_SUCCESS);
+}
+
+/*
+ * Checks that merging the values of two counters gives the value of a
+ * counter into which both streams were pushed.
+ */
+static void test_merge()
+{
+	const size_t n = 1000;
+	size_t i;
+
+	mdcs_counter_rate_item_t rate_items[1000];
+	for(i=0; i < n; i++)
+		rate_items[i] = rng_next() % 100;
+	mdcs_counter_rate_value_t ra, rb, rall;
+	push_split("rate", MDCS_COUNTER_RATE, rate_items, sizeof(rate_items[0]), n,
+			&ra, &rb, &rall);
+	CHECK(ra.total == rall.total);
+
+	double doubles[1000];
+	for(i=0; i < n; i++)
+		doubles[i] = (double)(rng_next() % 1000000)/1e4 - 20.0;
+	mdcs_counter_window_double_value_t wa, wb, wall;
+	push_split("window", MDCS_COUNTER_WINDOW_DOUBLE, doubles, sizeof(doubles[0]), n,
+			&wa, &wb, &wall);
+	CHECK(wa.count == wall.count);
+	CHECK(wa.min == wall.min);
+	CHECK(wa.max == wall.max);
+	CHECK_CLOSE(wa.avg, wall.avg, 1e-9*fabs(wall.avg) + 1e-9);
+	CHECK_CLOSE(wa.var, wall.var, 1e-9*wall.var);
+
+	mdcs_counter_covariance_item_t cov_items[1000];
+	for(i=0; i < n; i++) {
+		cov_items[i].x = (double)i;
+		cov_items[i].y = 3.0*i + 7.0 + (double)(rng_next() % 100)/10.0 - 5.0;
+	}
+	mdcs_counter_covariance_value_t ca, cb, call;
+	push_split("covariance", MDCS_COUNTER_COVARIANCE, cov_items, sizeof(cov_items[0]), n,
+			&ca, &cb, &call);
+	CHECK(ca.count == call.count);
+	CHECK_CLOSE(ca.mean_x, call.mean_x, 1e-9*fabs(call.mean_x));
+	CHECK_CLOSE(ca.mean_y, call.mean_y, 1e-9*fabs(call.mean_y));
+	CHECK_CLOSE(ca.var_x, call.var_x, 1e-9*call.var_x);
+	CHECK_CLOSE(ca.var_y, call.var_y, 1e-9*call.var_y);
+	CHECK_CLOSE(ca.cov, call.cov, 1e-9*fabs(call.cov));
+	CHECK_CLOSE(ca.slope, call.slope, 1e-9*fabs(call.slope));
+	CHECK_CLOSE(ca.correlation, call.correlation, 1e-9);
+	// the noise is small, so the fit recovers the slope
+	CHECK_CLOSE(call.slope, 3.0, 0.01);
+
+	for(i=0; i < n; i++)
+		doubles[i] = (double)(rng_next() % 1000000)*1e-6;
+	mdcs_counter_histogram_value_t ha, hb, hall;
+	push_split("histogram", MDCS_COUNTER_HISTOGRAM, doubles, sizeof(doubles[0]), n,
+			&ha, &hb, &hall);
+	CHECK(ha.count == n && hall.count == n);
+	CHECK_CLOSE(ha.sum, hall.sum, 1e-9*hall.sum);
+	CHECK(memcmp(ha.buckets, hall.buckets, sizeof(ha.buckets)) == 0);
+}
+
+typedef struct {
+	const char*   pattern;  // glob pattern, NULL to visit every name
+	size_t        max;      // maximum number of names to collect
+	size_t        num;      // number of names collected
+	const char*   names[16];
+} collect_context_t;
+
+/* collects names the same way the list RPC does, stopping once
+ * a page is full */
+static int collect(mdcs_counter_t counter, void* uarg)
+{
+	collect_context_t* ctx = (collect_context_t*)uarg;
+	if(ctx->pattern && fnmatch(ctx->pattern, counter->name, 0) != 0)
+		return 0;
+	if(ctx->num == ctx->max)
+		return 1;
+	ctx->names[ctx->num++] = counter->name;
+	return 0;
+}
+
+static void check_names(const collect_context_t* ctx, const char** expected, size_t num)
+{
+	size_t i;
+	CHECK(ctx->num == num);
+	for(i=0; i < num && i < ctx->num; i++)
+		CHECK(strcmp(ctx->names[i], expected[i]) == 0);
+}
+
+/*
+ * Checks the names visited by the name trie for prefixes, glob
+ * patterns and pages that start after a given name.
+ */
+static void test_trie()
+{
+	const char* names[] = { "trie:svc:b", "trie:svc:a", "trie:svc:ab",
+		"trie:svc:abc", "trie:svc", "trie:other:x", "trie:svc:a:1",
+		"trie:svc:a:2", "trie:svc:zz", "trie:s", "trie:svcx" };
+	// the same names, sorted
+	const char* sorted[] = { "trie:other:x", "trie:s", "trie:svc",
+		"trie:svc:a", "trie:svc:a:1", "trie:svc:a:2", "trie:svc:ab",
+		"trie:svc:abc", "trie:svc:b", "trie:svc:zz", "trie:svcx" };
+	const size_t num_names = sizeof(names)/sizeof(names[0]);
+	collect_context_t ctx;
+	mdcs_counter_t c;
+	size_t i;
+
+	for(i=0; i < num_names; i++)
+		CHECK(mdcs_counter_register(names[i], MDCS_COUNTER_LAST_INT64, 0, &c) == MDCS_SUCCESS);
+
+	ctx = (collect_context_t){ NULL, 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:svc:", NULL, collect, &ctx);
+	check_names(&ctx, sorted+3, 7);
+
+	ctx = (collect_context_t){ NULL, 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:svc:c", NULL, collect, &ctx);
+	CHECK(ctx.num == 0);
+
+	// pages of 3 names, each one starting after the last name of the previous one
+	const char* start_after = NULL;
+	size_t seen = 0;
+	do {
+		ctx = (collect_context_t){ NULL, 3, 0 };
+		mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:", start_after, collect, &ctx);
+		if(seen + ctx.num > num_names) break;
+		check_names(&ctx, sorted+seen, ctx.num);
+		seen += ctx.num;
+		if(ctx.num) start_after = ctx.names[ctx.num-1];
+	} while(ctx.num == 3);
+	CHECK(seen == num_names);
+
+	// the name to start after does not need to exist
+	ctx = (collect_context_t){ NULL, 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:sv", "trie:svc:aa", collect, &ctx);
+	check_names(&ctx, sorted+6, 5);
+
+	ctx = (collect_context_t){ "trie:svc:a:*", 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:", NULL, collect, &ctx);
+	check_names(&ctx, sorted+4, 2);
+
+	const char* glob_bz[] = { "trie:svc:ab", "trie:svc:abc", "trie:svc:zz" };
+	ctx = (collect_context_t){ "trie:svc:?[bz]*", 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:", NULL, collect, &ctx);
+	check_names(&ctx, glob_bz, 3);
+
+	ctx = (collect_context_t){ "trie:svc:[!a]*", 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:", NULL, collect, &ctx);
+	check_names(&ctx, sorted+8, 2);
+
+	// a glob page stops after the requested number of matches
+	ctx = (collect_context_t){ "trie:svc*", 2, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:", "trie:svc:a", collect, &ctx);
+	check_names(&ctx, sorted+4, 2);
+
+	// removed names are no longer visited
+	mdcs_name_trie_remove(g_mdcs->counter_trie, "trie:svc:a");
+	ctx = (collect_context_t){ NULL, 16, 0 };
+	mdcs_name_trie_walk(g_mdcs->counter_trie, "trie:svc:a", NULL, collect, &ctx);
+	check_names(&ctx, sorted+4, 4);
+}
+
+int main(int argc, char** argv)
+{
+	if(ABT_init(argc, argv) != ABT_SUCCESS) {
+		fprintf(stderr, "Could not initialize Argobots\n");
+		return 1;
+	}
+
+	if(mdcs_init(MARGO_INSTANCE_NULL, MDCS_FALSE, ABT_POOL_NULL) != MDCS_SUCCESS) {
+		fprintf(stderr, "Could not initialize MDCS\n");
+		ABT_finalize();
+		return 1;
+	}
+
+	test_topk();
+	test_hll();
+	test_merge();
+	test_trie();
+
+	mdcs_finalize();
+	ABT_finalize();
+
+	if(failures) {
+		fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
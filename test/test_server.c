@@ -5,6 +5,7 @@
 #include <margo.h>
 #include <mdcs/mdcs.h>
 #include <mdcs/mdcs-counters.h>
+#include <mdcs/mdcs-margo.h>
 #include "types.h"
 #include "range-tracker.h"
 
@@ -21,7 +22,6 @@ static mdcs_counter_t myrange   = MDCS_COUNTER_NULL;
  *   hg_return_t f(hg_handle_t h)
  */
 hg_return_t sum(hg_handle_t h);
-DECLARE_MARGO_RPC_HANDLER(sum)
 
 /*
  * main function.
@@ -34,14 +34,18 @@ int main(int argc, char** argv)
 	margo_instance_id mid = margo_init("bmi+tcp://localhost:1234", MARGO_SERVER_MODE, 0, 0);
     assert(mid);
 
-	/* Register the RPC by its name ("sum") */
-	MARGO_REGISTER(mid, "sum", sum_in_t, sum_out_t, sum);
-
 	int ret;
 	
 	ret = mdcs_init(mid, MDCS_TRUE, ABT_POOL_NULL);
 	assert(ret == MDCS_SUCCESS);
 
+	/* Register the RPC by its name ("sum"), letting MDCS
+	   count its calls and time its handler */
+	MDCS_REGISTER(mid, "sum", sum_in_t, sum_out_t, sum);
+
+	/* Sample Margo's Argobots pools every 100 ms */
+	mdcs_abt_sampler_start(0.1);
+
 	mdcs_counter_type_t range_tracker_type = MDCS_COUNTER_TYPE_NULL;
 
 	mdcs_counter_type_create(sizeof(range_tracker_item_t),
@@ -54,9 +58,18 @@ int main(int argc, char** argv)
 	                         (mdcs_get_value_f)range_tracker_get_value,
 	                         &range_tracker_type);
 
+	/* Describe the layout of the values so that remote
+	   collectors can decode them without knowing the type */
+	mdcs_counter_field_t range_tracker_fields[] = {
+		{ "range", MDCS_FIELD_UINT32, 0, 1 }
+	};
+	mdcs_counter_type_register("example:range_tracker", range_tracker_type,
+	                           range_tracker_fields, 1);
+
 	mdcs_counter_register("example:myrange", range_tracker_type, 0, &myrange);
 	mdcs_counter_register("example:mycounter", MDCS_COUNTER_LAST_INT64, 0, &mycounter); 
 	mdcs_counter_register("example:mystats", MDCS_COUNTER_STAT_DOUBLE, 0, &mystats);
+	mdcs_counter_enable_exemplars(mystats, 3, 0.0);
 
 	margo_wait_for_finalize(mid);
 
@@ -101,7 +114,7 @@ hg_return_t sum(hg_handle_t h)
 	for(i=0; i<20; i++) {
 		double random_value;
 		random_value = (double)rand()/RAND_MAX*2.0-1.0; //float in range -1 to 1
-		mdcs_counter_push(mystats, &random_value);
+		mdcs_counter_push_tagged(mystats, &random_value, in.x*100+i);
 	}
 
 	r = mdcs_counter_value(mycounter, &stored);
@@ -120,4 +133,3 @@ hg_return_t sum(hg_handle_t h)
 
 	return HG_SUCCESS;
 }
-DEFINE_MARGO_RPC_HANDLER(sum)